@@ -40,15 +40,28 @@
 #define EIGRP_NEIGHBOR_UP             2
 #define EIGRP_NEIGHBOR_STATE_MAX      3
 
-/*Packet requiring ack will be retransmitted again after this time*/
-#define EIGRP_PACKET_RETRANS_TIME        2 /* in seconds */
+/*Packet requiring ack will be retransmitted again after RTO, derived from
+  the measured round trip time to the neighbor*/
 #define EIGRP_PACKET_RETRANS_MAX         16 /* number of retrans attempts */
+#define EIGRP_RTO_INITIAL                2000 /* msec, until the first RTT sample */
+#define EIGRP_RTO_MIN                    200 /* msec */
+#define EIGRP_RTO_MAX                    5000 /* msec */
+
+/*Retransmission timer wheel, has to cover EIGRP_RTO_MAX*/
+#define EIGRP_RTO_WHEEL_TICK             50 /* msec */
+#define EIGRP_RTO_WHEEL_SLOTS            128
 #define PLAINTEXT_LENGTH                 81
 
 /*Metric variance multiplier*/
 #define EIGRP_VARIANCE_DEFAULT  1
 #define EIGRP_MAX_PATHS_DEFAULT 4
 
+/*Time DUAL collects changes before sending Queries and Updates*/
+#define EIGRP_DUAL_FLUSH_DELAY_DEFAULT   10 /* in milliseconds */
+
+/* Redistributed routes taken into the topology per thread event */
+#define EIGRP_EXTERNAL_BATCH             1000
+
 
 /* Return values of functions involved in packet verification */
 #define MSG_OK    0
@@ -87,8 +100,10 @@
 /* Default configuration file name for eigrp. */
 #define EIGRP_DEFAULT_CONFIG   "eigrpd.conf"
 
-#define EIGRP_HELLO_INTERVAL_DEFAULT        5
-#define EIGRP_HOLD_INTERVAL_DEFAULT         15
+#define EIGRP_HELLO_INTERVAL_DEFAULT        5000 /* msec */
+#define EIGRP_HOLD_INTERVAL_DEFAULT         15000 /* msec */
+#define EIGRP_HELLO_INTERVAL_MSEC_MIN       50
+#define EIGRP_HOLD_INTERVAL_MSEC_MIN        150
 #define EIGRP_BANDWIDTH_DEFAULT             10000000
 #define EIGRP_DELAY_DEFAULT                 1000
 #define EIGRP_RELIABILITY_DEFAULT           255
@@ -124,6 +139,7 @@
 #define EIGRP_TOPOLOGY_TYPE_CONNECTED           0 // Connected network
 #define EIGRP_TOPOLOGY_TYPE_REMOTE              1 // Remote internal network
 #define EIGRP_TOPOLOGY_TYPE_REMOTE_EXTERNAL     2 // Remote external network
+#define EIGRP_TOPOLOGY_TYPE_EXTERNAL            3 // Redistributed into EIGRP here
 
 /*EIGRP TT entry flags*/
 #define EIGRP_NEIGHBOR_ENTRY_SUCCESSOR_FLAG     1
@@ -191,6 +207,10 @@
 #define EIGRP_K5_DEFAULT	0		//!< no reliability term
 #define EIGRP_K6_DEFAULT	0		//!< do not add in extended metrics
 
+/* Metric formula picked for the configured K values */
+#define EIGRP_METRIC_KERNEL_GENERIC	0	//!< any K values
+#define EIGRP_METRIC_KERNEL_LINEAR	1	//!< K2 = K4 = K5 = 0: K1*BW + K3*delay
+
 
 /*
  * EIGRP Fixed header
@@ -253,13 +273,27 @@
 #define EIGRP_TLV_PARAMETER_LEN         (12U)
 #define EIGRP_TLV_AUTH                  (EIGRP_TLV_GENERAL | 0x0002)    /*!< authentication */
 #define EIGRP_TLV_SEQ                   (EIGRP_TLV_GENERAL | 0x0003)    /*!< sequenced packet */
-#define EIGRP_TLV_SEQ_BASE_LEN          (5U)
+#define EIGRP_TLV_SEQ_BASE_LEN          (4U)     /* each address adds its length byte */
 #define EIGRP_TLV_SW_VERSION            (EIGRP_TLV_GENERAL | 0x0004)    /*!< software version */
 #define EIGRP_TLV_SW_VERSION_LEN        (8U)
 #define EIGRP_TLV_NEXT_MCAST_SEQ        (EIGRP_TLV_GENERAL | 0x0005)    /*!< sequence number */
+#define EIGRP_TLV_STUB                  (EIGRP_TLV_GENERAL | 0x0006)    /*!< stub router information */
+#define EIGRP_TLV_STUB_LEN              (6U)
 #define EIGRP_TLV_PEER_TERMINATION      (EIGRP_TLV_GENERAL | 0x0007)    /*!< peer termination */
 #define EIGRP_TLV_PEER_TIDLIST          (EIGRP_TLV_GENERAL | 0x0008)    /*!< peer sub-topology list */
 
+/**
+ * Stub TLV flags: which of its own routes a stub router advertises.
+ * A stub with no flags set is receive-only.
+ */
+#define EIGRP_STUB_CONNECTED            0x0001
+#define EIGRP_STUB_STATIC               0x0002
+#define EIGRP_STUB_SUMMARY              0x0004
+#define EIGRP_STUB_RECEIVE_ONLY         0x0008
+#define EIGRP_STUB_REDISTRIBUTED        0x0010
+#define EIGRP_STUB_LEAK_MAP             0x0020
+#define EIGRP_STUB_DEFAULT              (EIGRP_STUB_CONNECTED | EIGRP_STUB_SUMMARY)
+
 /* Older cisco routers send TIDLIST value wrong, adding for backwards compatabily */
 #define EIGRP_TLV_PEER_MTRLIST          (EIGRP_TLV_GENERAL | 0x00f5)
 
@@ -277,6 +311,9 @@
 #define EIGRP_TLV_IPv4_EXT              (EIGRP_TLV_IPv4 | EIGRP_TLV_EXTERNAL)
 #define EIGRP_TLV_IPv4_COM              (EIGRP_TLV_IPv4 | EIGRP_TLV_COMMUNITY)
 
+#define EIGRP_TLV_IPv4_INT_MAX_LEN      (0x1DU)  /*!< internal TLV, /25-/32 */
+#define EIGRP_TLV_IPv4_EXT_MAX_LEN      (0x31U)  /*!< external TLV, /25-/32 */
+
 /**
  *
  * extdata flag field definitions
@@ -108,6 +108,13 @@ config_write_debug (struct vty *vty)
 ////      return 1;
 //  }
 
+  /* debug eigrp fsm. */
+  if (conf_debug_eigrp & EIGRP_DEBUG_FSM)
+  {
+      vty_out (vty, "debug eigrp fsm%s", VTY_NEWLINE);
+      write = 1;
+  }
+
   /* debug eigrp packet */
   for (i = 0; i < 11; i++)
   {
@@ -366,6 +373,19 @@ show_ip_eigrp_interface_header (struct vty *vty, struct eigrp *eigrp)
            VTY_NEWLINE);
 }
 
+/* Interface timer, in seconds unless configured in milliseconds. */
+static void
+show_ip_eigrp_timer (struct vty *vty, u_int32_t msec)
+{
+  char buf[16];
+
+  if (msec % 1000)
+    snprintf (buf, sizeof (buf), "%ums", msec);
+  else
+    snprintf (buf, sizeof (buf), "%u", msec / 1000);
+  vty_out (vty, "%-8s ", buf);
+}
+
 void
 show_ip_eigrp_interface_sub (struct vty *vty, struct eigrp *eigrp,
 			     struct eigrp_interface *ei)
@@ -376,7 +396,9 @@ show_ip_eigrp_interface_sub (struct vty *vty, struct eigrp *eigrp,
   vty_out (vty, "%-7u", ei->nbrs->count);
   vty_out (vty, "%u %c %-10u",0,'/',eigrp_neighbor_packet_queue_sum (ei));
   vty_out (vty, "%-7u %-14u %-12u %-8u",0,0,0,0);
-  vty_out (vty, "%-8u %-8u %s",IF_DEF_PARAMS (ei->ifp)->v_hello,IF_DEF_PARAMS (ei->ifp)->v_wait,VTY_NEWLINE);
+  show_ip_eigrp_timer (vty, IF_DEF_PARAMS (ei->ifp)->v_hello);
+  show_ip_eigrp_timer (vty, IF_DEF_PARAMS (ei->ifp)->v_wait);
+  vty_out (vty, "%s", VTY_NEWLINE);
 }
 
 void
@@ -409,8 +431,8 @@ show_ip_eigrp_neighbor_sub (struct vty *vty, struct eigrp_neighbor *nbr,
 {
 
   vty_out (vty, "%-3u %-17s %-21s",0,eigrp_neigh_ip_string (nbr),eigrp_if_name_string (nbr->ei));
-  vty_out (vty,"%-7lu",thread_timer_remain_second (nbr->t_holddown));
-  vty_out (vty,"%-8u %-6u %-5u",0,0,EIGRP_PACKET_RETRANS_TIME);
+  vty_out (vty,"%-7lu",eigrp_nbr_holddown_remain (nbr));
+  vty_out (vty,"%-8u %-6u %-5u",0,nbr->srtt,nbr->rto);
   vty_out (vty,"%-7lu",nbr->retrans_queue->count);
   vty_out (vty,"%u%s",nbr->recv_sequence_number,VTY_NEWLINE);
 
@@ -420,9 +442,16 @@ show_ip_eigrp_neighbor_sub (struct vty *vty, struct eigrp_neighbor *nbr,
       vty_out(vty,"    Version %u.%u/%u.%u",
 	      nbr->os_rel_major, nbr->os_rel_minor,
 	      nbr->tlv_rel_major, nbr->tlv_rel_minor);
-      vty_out(vty,", Retrans: %lu, Retries: %lu",
-	      nbr->retrans_queue->count, 0UL);
+      vty_out(vty,", Retrans: %u, Retries: %u",
+	      nbr->retrans_sent,
+	      nbr->retrans_queue->tail ? nbr->retrans_queue->tail->retrans_counter : 0);
       vty_out(vty,", %s%s", eigrp_nbr_state_str(nbr), VTY_NEWLINE);
+      vty_out(vty,"    SRTT %u ms, RTT variance %u ms, RTO %u ms, %u samples%s",
+	      nbr->srtt, nbr->rttvar, nbr->rto, nbr->rtt_samples, VTY_NEWLINE);
+      vty_out(vty,"    Retransmit queue %lu (peak %lu), multicast queue %lu (peak %lu)%s",
+	      nbr->retrans_queue->count, nbr->retrans_queue->count_max,
+	      nbr->multicast_queue->count, nbr->multicast_queue->count_max,
+	      VTY_NEWLINE);
     }
 }
 
@@ -447,7 +476,7 @@ show_ip_eigrp_prefix_entry (struct vty *vty, struct eigrp_prefix_entry *tn)
 {
   vty_out (vty, "%-3c",(tn->state > 0) ? 'A' : 'P');
   vty_out (vty, "%s/%u, ",inet_ntoa (tn->destination_ipv4->prefix),tn->destination_ipv4->prefixlen);
-  vty_out (vty, "%u successors, ",eigrp_topology_get_successor(tn)->count);
+  vty_out (vty, "%u successors, ",eigrp_topology_get_successor_count(tn));
   vty_out (vty, "FD is %u, serno: %lu %s",tn->fdistance, tn->serno, VTY_NEWLINE);
 
 }
@@ -455,8 +484,13 @@ show_ip_eigrp_prefix_entry (struct vty *vty, struct eigrp_prefix_entry *tn)
 void
 show_ip_eigrp_neighbor_entry (struct vty *vty, struct eigrp *eigrp, struct eigrp_neighbor_entry *te)
 {
-  if (te->adv_router == eigrp->neighbor_self)
+  if (te->adv_router == eigrp->neighbor_self
+      && (te->flags & EIGRP_NEIGHBOR_ENTRY_EXTERNAL_FLAG))
+    vty_out (vty, "%-7s%s (%u/%u)%s"," ","via Redistributed",te->distance, te->reported_distance, VTY_NEWLINE);
+  else if (te->adv_router == eigrp->neighbor_self)
     vty_out (vty, "%-7s%s, %s%s"," ","via Connected",eigrp_if_name_string (te->ei), VTY_NEWLINE);
+  else if (te->adv_router == NULL)
+    vty_out (vty, "%-7s%s (%u/%u), %s%s"," ","via neighbor down",te->distance, te->reported_distance, eigrp_if_name_string (te->ei), VTY_NEWLINE);
   else
     {
       vty_out (vty, "%-7s%s%s (%u/%u), %s%s"," ","via ",inet_ntoa (te->adv_router->src),te->distance, te->reported_distance, eigrp_if_name_string (te->ei), VTY_NEWLINE);
@@ -479,6 +513,10 @@ DEFUN (show_debugging_eigrp,
   if (IS_DEBUG_EIGRP(event,EVENT))
     vty_out (vty, "  EIGRP event debugging is on%s", VTY_NEWLINE);
 
+  /* Show debug status for the DUAL state machine. */
+  if (IS_DEBUG_EIGRP_FSM)
+    vty_out (vty, "  EIGRP FSM debugging is on%s", VTY_NEWLINE);
+
   /* Show debug status for EIGRP Packets. */
   for (i = 0; i < 11 ; i++)
   {
@@ -622,6 +660,35 @@ ALIAS (no_debug_eigrp_transmit,
        "more detail\n"
        "this is really strange\n")
 
+DEFUN (debug_eigrp_fsm,
+       debug_eigrp_fsm_cmd,
+       "debug eigrp fsm",
+       DEBUG_STR
+       EIGRP_STR
+       "EIGRP DUAL state machine events\n")
+{
+  if (vty->node == CONFIG_NODE)
+	conf_debug_eigrp |= EIGRP_DEBUG_FSM;
+  term_debug_eigrp |= EIGRP_DEBUG_FSM;
+
+  return CMD_SUCCESS;
+}
+
+DEFUN (no_debug_eigrp_fsm,
+       no_debug_eigrp_fsm_cmd,
+       "no debug eigrp fsm",
+       NO_STR
+       UNDEBUG_STR
+       EIGRP_STR
+       "EIGRP DUAL state machine events\n")
+{
+  if (vty->node == CONFIG_NODE)
+	conf_debug_eigrp &= ~EIGRP_DEBUG_FSM;
+  term_debug_eigrp &= ~EIGRP_DEBUG_FSM;
+
+  return CMD_SUCCESS;
+}
+
 DEFUN (debug_eigrp_packets,
        debug_eigrp_packets_all_cmd,
        "debug eigrp packets (siaquery|siareply|ack|hello|probe|query|reply|request|retry|stub|terse|update|all)",
@@ -907,6 +974,8 @@ eigrp_debug_init ()
   install_element (ENABLE_NODE, &debug_eigrp_transmit_detail_cmd);
   install_element (ENABLE_NODE, &no_debug_eigrp_transmit_cmd);
   install_element (ENABLE_NODE, &no_debug_eigrp_transmit_detail_cmd);
+  install_element (ENABLE_NODE, &debug_eigrp_fsm_cmd);
+  install_element (ENABLE_NODE, &no_debug_eigrp_fsm_cmd);
 
   install_element (CONFIG_NODE, &show_debugging_eigrp_cmd);
   install_element (CONFIG_NODE, &debug_eigrp_packets_all_cmd);
@@ -919,6 +988,8 @@ eigrp_debug_init ()
   install_element (CONFIG_NODE, &debug_eigrp_transmit_detail_cmd);
   install_element (CONFIG_NODE, &no_debug_eigrp_transmit_cmd);
   install_element (CONFIG_NODE, &no_debug_eigrp_transmit_detail_cmd);
+  install_element (CONFIG_NODE, &debug_eigrp_fsm_cmd);
+  install_element (CONFIG_NODE, &no_debug_eigrp_fsm_cmd);
 }
 
 
@@ -36,6 +36,7 @@ extern unsigned long term_debug_eigrp;
 #define EIGRP_DEBUG_EVENT		0x01
 #define EIGRP_DEBUG_DETAIL		0x02
 #define EIGRP_DEBUG_TIMERS		0x04
+#define EIGRP_DEBUG_FSM			0x08
 
 /* neighbor debug flags */
 extern unsigned long term_debug_eigrp_nei;
@@ -138,6 +139,7 @@ extern unsigned long term_debug_eigrp_zebra;
 #define IS_DEBUG_EIGRP(a, b) \
 	(term_debug_eigrp & EIGRP_DEBUG_ ## b)
 #define IS_DEBUG_EIGRP_EVENT IS_DEBUG_EIGRP(event, EVENT)
+#define IS_DEBUG_EIGRP_FSM IS_DEBUG_EIGRP(fsm, FSM)
 
 
 /* Prototypes. */
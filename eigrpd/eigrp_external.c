@@ -0,0 +1,515 @@
+/*
+ * EIGRP Redistributed (External) Routes.
+ * Copyright (C) 2013-2014
+ * Authors:
+ *   Donnie Savage
+ *   Jan Janovic
+ *   Matej Perina
+ *   Peter Orsag
+ *   Peter Paluch
+ *
+ * This file is part of GNU Zebra.
+ *
+ * GNU Zebra is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * GNU Zebra is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Zebra; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include <zebra.h>
+
+#include "thread.h"
+#include "prefix.h"
+#include "table.h"
+#include "memory.h"
+#include "linklist.h"
+#include "log.h"
+
+#include "eigrpd/eigrp_structs.h"
+#include "eigrpd/eigrpd.h"
+#include "eigrpd/eigrp_interface.h"
+#include "eigrpd/eigrp_network.h"
+#include "eigrpd/eigrp_topology.h"
+#include "eigrpd/eigrp_fsm.h"
+#include "eigrpd/eigrp_external.h"
+
+/*
+ * Routes zebra redistributes to us are kept per source protocol in a
+ * table keyed by prefix, together with the redistribute metric last
+ * evaluated for them.  Zebra messages only update that table and queue
+ * the route; the queue is taken into the topology by an event, a batch
+ * at a time, so a protocol redistributing a full table does not hold up
+ * hellos and DUAL.  What changed in the topology goes out like any
+ * other change, through the change log and the DUAL flush.
+ *
+ * A redistributed route is originated only if the prefix is not in the
+ * topology yet.  It is then a passive prefix with a single entry of
+ * neighbor_self flagged external, never installed into zebra, and sent
+ * as an external TLV.  Routes shadowed this way are tried again once the
+ * prefix is removed from the topology.
+ */
+
+/* External protocol ID advertised for routes of a zebra route type */
+static u_char
+eigrp_external_protocol (int type)
+{
+  switch (type)
+    {
+    case ZEBRA_ROUTE_CONNECT:
+      return CONN_PROTID;
+    case ZEBRA_ROUTE_STATIC:
+      return STATIC_PROTID;
+    case ZEBRA_ROUTE_RIP:
+      return RIP_PROTID;
+    case ZEBRA_ROUTE_OSPF:
+      return OSPF_PROTID;
+    case ZEBRA_ROUTE_ISIS:
+      return ISIS_PROTID;
+    case ZEBRA_ROUTE_BGP:
+      return BGP_PROTID;
+    default:
+      return NULL_PROTID;
+    }
+}
+
+/*
+ * Evaluate the redistribute metric of the route's protocol for it,
+ * returns 1 if the result differs from the one cached in the route.
+ */
+static int
+eigrp_external_evaluate (struct eigrp *eigrp, struct eigrp_external *ext)
+{
+  struct eigrp_metrics *dm = &eigrp->dmetric[ext->type];
+  struct eigrp_metrics metric;
+  u_int32_t distance;
+
+  memset (&metric, 0, sizeof (metric));
+  metric.bandwith = dm->bandwith ?
+    eigrp_bandwidth_to_scaled (dm->bandwith) : EIGRP_MAX_METRIC;
+  metric.delay = dm->delay < EIGRP_MAX_METRIC / 256 ?
+    eigrp_delay_to_scaled (dm->delay) : EIGRP_MAX_METRIC - 1;
+  metric.reliability = dm->reliability;
+  metric.load = dm->load;
+  metric.mtu[0] = dm->mtu[0];
+  metric.mtu[1] = dm->mtu[1];
+  metric.mtu[2] = dm->mtu[2];
+
+  distance = eigrp_calculate_metrics (eigrp, &metric);
+
+  if (distance == ext->distance
+      && !memcmp (&metric, &ext->emetric, sizeof (metric)))
+    return 0;
+
+  ext->emetric = metric;
+  ext->distance = distance;
+  return 1;
+}
+
+static int eigrp_external_process (struct thread *);
+
+static void
+eigrp_external_queue (struct eigrp *eigrp, struct eigrp_external *ext)
+{
+  if (ext->pending)
+    return;
+
+  ext->pending = 1;
+  ext->pending_next = NULL;
+  if (eigrp->external_pending_tail)
+    eigrp->external_pending_tail->pending_next = ext;
+  else
+    eigrp->external_pending_head = ext;
+  eigrp->external_pending_tail = ext;
+
+  if (eigrp->t_external == NULL)
+    eigrp->t_external =
+      thread_add_event (master, eigrp_external_process, eigrp, 0);
+}
+
+/* Our entry for a route redistributed into the prefix, if there is one */
+static struct eigrp_neighbor_entry *
+eigrp_external_entry (struct eigrp *eigrp, struct eigrp_prefix_entry *pe)
+{
+  struct eigrp_neighbor_entry *ne;
+  struct listnode *node;
+
+  for (ALL_LIST_ELEMENTS_RO (pe->entries, node, ne))
+    if (ne->adv_router == eigrp->neighbor_self
+        && (ne->flags & EIGRP_NEIGHBOR_ENTRY_EXTERNAL_FLAG))
+      return ne;
+
+  return NULL;
+}
+
+/* Make the prefix advertise the route, returns 1 if that changed it */
+static int
+eigrp_external_prefix_set (struct eigrp *eigrp, struct eigrp_prefix_entry *pe,
+                           struct eigrp_external *ext)
+{
+  struct TLV_IPv4_External_type *tlv;
+  int changed = 0;
+
+  if (pe->extTLV == NULL)
+    {
+      pe->extTLV = XCALLOC (MTYPE_EIGRP_IPV4_EXT_TLV,
+                            sizeof (struct TLV_IPv4_External_type));
+      changed = 1;
+    }
+  tlv = pe->extTLV;
+
+  if (pe->nt != EIGRP_TOPOLOGY_TYPE_EXTERNAL
+      || pe->distance != ext->distance
+      || memcmp (&pe->reported_metric, &ext->emetric, sizeof (ext->emetric))
+      || tlv->external_metric != ext->metric
+      || tlv->external_protocol != eigrp_external_protocol (ext->type))
+    changed = 1;
+
+  pe->nt = EIGRP_TOPOLOGY_TYPE_EXTERNAL;
+  pe->distance = pe->fdistance = ext->distance;
+  pe->reported_metric = ext->emetric;
+
+  tlv->originating_router.s_addr = htonl (eigrp->router_id);
+  tlv->originating_as = eigrp->AS;
+  tlv->external_metric = ext->metric;
+  tlv->external_protocol = eigrp_external_protocol (ext->type);
+
+  return changed;
+}
+
+/*
+ * Take a redistributed route into the topology, or bring what it has
+ * there in step with it.
+ */
+static void
+eigrp_external_originate (struct eigrp *eigrp, struct eigrp_external *ext)
+{
+  struct eigrp_prefix_entry *pe;
+  struct eigrp_neighbor_entry *ne;
+  int changed;
+
+  pe = eigrp_topology_table_lookup_ipv4 (eigrp->topology_table, &ext->p);
+
+  /* a prefix withdrawn but not yet sent is taken over as it is */
+  if (pe && !ext->originated
+      && (!list_isempty (pe->entries) || pe->state != EIGRP_FSM_STATE_PASSIVE))
+    return;
+
+  if (pe == NULL)
+    {
+      pe = eigrp_prefix_entry_new ();
+      pe->serno = eigrp->serno;
+      pe->destination_ipv4 = prefix_ipv4_new ();
+      *pe->destination_ipv4 = ext->p;
+      pe->af = AF_INET;
+      pe->state = EIGRP_FSM_STATE_PASSIVE;
+      eigrp_prefix_entry_add (eigrp->topology_table, pe);
+    }
+
+  changed = eigrp_external_prefix_set (eigrp, pe, ext);
+
+  ne = eigrp_external_entry (eigrp, pe);
+  if (ne == NULL)
+    {
+      ne = eigrp_neighbor_entry_new ();
+      ne->reported_metric = ne->total_metric = ext->emetric;
+      ne->distance = ext->distance;
+      ne->reported_distance = 0;
+      ne->prefix = pe;
+      ne->adv_router = eigrp->neighbor_self;
+      ne->flags = EIGRP_NEIGHBOR_ENTRY_SUCCESSOR_FLAG
+        | EIGRP_NEIGHBOR_ENTRY_EXTERNAL_FLAG;
+      eigrp_neighbor_entry_add (pe, ne);
+      changed = 1;
+    }
+  else if (ne->distance != ext->distance
+           || memcmp (&ne->reported_metric, &ext->emetric,
+                      sizeof (ext->emetric)))
+    {
+      ne->reported_metric = ne->total_metric = ext->emetric;
+      ne->distance = ext->distance;
+
+      /* keep the entries sorted by distance */
+      listnode_delete (pe->entries, ne);
+      listnode_add_sort (pe->entries, ne);
+      changed = 1;
+    }
+
+  if (changed)
+    {
+      eigrp_topology_update_node_flags (pe);
+      eigrp_update_routing_table (pe);
+    }
+
+  ext->originated = 1;
+
+  if (changed)
+    eigrp_topology_change (eigrp, pe, EIGRP_FSM_NEED_UPDATE);
+}
+
+/*
+ * Remove what a redistributed route has put into the topology.  If there
+ * is no other route to the prefix, it is advertised unreachable and goes
+ * away once that has been sent, see eigrp_update_send_all().
+ */
+static void
+eigrp_external_withdraw (struct eigrp *eigrp, struct eigrp_external *ext)
+{
+  struct eigrp_prefix_entry *pe;
+  struct eigrp_neighbor_entry *ne, *best;
+
+  if (!ext->originated)
+    return;
+  ext->originated = 0;
+
+  pe = eigrp_topology_table_lookup_ipv4 (eigrp->topology_table, &ext->p);
+  if (pe == NULL || (ne = eigrp_external_entry (eigrp, pe)) == NULL)
+    return;
+
+  eigrp_neighbor_entry_delete (pe, ne);
+
+  if (list_isempty (pe->entries))
+    {
+      pe->distance = pe->fdistance = EIGRP_MAX_METRIC;
+      pe->reported_metric.delay = EIGRP_MAX_METRIC;
+    }
+  else
+    {
+      /* routes learned from neighbors take over */
+      pe->nt = EIGRP_TOPOLOGY_TYPE_REMOTE;
+      XFREE (MTYPE_EIGRP_IPV4_EXT_TLV, pe->extTLV);
+      pe->extTLV = NULL;
+
+      if (pe->state == EIGRP_FSM_STATE_PASSIVE)
+        {
+          best = listgetdata (listhead (pe->entries));
+          pe->distance = pe->fdistance = pe->rdistance = best->distance;
+          pe->reported_metric = best->total_metric;
+          eigrp_topology_update_node_flags (pe);
+          eigrp_update_routing_table (pe);
+        }
+    }
+
+  eigrp_topology_change (eigrp, pe, EIGRP_FSM_NEED_UPDATE);
+}
+
+static void
+eigrp_external_free (struct eigrp *eigrp, struct eigrp_external *ext)
+{
+  struct route_node *rn;
+
+  rn = route_node_lookup (eigrp->external[ext->type], (struct prefix *) &ext->p);
+  if (rn)
+    {
+      rn->info = NULL;
+      route_unlock_node (rn); /* lock taken by eigrp_external_add() */
+      route_unlock_node (rn); /* lock taken by route_node_lookup() */
+    }
+
+  XFREE (MTYPE_EIGRP_EXTERNAL, ext);
+}
+
+/*
+ * Take queued routes into the topology, at most EIGRP_EXTERNAL_BATCH of
+ * them per event.
+ */
+static int
+eigrp_external_process (struct thread *thread)
+{
+  struct eigrp *eigrp = THREAD_ARG (thread);
+  struct eigrp_external *ext;
+  unsigned int count = 0;
+
+  eigrp->t_external = NULL;
+
+  eigrp_dual_flush_prepare (eigrp, NULL);
+
+  while ((ext = eigrp->external_pending_head) != NULL
+         && count++ < EIGRP_EXTERNAL_BATCH)
+    {
+      eigrp->external_pending_head = ext->pending_next;
+      if (eigrp->external_pending_head == NULL)
+        eigrp->external_pending_tail = NULL;
+      ext->pending_next = NULL;
+      ext->pending = 0;
+
+      if (ext->withdrawn)
+        {
+          eigrp_external_withdraw (eigrp, ext);
+          eigrp_external_free (eigrp, ext);
+          continue;
+        }
+
+      eigrp_external_evaluate (eigrp, ext);
+      eigrp_external_originate (eigrp, ext);
+    }
+
+  if (eigrp->external_pending_head)
+    eigrp->t_external =
+      thread_add_event (master, eigrp_external_process, eigrp, 0);
+
+  eigrp_dual_flush_schedule (eigrp, NULL);
+
+  return 0;
+}
+
+/* Route of the given type has been added or changed in zebra. */
+void
+eigrp_external_add (struct eigrp *eigrp, int type, struct prefix_ipv4 *p,
+                    struct in_addr nexthop, u_int32_t metric)
+{
+  struct eigrp_external *ext;
+  struct route_node *rn;
+
+  if (eigrp->external[type] == NULL)
+    eigrp->external[type] = route_table_init ();
+
+  rn = route_node_get (eigrp->external[type], (struct prefix *) p);
+  if ((ext = rn->info) != NULL)
+    {
+      route_unlock_node (rn);
+
+      /* zebra sends routes again, e.g. when it reconnects */
+      if (!ext->withdrawn && ext->nexthop.s_addr == nexthop.s_addr
+          && ext->metric == metric)
+        return;
+    }
+  else
+    {
+      ext = XCALLOC (MTYPE_EIGRP_EXTERNAL, sizeof (struct eigrp_external));
+      ext->p = *p;
+      ext->type = type;
+      ext->distance = EIGRP_MAX_METRIC;
+      rn->info = ext;
+    }
+
+  ext->nexthop = nexthop;
+  ext->metric = metric;
+  ext->withdrawn = 0;
+  eigrp_external_queue (eigrp, ext);
+}
+
+/* Route of the given type has been deleted from zebra. */
+void
+eigrp_external_delete (struct eigrp *eigrp, int type, struct prefix_ipv4 *p)
+{
+  struct route_node *rn;
+
+  if (eigrp->external[type] == NULL)
+    return;
+
+  rn = route_node_lookup (eigrp->external[type], (struct prefix *) p);
+  if (rn == NULL)
+    return;
+
+  if (rn->info)
+    {
+      ((struct eigrp_external *) rn->info)->withdrawn = 1;
+      eigrp_external_queue (eigrp, rn->info);
+    }
+  route_unlock_node (rn);
+}
+
+/*
+ * Redistribute metric of the type has been changed, routes for which it
+ * evaluates differently are queued to be advertised again.
+ */
+void
+eigrp_external_routes_refresh (struct eigrp *eigrp, int type)
+{
+  struct eigrp_external *ext;
+  struct route_node *rn;
+
+  if (eigrp->external[type] == NULL)
+    return;
+
+  for (rn = route_top (eigrp->external[type]); rn; rn = route_next (rn))
+    {
+      if ((ext = rn->info) == NULL || ext->withdrawn)
+        continue;
+
+      if (eigrp_external_evaluate (eigrp, ext))
+        eigrp_external_queue (eigrp, ext);
+    }
+}
+
+/* The type is no longer redistributed, zebra won't delete its routes. */
+void
+eigrp_external_type_clear (struct eigrp *eigrp, int type)
+{
+  struct eigrp_external *ext;
+  struct route_node *rn;
+
+  if (eigrp->external[type] == NULL)
+    return;
+
+  for (rn = route_top (eigrp->external[type]); rn; rn = route_next (rn))
+    if ((ext = rn->info) != NULL)
+      {
+        ext->withdrawn = 1;
+        eigrp_external_queue (eigrp, ext);
+      }
+}
+
+/*
+ * Prefix has been removed from the topology, redistributed routes it
+ * was shadowing get their chance.
+ */
+void
+eigrp_external_prefix_freed (struct eigrp *eigrp, struct prefix_ipv4 *p)
+{
+  struct eigrp_external *ext;
+  struct route_node *rn;
+  int type;
+
+  for (type = 0; type <= ZEBRA_ROUTE_MAX; type++)
+    {
+      if (eigrp->external[type] == NULL)
+        continue;
+
+      rn = route_node_lookup (eigrp->external[type], (struct prefix *) p);
+      if (rn == NULL)
+        continue;
+
+      ext = rn->info;
+      if (ext && !ext->withdrawn && !ext->originated)
+        eigrp_external_queue (eigrp, ext);
+      route_unlock_node (rn);
+    }
+}
+
+/* Free all the redistributed routes, used at shutdown. */
+void
+eigrp_external_finish (struct eigrp *eigrp)
+{
+  struct route_node *rn;
+  int type;
+
+  THREAD_OFF (eigrp->t_external);
+  eigrp->external_pending_head = eigrp->external_pending_tail = NULL;
+
+  for (type = 0; type <= ZEBRA_ROUTE_MAX; type++)
+    {
+      if (eigrp->external[type] == NULL)
+        continue;
+
+      for (rn = route_top (eigrp->external[type]); rn; rn = route_next (rn))
+        if (rn->info)
+          {
+            XFREE (MTYPE_EIGRP_EXTERNAL, rn->info);
+            rn->info = NULL;
+            route_unlock_node (rn);
+          }
+      route_table_finish (eigrp->external[type]);
+      eigrp->external[type] = NULL;
+    }
+}
@@ -0,0 +1,40 @@
+/*
+ * EIGRP Redistributed (External) Routes.
+ * Copyright (C) 2013-2014
+ * Authors:
+ *   Donnie Savage
+ *   Jan Janovic
+ *   Matej Perina
+ *   Peter Orsag
+ *   Peter Paluch
+ *
+ * This file is part of GNU Zebra.
+ *
+ * GNU Zebra is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * GNU Zebra is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Zebra; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef _ZEBRA_EIGRP_EXTERNAL_H
+#define _ZEBRA_EIGRP_EXTERNAL_H
+
+/* Routes redistributed from zebra, see eigrp_external.c */
+extern void eigrp_external_add (struct eigrp *, int, struct prefix_ipv4 *, struct in_addr, u_int32_t);
+extern void eigrp_external_delete (struct eigrp *, int, struct prefix_ipv4 *);
+extern void eigrp_external_routes_refresh (struct eigrp *, int);
+extern void eigrp_external_type_clear (struct eigrp *, int);
+extern void eigrp_external_prefix_freed (struct eigrp *, struct prefix_ipv4 *);
+extern void eigrp_external_finish (struct eigrp *);
+
+#endif /* _ZEBRA_EIGRP_EXTERNAL_H */
@@ -88,6 +88,8 @@
 #include "eigrpd/eigrp_dump.h"
 #include "eigrpd/eigrp_topology.h"
 #include "eigrpd/eigrp_fsm.h"
+#include "eigrpd/eigrp_stats.h"
+#include "eigrpd/eigrp_trace.h"
 
 /*
  * Prototypes
@@ -111,6 +113,14 @@ eigrp_fsm_event_qact(struct eigrp_fsm_action_message *);
 
 //---------------------------------------------------------------------
 
+/* Names of the states and events, indexed by their EIGRP_FSM_* values */
+const char *eigrp_fsm_state_str[EIGRP_FSM_STATE_MAX] = {
+		"PASSIVE", "ACTIVE_0", "ACTIVE_1", "ACTIVE_2", "ACTIVE_3" };
+
+const char *eigrp_fsm_event_str[EIGRP_FSM_KEEP_STATE + 1] = {
+		"NQ_FCN", "LR", "Q_FCN", "LR_FCS", "DINC", "QACT", "LR_FCN",
+		"KEEP_STATE" };
+
 /*
  * NSM - field of fields of struct containing one function each.
  * Which function is used depends on actual state of FSM and occurred
@@ -193,7 +203,7 @@ int eigrp_get_fsm_event(struct eigrp_fsm_action_message *msg) {
 		entry = eigrp_neighbor_entry_new();
 		entry->adv_router = msg->adv_router;
 		entry->ei = msg->adv_router->ei;
-		entry->prefix = prefix;
+		eigrp_neighbor_entry_add(prefix, entry);
 		msg->entry = entry;
 	}
 
@@ -227,11 +237,13 @@ int eigrp_get_fsm_event(struct eigrp_fsm_action_message *msg) {
 		eigrp_topology_update_distance(msg);
 
 		if (msg->packet_type == EIGRP_OPC_REPLY) {
-			listnode_delete(prefix->rij, entry->adv_router);
+			listnode_delete(prefix->rij, msg->adv_router);
 			if (prefix->rij->count) {
 				return EIGRP_FSM_KEEP_STATE;
 			} else {
-				zlog_info("All reply received\n");
+				if (IS_DEBUG_EIGRP_FSM)
+					zlog_debug("%s: all replies received",
+							eigrp_topology_ip_string(prefix));
 				if (((struct eigrp_neighbor_entry *) prefix->entries->head->data)->reported_distance
 						< prefix->fdistance) {
 					return EIGRP_FSM_EVENT_LR_FCS;
@@ -255,7 +267,7 @@ int eigrp_get_fsm_event(struct eigrp_fsm_action_message *msg) {
 				&& (entry->flags & EIGRP_NEIGHBOR_ENTRY_SUCCESSOR_FLAG)) {
 			return EIGRP_FSM_EVENT_QACT;
 		} else if (msg->packet_type == EIGRP_OPC_REPLY) {
-			listnode_delete(prefix->rij, entry->adv_router);
+			listnode_delete(prefix->rij, msg->adv_router);
 
 			if (change == 1
 					&& (entry->flags & EIGRP_NEIGHBOR_ENTRY_SUCCESSOR_FLAG)) {
@@ -263,7 +275,9 @@ int eigrp_get_fsm_event(struct eigrp_fsm_action_message *msg) {
 			} else if (prefix->rij->count) {
 				return EIGRP_FSM_KEEP_STATE;
 			} else {
-				zlog_info("All reply received\n");
+				if (IS_DEBUG_EIGRP_FSM)
+					zlog_debug("%s: all replies received",
+							eigrp_topology_ip_string(prefix));
 				return EIGRP_FSM_EVENT_LR;
 			}
 		} else if (msg->packet_type == EIGRP_OPC_UPDATE && change == 1
@@ -279,11 +293,13 @@ int eigrp_get_fsm_event(struct eigrp_fsm_action_message *msg) {
 		eigrp_topology_update_distance(msg);
 
 		if (msg->packet_type == EIGRP_OPC_REPLY) {
-			listnode_delete(prefix->rij, entry->adv_router);
+			listnode_delete(prefix->rij, msg->adv_router);
 			if (prefix->rij->count) {
 				return EIGRP_FSM_KEEP_STATE;
 			} else {
-				zlog_info("All reply received\n");
+				if (IS_DEBUG_EIGRP_FSM)
+					zlog_debug("%s: all replies received",
+							eigrp_topology_ip_string(prefix));
 				if (((struct eigrp_neighbor_entry *) prefix->entries->head->data)->reported_distance
 						< prefix->fdistance) {
 					return EIGRP_FSM_EVENT_LR_FCS;
@@ -301,7 +317,7 @@ int eigrp_get_fsm_event(struct eigrp_fsm_action_message *msg) {
 		int change = eigrp_topology_update_distance(msg);
 
 		if (msg->packet_type == EIGRP_OPC_REPLY) {
-			listnode_delete(prefix->rij, entry->adv_router);
+			listnode_delete(prefix->rij, msg->adv_router);
 
 			if (change == 1
 					&& (entry->flags & EIGRP_NEIGHBOR_ENTRY_SUCCESSOR_FLAG)) {
@@ -309,7 +325,9 @@ int eigrp_get_fsm_event(struct eigrp_fsm_action_message *msg) {
 			} else if (prefix->rij->count) {
 				return EIGRP_FSM_KEEP_STATE;
 			} else {
-				zlog_info("All reply received\n");
+				if (IS_DEBUG_EIGRP_FSM)
+					zlog_debug("%s: all replies received",
+							eigrp_topology_ip_string(prefix));
 				return EIGRP_FSM_EVENT_LR;
 			}
 		} else if (msg->packet_type == EIGRP_OPC_UPDATE && change == 1
@@ -331,12 +349,43 @@ int eigrp_get_fsm_event(struct eigrp_fsm_action_message *msg) {
  */
 int eigrp_fsm_event(struct eigrp_fsm_action_message *msg, int event) {
 
-	zlog_info("EIGRP AS: %d State: %d  Event: %d Network: %s\n", msg->eigrp->AS,
-			msg->prefix->state, event, eigrp_topology_ip_string(msg->prefix));
-	(*(NSM[msg->prefix->state][event].func))(msg);
+	u_char state = msg->prefix->state;
+
+	if (IS_DEBUG_EIGRP_FSM)
+		zlog_debug("EIGRP AS: %d State: %d  Event: %d Network: %s",
+				msg->eigrp->AS, state, event,
+				eigrp_topology_ip_string(msg->prefix));
+	(*(NSM[state][event].func))(msg);
+	if ((state == EIGRP_FSM_STATE_PASSIVE)
+			!= (msg->prefix->state == EIGRP_FSM_STATE_PASSIVE))
+		eigrp_topology_active_update(msg->eigrp, msg->prefix);
+	eigrp_trace_fsm(msg, event, state);
+	eigrp_stats_fsm(msg, event, state);
 
 	return 1;
 }
+
+/*
+ * Distance of the prefix through its successor.  The prefix may have
+ * none left, e.g. when the successor's neighbor is gone, and is then
+ * unreachable.
+ */
+static u_int32_t eigrp_fsm_successor_distance(struct eigrp_prefix_entry *prefix) {
+	struct eigrp_neighbor_entry *successor = eigrp_topology_get_successor(prefix);
+
+	return successor ? successor->distance : EIGRP_MAX_METRIC;
+}
+
+/* Metric the prefix is reported with, unreachable without a successor */
+static void eigrp_fsm_successor_metric(struct eigrp_prefix_entry *prefix) {
+	struct eigrp_neighbor_entry *successor = eigrp_topology_get_successor(prefix);
+
+	if (successor)
+		prefix->reported_metric = successor->total_metric;
+	else
+		prefix->reported_metric.delay = EIGRP_MAX_METRIC;
+}
+
 /*
  * Function of event 0.
  *
@@ -344,16 +393,13 @@ int eigrp_fsm_event(struct eigrp_fsm_action_message *msg, int event) {
 int eigrp_fsm_event_nq_fcn(struct eigrp_fsm_action_message *msg) {
 	struct eigrp *eigrp = msg->eigrp;
 	struct eigrp_prefix_entry *prefix = msg->prefix;
-	struct list *successors = eigrp_topology_get_successor(prefix);
 	prefix->state = EIGRP_FSM_STATE_ACTIVE_1;
 	prefix->rdistance = prefix->distance = prefix->fdistance =
-			((struct eigrp_neighbor_entry *) successors->head->data)->distance;
-	prefix->reported_metric =
-			((struct eigrp_neighbor_entry *) successors->head->data)->total_metric;
+			eigrp_fsm_successor_distance(prefix);
+	eigrp_fsm_successor_metric(prefix);
 
 	if (eigrp_nbr_count_get()) {
-		prefix->req_action |= EIGRP_FSM_NEED_QUERY;
-		listnode_add(eigrp->topology_changes_internalIPV4,prefix);
+		eigrp_topology_change(eigrp, prefix, EIGRP_FSM_NEED_QUERY);
 	} else {
 		eigrp_fsm_event_lr(msg); //in the case that there are no more neighbors left
 	}
@@ -364,15 +410,12 @@ int eigrp_fsm_event_nq_fcn(struct eigrp_fsm_action_message *msg) {
 int eigrp_fsm_event_q_fcn(struct eigrp_fsm_action_message *msg) {
 	struct eigrp *eigrp = msg->eigrp;
 	struct eigrp_prefix_entry *prefix = msg->prefix;
-	struct list *successors = eigrp_topology_get_successor(prefix);
 	prefix->state = EIGRP_FSM_STATE_ACTIVE_3;
 	prefix->rdistance = prefix->distance = prefix->fdistance =
-			((struct eigrp_neighbor_entry *) successors->head->data)->distance;
-	prefix->reported_metric =
-			((struct eigrp_neighbor_entry *) successors->head->data)->total_metric;
+			eigrp_fsm_successor_distance(prefix);
+	eigrp_fsm_successor_metric(prefix);
 	if (eigrp_nbr_count_get()) {
-			prefix->req_action |= EIGRP_FSM_NEED_QUERY;
-			listnode_add(eigrp->topology_changes_internalIPV4,prefix);
+			eigrp_topology_change(eigrp, prefix, EIGRP_FSM_NEED_QUERY);
 		} else {
 			eigrp_fsm_event_lr(msg); //in the case that there are no more neighbors left
 		}
@@ -394,10 +437,7 @@ int eigrp_fsm_event_keep_state(struct eigrp_fsm_action_message *msg) {
 									((struct eigrp_neighbor_entry *) prefix->entries->head->data)->distance;
 			prefix->reported_metric =
 					((struct eigrp_neighbor_entry *) prefix->entries->head->data)->total_metric;
-			if (msg->packet_type == EIGRP_OPC_QUERY)
-				eigrp_send_reply(msg->adv_router, msg->entry);
-			prefix->req_action |= EIGRP_FSM_NEED_UPDATE;
-			listnode_add((eigrp_lookup())->topology_changes_internalIPV4,prefix);
+			eigrp_topology_change(msg->eigrp, prefix, EIGRP_FSM_NEED_UPDATE);
 		}
 		eigrp_topology_update_node_flags(prefix);
 		eigrp_update_routing_table(prefix);
@@ -412,19 +452,19 @@ int eigrp_fsm_event_keep_state(struct eigrp_fsm_action_message *msg) {
 int eigrp_fsm_event_lr(struct eigrp_fsm_action_message *msg) {
 	struct eigrp *eigrp = msg->eigrp;
 	struct eigrp_prefix_entry *prefix = msg->prefix;
+	struct eigrp_neighbor_entry *successor;
 	prefix->fdistance =
 			prefix->distance =
 					prefix->rdistance =
 							((struct eigrp_neighbor_entry *) (prefix->entries->head->data))->distance;
 	prefix->reported_metric =
 			((struct eigrp_neighbor_entry *) (prefix->entries->head->data))->total_metric;
-	if (prefix->state == EIGRP_FSM_STATE_ACTIVE_3)
-		eigrp_send_reply(
-				((struct eigrp_neighbor_entry *) (eigrp_topology_get_successor(
-						prefix)->head->data))->adv_router, prefix);
+	successor = eigrp_topology_get_successor(prefix);
+	if (prefix->state == EIGRP_FSM_STATE_ACTIVE_3 && successor
+			&& successor->adv_router)
+		eigrp_send_reply(successor->adv_router, prefix);
 	prefix->state = EIGRP_FSM_STATE_PASSIVE;
-	prefix->req_action |= EIGRP_FSM_NEED_UPDATE;
-	listnode_add(eigrp->topology_changes_internalIPV4,prefix);
+	eigrp_topology_change(eigrp, prefix, EIGRP_FSM_NEED_UPDATE);
 	eigrp_topology_update_node_flags(prefix);
 	eigrp_update_routing_table(prefix);
 	eigrp_update_topology_table_prefix(eigrp->topology_table, prefix);
@@ -437,9 +477,7 @@ int eigrp_fsm_event_dinc(struct eigrp_fsm_action_message *msg) {
 	msg->prefix->state =
 			msg->prefix->state == EIGRP_FSM_STATE_ACTIVE_1 ?
 					EIGRP_FSM_STATE_ACTIVE_0 : EIGRP_FSM_STATE_ACTIVE_2;
-	msg->prefix->distance =
-			((struct eigrp_neighbor_entry *) (eigrp_topology_get_successor(
-					msg->prefix)->head->data))->distance;
+	msg->prefix->distance = eigrp_fsm_successor_distance(msg->prefix);
 	if (!msg->prefix->rij->count) {
 		(*(NSM[msg->prefix->state][eigrp_get_fsm_event(msg)].func))(msg);
 	}
@@ -450,6 +488,7 @@ int eigrp_fsm_event_dinc(struct eigrp_fsm_action_message *msg) {
 int eigrp_fsm_event_lr_fcs(struct eigrp_fsm_action_message *msg) {
 	struct eigrp *eigrp = msg->eigrp;
 	struct eigrp_prefix_entry *prefix = msg->prefix;
+	struct eigrp_neighbor_entry *successor;
 	prefix->state = EIGRP_FSM_STATE_PASSIVE;
 	prefix->distance =
 			prefix->rdistance =
@@ -459,12 +498,11 @@ int eigrp_fsm_event_lr_fcs(struct eigrp_fsm_action_message *msg) {
 	prefix->fdistance =
 			prefix->fdistance > prefix->distance ?
 					prefix->distance : prefix->fdistance;
-	if (prefix->state == EIGRP_FSM_STATE_ACTIVE_2)
-		eigrp_send_reply(
-				((struct eigrp_neighbor_entry *) (eigrp_topology_get_successor(
-						prefix)->head->data))->adv_router, prefix);
-	prefix->req_action |= EIGRP_FSM_NEED_UPDATE;
-	listnode_add(eigrp->topology_changes_internalIPV4,prefix);
+	successor = eigrp_topology_get_successor(prefix);
+	if (prefix->state == EIGRP_FSM_STATE_ACTIVE_2 && successor
+			&& successor->adv_router)
+		eigrp_send_reply(successor->adv_router, prefix);
+	eigrp_topology_change(eigrp, prefix, EIGRP_FSM_NEED_UPDATE);
 	eigrp_topology_update_node_flags(prefix);
 	eigrp_update_routing_table(prefix);
 	eigrp_update_topology_table_prefix(eigrp->topology_table, prefix);
@@ -478,14 +516,10 @@ int eigrp_fsm_event_lr_fcn(struct eigrp_fsm_action_message *msg) {
 	prefix->state =
 			prefix->state == EIGRP_FSM_STATE_ACTIVE_0 ?
 					EIGRP_FSM_STATE_ACTIVE_1 : EIGRP_FSM_STATE_ACTIVE_3;
-	struct eigrp_neighbor_entry *best_successor =
-			((struct eigrp_neighbor_entry *) (eigrp_topology_get_successor(
-					prefix)->head->data));
-	prefix->rdistance = prefix->distance = best_successor->distance;
-	prefix->reported_metric = best_successor->total_metric;
+	prefix->rdistance = prefix->distance = eigrp_fsm_successor_distance(prefix);
+	eigrp_fsm_successor_metric(prefix);
 	if (eigrp_nbr_count_get()) {
-		prefix->req_action |= EIGRP_FSM_NEED_QUERY;
-		listnode_add(eigrp->topology_changes_internalIPV4,prefix);
+		eigrp_topology_change(eigrp, prefix, EIGRP_FSM_NEED_QUERY);
 	} else {
 		eigrp_fsm_event_lr(msg); //in the case that there are no more neighbors left
 	}
@@ -495,8 +529,69 @@ int eigrp_fsm_event_lr_fcn(struct eigrp_fsm_action_message *msg) {
 
 int eigrp_fsm_event_qact(struct eigrp_fsm_action_message *msg) {
 	msg->prefix->state = EIGRP_FSM_STATE_ACTIVE_2;
-	msg->prefix->distance =
-			((struct eigrp_neighbor_entry *) (eigrp_topology_get_successor(
-					msg->prefix)->head->data))->distance;
+	msg->prefix->distance = eigrp_fsm_successor_distance(msg->prefix);
 	return 1;
 }
+
+/*
+ * Send Queries and Updates for everything DUAL changed since the last
+ * flush, in one round over the interfaces.
+ */
+static void eigrp_dual_flush_run(struct eigrp *eigrp) {
+	struct eigrp_interface *exception = eigrp->dual_flush_exception;
+
+	eigrp->dual_flush_exception = NULL;
+
+	eigrp_histogram_add(&eigrp->stats.flush_batch,
+			eigrp->stats.flush_packets);
+	eigrp->stats.flush_packets = 0;
+
+	eigrp_query_send_all(eigrp);
+	eigrp_update_send_all(eigrp, exception);
+}
+
+static int eigrp_dual_flush(struct thread *thread) {
+	struct eigrp *eigrp = THREAD_ARG(thread);
+
+	eigrp->t_dual_flush = NULL;
+	eigrp_dual_flush_run(eigrp);
+
+	return 0;
+}
+
+/*
+ * Called before DUAL is run for changes coming from ei, a received
+ * packet or a neighbor going down, or from no interface (NULL) for
+ * changes of our own.  Updates of a flush are not sent back out of the
+ * interface its changes came from, so changes pending from elsewhere are
+ * sent right away rather than mixed with these.
+ */
+void eigrp_dual_flush_prepare(struct eigrp *eigrp, struct eigrp_interface *ei) {
+	if (eigrp->t_dual_flush == NULL || eigrp->dual_flush_exception == ei)
+		return;
+
+	THREAD_OFF(eigrp->t_dual_flush);
+	eigrp_dual_flush_run(eigrp);
+}
+
+/*
+ * Called once a received packet has been run through DUAL.  Changes of
+ * all packets received from the same interface within dual_flush_delay
+ * are sent together, see eigrp_dual_flush_prepare().  ei is the interface
+ * the packet came from, Updates are not sent back out of it.
+ */
+void eigrp_dual_flush_schedule(struct eigrp *eigrp, struct eigrp_interface *ei) {
+	eigrp->stats.flush_packets++;
+
+	/* one interface per window, eigrp_dual_flush_prepare() saw to it */
+	if (eigrp->t_dual_flush)
+		return;
+
+	eigrp->dual_flush_exception = ei;
+	if (eigrp->dual_flush_delay)
+		eigrp->t_dual_flush = thread_add_timer_msec(master, eigrp_dual_flush,
+				eigrp, eigrp->dual_flush_delay);
+	else
+		eigrp->t_dual_flush = thread_add_event(master, eigrp_dual_flush, eigrp,
+				0);
+}
@@ -29,9 +29,13 @@
 #ifndef _ZEBRA_EIGRP_FSM_H
 #define _ZEBRA_EIGRP_FSM_H
 
+extern const char *eigrp_fsm_state_str[];
+extern const char *eigrp_fsm_event_str[];
 
 extern int eigrp_get_fsm_event (struct eigrp_fsm_action_message *);
 extern int eigrp_fsm_event (struct eigrp_fsm_action_message *, int);
+extern void eigrp_dual_flush_prepare (struct eigrp *, struct eigrp_interface *);
+extern void eigrp_dual_flush_schedule (struct eigrp *, struct eigrp_interface *);
 
 
 #endif /* _ZEBRA_EIGRP_DUAL_H */
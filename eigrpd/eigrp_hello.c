@@ -40,6 +40,8 @@
 #include "sockopt.h"
 #include "checksum.h"
 #include "md5.h"
+#include "vty.h"
+#include "keychain.h"
 
 #include "eigrpd/eigrp_structs.h"
 #include "eigrpd/eigrpd.h"
@@ -59,6 +61,7 @@ static const struct message eigrp_general_tlv_type_str[] =
   { EIGRP_TLV_SEQ,		"SEQ"			},
   { EIGRP_TLV_SW_VERSION,	"SW_VERSION"		},
   { EIGRP_TLV_NEXT_MCAST_SEQ,	"NEXT_MCAST_SEQ"	},
+  { EIGRP_TLV_STUB,		"STUB"			},
   { EIGRP_TLV_PEER_TERMINATION,	"PEER_TERMINATION"	},
   { EIGRP_TLV_PEER_MTRLIST,	"PEER_MTRLIST"		},
   { EIGRP_TLV_PEER_TIDLIST,	"PEER_TIDLIST"		},
@@ -89,15 +92,15 @@ eigrp_hello_timer (struct thread *thread)
   ei->t_hello = NULL;
 
   if (IS_DEBUG_EIGRP(0, TIMERS))
-    zlog (NULL, LOG_DEBUG, "Start Hello Timer (%s) Expire [%u]",
+    zlog (NULL, LOG_DEBUG, "Start Hello Timer (%s) Expire [%u ms]",
 	  IF_NAME(ei), EIGRP_IF_PARAM(ei, v_hello));
 
   /* Sending hello packet. */
   eigrp_hello_send(ei, EIGRP_HELLO_NORMAL);
 
   /* Hello timer set. */
-  ei->t_hello = thread_add_timer(master, eigrp_hello_timer, ei,
-				 EIGRP_IF_PARAM(ei, v_hello));
+  ei->t_hello = thread_add_timer_msec(master, eigrp_hello_timer, ei,
+				      EIGRP_IF_PARAM(ei, v_hello));
 
   return 0;
 }
@@ -123,6 +126,7 @@ eigrp_hello_parameter_decode (struct eigrp_neighbor *nbr,
 {
   struct eigrp *eigrp = nbr->ei->eigrp;
   struct TLV_Parameter_Type *param = (struct TLV_Parameter_Type *)tlv;
+  u_int32_t v_wait = IF_DEF_PARAMS(nbr->ei->ifp)->v_wait;
 
   /* copy over the values passed in by the neighbor */
   nbr->K1 = param->K1;
@@ -131,7 +135,21 @@ eigrp_hello_parameter_decode (struct eigrp_neighbor *nbr,
   nbr->K4 = param->K4;
   nbr->K5 = param->K5;
   nbr->K6 = param->K6;
-  nbr->v_holddown = ntohs(param->hold_time);
+  nbr->v_holddown = ntohs(param->hold_time) * 1000;
+
+  /*
+   * The TLV carries whole seconds, rounded up from a sub-second hold time
+   * configured on the interface.  A neighbor advertising that same second
+   * is taken to be configured alike and gets our hold time.  Any other
+   * neighbor keeps its own, never less than ours.
+   */
+  if (v_wait % 1000)
+    {
+      if (ntohs(param->hold_time) == (v_wait + 999) / 1000)
+        nbr->v_holddown = v_wait;
+      else
+        nbr->v_holddown = MAX(nbr->v_holddown, v_wait);
+    }
 
   /*
    * Check K1-K5 have the correct values to be able to become neighbors
@@ -186,9 +204,9 @@ eigrp_hello_authentication_decode(struct stream *s, struct eigrp_tlv_hdr_type *t
 
   md5 = (struct TLV_MD5_Authentication_Type *) tlv_header;
 
-  if(md5->auth_type == EIGRP_AUTH_TYPE_MD5)
-    return eigrp_check_md5_digest(s, tlv_header, nbr, EIGRP_AUTH_BASIC_HELLO_FLAG);
-  else if (md5->auth_type == EIGRP_AUTH_TYPE_SHA256)
+  if(ntohs(md5->auth_type) == EIGRP_AUTH_TYPE_MD5)
+    return eigrp_check_md5_digest(s, md5, nbr, EIGRP_AUTH_BASIC_HELLO_FLAG);
+  else if (ntohs(md5->auth_type) == EIGRP_AUTH_TYPE_SHA256)
     return eigrp_check_sha256_digest(s, (struct TLV_SHA256_Authentication_Type *) tlv_header, nbr, EIGRP_AUTH_BASIC_HELLO_FLAG);
 
   return 0;
@@ -220,6 +238,80 @@ eigrp_sw_version_decode (struct eigrp_neighbor *nbr,
   return;
 }
 
+/**
+ * @fn eigrp_stub_decode
+ *
+ * @param[in]		nbr	neighbor the TLV was received from
+ * @param[in]		tlv	pointer to TLV stub information
+ *
+ * @return void
+ *
+ * @par
+ * Remember which routes the neighbor advertises as a stub router.
+ * Stub neighbors are never queried.
+ */
+static void
+eigrp_stub_decode (struct eigrp_neighbor *nbr,
+		   struct eigrp_tlv_hdr_type *tlv)
+{
+  struct TLV_Stub_Type *stub = (struct TLV_Stub_Type *)tlv;
+
+  if (ntohs(stub->length) < EIGRP_TLV_STUB_LEN)
+    return;
+
+  /* no flags at all still means stub, one that advertises nothing */
+  nbr->stub = ntohs(stub->flags);
+  if (nbr->stub == 0)
+    nbr->stub = EIGRP_STUB_RECEIVE_ONLY;
+}
+
+/**
+ * @fn eigrp_sequence_decode
+ *
+ * @param[in]		ei	interface the hello came in on
+ * @param[in]		tlv	pointer to TLV sequence information
+ *
+ * @return int		non-zero if our address is listed
+ *
+ * @par
+ * Neighbors listed in the Sequence TLV must ignore the multicast
+ * announced by the Next Multicast Sequence TLV of the same hello.
+ * Each address is preceded by its length.
+ */
+static int
+eigrp_sequence_decode (struct eigrp_interface *ei,
+		       struct eigrp_tlv_hdr_type *tlv)
+{
+  u_char *p = (u_char *)tlv + EIGRP_TLV_SEQ_BASE_LEN;
+  u_int16_t length = ntohs(tlv->length);
+  struct in_addr addr;
+  u_char addr_len;
+
+  if (length < EIGRP_TLV_SEQ_BASE_LEN)
+    return 0;
+  length -= EIGRP_TLV_SEQ_BASE_LEN;
+
+  while (length > 0)
+    {
+      addr_len = *p++;
+      length--;
+      if (addr_len > length)
+	break;
+
+      if (addr_len == IPV4_MAX_BYTELEN)
+	{
+	  memcpy(&addr, p, IPV4_MAX_BYTELEN);
+	  if (addr.s_addr == ei->address->u.prefix4.s_addr)
+	    return 1;
+	}
+
+      p += addr_len;
+      length -= addr_len;
+    }
+
+  return 0;
+}
+
 /**
  * @fn eigrp_peer_termination_decode
  *
@@ -272,6 +364,8 @@ eigrp_hello_receive (struct eigrp *eigrp, struct ip *iph, struct eigrp_header *e
   struct eigrp_neighbor *nbr;
   uint16_t	type;
   uint16_t	length;
+  u_int32_t	next_mcast_seq = 0;
+  int		cr_excluded = 0;
 
   /* get neighbor struct */
   nbr = eigrp_nbr_get(ei, eigrph, iph);
@@ -306,19 +400,22 @@ eigrp_hello_receive (struct eigrp *eigrp, struct ip *iph, struct eigrp_header *e
 	    eigrp_hello_parameter_decode(nbr, tlv_header);
 	    break;
 	  case EIGRP_TLV_AUTH:
-	    {
-//              if(eigrp_hello_authentication_decode(s,tlv_header,nbr) == 0)
-//                return;
-//              else
-//                break;
-              break;
-	    }
+	    if (eigrp_hello_authentication_decode(s, tlv_header, nbr) == 0)
+	      return;
+	    break;
 	  case EIGRP_TLV_SEQ:
+	    cr_excluded = eigrp_sequence_decode(ei, tlv_header);
 	    break;
 	  case EIGRP_TLV_SW_VERSION:
 	    eigrp_sw_version_decode(nbr, tlv_header);
 	    break;
 	  case EIGRP_TLV_NEXT_MCAST_SEQ:
+	    if (length >= EIGRP_NEXT_SEQUENCE_TLV_SIZE)
+	      next_mcast_seq = ntohl(((struct TLV_Next_Multicast_Sequence *)
+				      tlv_header)->multicast_sequence);
+	    break;
+	  case EIGRP_TLV_STUB:
+	    eigrp_stub_decode(nbr, tlv_header);
 	    break;
 	  case EIGRP_TLV_PEER_TERMINATION:
 	    eigrp_peer_termination_decode(nbr, tlv_header);
@@ -336,6 +433,12 @@ eigrp_hello_receive (struct eigrp *eigrp, struct ip *iph, struct eigrp_header *e
 
   } while (size > 0);
 
+  /* conditional receive: the announced multicast is for us unless listed */
+  if (next_mcast_seq)
+    {
+      nbr->cr_mode = !cr_excluded;
+      nbr->cr_sequence = next_mcast_seq;
+    }
 
   /*If received packet is hello with Parameter TLV*/
   if (ntohl(eigrph->ack) == 0)
@@ -384,6 +487,31 @@ eigrp_sw_version_encode (struct stream *s)
   return(length);
 }
 
+/**
+ * @fn eigrp_stub_encode
+ *
+ * @param[in]		eigrp	eigrp process
+ * @param[in,out]	s	packet stream TLV is stored to
+ *
+ * @return u_int16_t	number of bytes added to packet stream
+ *
+ * @par
+ * If configured as a stub router, tell neighbors which of our routes
+ * they may expect so they stop sending us queries.
+ */
+static u_int16_t
+eigrp_stub_encode (struct eigrp *eigrp, struct stream *s)
+{
+  if (eigrp->stub == 0)
+    return 0;
+
+  stream_putw(s, EIGRP_TLV_STUB);
+  stream_putw(s, EIGRP_TLV_STUB_LEN);
+  stream_putw(s, eigrp->stub);
+
+  return EIGRP_TLV_STUB_LEN;
+}
+
 /**
  * @fn eigrp_tidlist_encode
  *
@@ -405,49 +533,44 @@ eigrp_tidlist_encode (struct stream *s)
 /**
  * @fn eigrp_sequence_encode
  *
+ * @param[in]           ei      interface the hello is sent out of
  * @param[in,out]       s       packet stream TLV is stored to
+ * @param[in]           seq     sequence number of the multicast to follow
  *
  * @return u_int16_t    number of bytes added to packet stream
  *
  * @par
- * Part of conditional receive process
- *
+ * Part of conditional receive process: list the neighbors which must
+ * ignore the next multicast, being either not up or still waiting for
+ * older packets.  The others have it as the oldest packet in flight.
  */
 static u_int16_t
-eigrp_sequence_encode (struct stream *s)
+eigrp_sequence_encode (struct eigrp_interface *ei, struct stream *s,
+                       u_int32_t seq)
 {
   u_int16_t length = EIGRP_TLV_SEQ_BASE_LEN;
-  struct eigrp *eigrp;
-  struct eigrp_interface *ei;
-  struct listnode *node, *node2, *nnode2;
+  struct listnode *node, *nnode;
   struct eigrp_neighbor *nbr;
+  struct eigrp_packet *ep;
   size_t backup_end, size_end;
   int found;
 
-  eigrp = eigrp_lookup ();
-  if (eigrp == NULL)
-    {
-      return 0;
-    }
-
   // add in the parameters TLV
   backup_end = stream_get_endp(s);
   stream_putw(s, EIGRP_TLV_SEQ);
   size_end = s->endp;
   stream_putw(s, 0x0000);
-  stream_putc(s, IPV4_MAX_BYTELEN);
 
   found = 0;
-  for (ALL_LIST_ELEMENTS_RO (eigrp->eiflist, node, ei))
+  for (ALL_LIST_ELEMENTS (ei->nbrs, node, nnode, nbr))
     {
-      for (ALL_LIST_ELEMENTS (ei->nbrs, node2, nnode2, nbr))
-        {
-          if(nbr->multicast_queue->count > 0)
-            {
-              length += (u_int16_t) stream_put_ipv4(s,nbr->src.s_addr);
-              found = 1;
-            }
-        }
+      ep = eigrp_fifo_tail(nbr->retrans_queue);
+      if (nbr->state == EIGRP_NEIGHBOR_UP && ep && ep->sequence_number == seq)
+        continue;
+
+      length += (u_int16_t) stream_putc(s, IPV4_MAX_BYTELEN);
+      length += (u_int16_t) stream_put_ipv4(s,nbr->src.s_addr);
+      found = 1;
     }
 
   if(found == 0)
@@ -465,9 +588,10 @@ eigrp_sequence_encode (struct stream *s)
 }
 
 /**
- * @fn eigrp_sequence_encode
+ * @fn eigrp_next_sequence_encode
  *
  * @param[in,out]       s       packet stream TLV is stored to
+ * @param[in]           seq     sequence number of the multicast to follow
  *
  * @return u_int16_t    number of bytes added to packet stream
  *
@@ -476,21 +600,14 @@ eigrp_sequence_encode (struct stream *s)
  *
  */
 static u_int16_t
-eigrp_next_sequence_encode (struct stream *s)
+eigrp_next_sequence_encode (struct stream *s, u_int32_t seq)
 {
   u_int16_t length = EIGRP_NEXT_SEQUENCE_TLV_SIZE;
-  struct eigrp *eigrp;
-
-  eigrp = eigrp_lookup ();
-  if (eigrp == NULL)
-    {
-      return 0;
-    }
 
   // add in the parameters TLV
     stream_putw(s, EIGRP_TLV_NEXT_MCAST_SEQ);
     stream_putw(s, EIGRP_NEXT_SEQUENCE_TLV_SIZE);
-    stream_putl(s,eigrp->sequence_number+1);
+    stream_putl(s, seq);
 
   return length;
 }
@@ -539,18 +656,48 @@ eigrp_hello_parameter_encode (struct eigrp_interface *ei, struct stream *s, u_ch
       stream_putc(s, ei->eigrp->k_values[5]); /* K6 */
     }
 
-  // and set hold time value..
-  stream_putw(s, IF_DEF_PARAMS(ei->ifp)->v_wait);
+  // and set hold time value, in seconds rounded up
+  stream_putw(s, (IF_DEF_PARAMS(ei->ifp)->v_wait + 999) / 1000);
 
   return length;
 }
 
+/**
+ * @fn eigrp_hello_sign
+ *
+ * @param[in]		ei	interface the hello is sent out of
+ * @param[in,out]	s	encoded hello packet
+ * @param[in]		length	packet length
+ *
+ * @return void
+ *
+ * @par
+ * Compute the authentication digest, if configured, and the checksum.
+ */
+static void
+eigrp_hello_sign (struct eigrp_interface *ei, struct stream *s,
+                  u_int16_t length)
+{
+  if((IF_DEF_PARAMS (ei->ifp)->auth_type == EIGRP_AUTH_TYPE_MD5) && (IF_DEF_PARAMS (ei->ifp)->auth_keychain != NULL))
+    {
+      eigrp_make_md5_digest(ei, s, EIGRP_AUTH_BASIC_HELLO_FLAG);
+    }
+  else if((IF_DEF_PARAMS (ei->ifp)->auth_type == EIGRP_AUTH_TYPE_SHA256) && (IF_DEF_PARAMS (ei->ifp)->auth_keychain != NULL))
+    {
+      eigrp_make_sha256_digest(ei, s, EIGRP_AUTH_BASIC_HELLO_FLAG);
+    }
+
+  // EIGRP Checksum
+  eigrp_packet_checksum(ei, s, length);
+}
+
 /**
  * @fn eigrp_hello_encode
  *
  * @param[in]		ei	pointer to interface hello packet came in on
  * @param[in]		s	packet stream TLV is stored to
  * @param[in]		ack	if non-zero, neigbors sequence packet to ack
+ * @param[in]		mcast_seq	with EIGRP_HELLO_ADD_SEQUENCE, sequence of next multicast
  *
  * @return eigrp_packet		pointer initialize hello packet
  *
@@ -559,7 +706,8 @@ eigrp_hello_parameter_encode (struct eigrp_interface *ei, struct stream *s, u_ch
  *
  */
 static struct eigrp_packet *
-eigrp_hello_encode (struct eigrp_interface *ei, in_addr_t addr, u_int32_t ack, u_char flags)
+eigrp_hello_encode (struct eigrp_interface *ei, in_addr_t addr, u_int32_t ack,
+                    u_char flags, u_int32_t mcast_seq)
 {
   struct eigrp_packet *ep;
   u_int16_t length = EIGRP_HEADER_LEN;
@@ -591,10 +739,14 @@ eigrp_hello_encode (struct eigrp_interface *ei, in_addr_t addr, u_int32_t ack, u
       // figure out the version of code we're running
       length += eigrp_sw_version_encode(ep->s);
 
+      // advertise stub router mode, unless we are going away anyway
+      if (!(flags & EIGRP_HELLO_GRACEFUL_SHUTDOWN))
+        length += eigrp_stub_encode(ei->eigrp, ep->s);
+
       if(flags & EIGRP_HELLO_ADD_SEQUENCE)
         {
-          length += eigrp_sequence_encode(ep->s);
-          length += eigrp_next_sequence_encode(ep->s);
+          length += eigrp_sequence_encode(ei, ep->s, mcast_seq);
+          length += eigrp_next_sequence_encode(ep->s, mcast_seq);
         }
 
       // add in the TID list if doing multi-topology
@@ -606,22 +758,98 @@ eigrp_hello_encode (struct eigrp_interface *ei, in_addr_t addr, u_int32_t ack, u
       // set soruce address for the hello packet
       ep->dst.s_addr = addr;
 
-      if((IF_DEF_PARAMS (ei->ifp)->auth_type == EIGRP_AUTH_TYPE_MD5) && (IF_DEF_PARAMS (ei->ifp)->auth_keychain != NULL))
-        {
-          eigrp_make_md5_digest(ei,ep->s, EIGRP_AUTH_BASIC_HELLO_FLAG);
-        }
-      else if((IF_DEF_PARAMS (ei->ifp)->auth_type == EIGRP_AUTH_TYPE_SHA256) && (IF_DEF_PARAMS (ei->ifp)->auth_keychain != NULL))
-        {
-          eigrp_make_sha256_digest(ei,ep->s, EIGRP_AUTH_BASIC_HELLO_FLAG);
-        }
-
-      // EIGRP Checksum
-      eigrp_packet_checksum(ei, ep->s, length);
+      eigrp_hello_sign(ei, ep->s, length);
     }
 
   return(ep);
 }
 
+/**
+ * @fn eigrp_hello_send_key
+ *
+ * @param[in]		ei	interface the hello is sent out of
+ *
+ * @return key		key hellos are signed with, NULL if none
+ *
+ * @par
+ * Key of the interface key chain currently valid for sending, used to
+ * tell when the cached hello needs to be signed again.
+ */
+static struct key *
+eigrp_hello_send_key (struct eigrp_interface *ei)
+{
+  if (IF_DEF_PARAMS (ei->ifp)->auth_type != EIGRP_AUTH_TYPE_MD5
+      && IF_DEF_PARAMS (ei->ifp)->auth_type != EIGRP_AUTH_TYPE_SHA256)
+    return NULL;
+
+  return eigrp_auth_send_key(ei);
+}
+
+/**
+ * @fn eigrp_hello_template
+ *
+ * @param[in]		ei	interface the hello is sent out of
+ *
+ * @return eigrp_packet		encoded periodic hello of the interface
+ *
+ * @par
+ * The periodic hello only changes with the configuration, so it is
+ * encoded once and its data shared by all the hellos queued on the
+ * interface.  eigrp_hello_template_flush() drops it when K values, hold
+ * time, stub mode or authentication are reconfigured; a send key rolling
+ * over, or its key-string being changed, is noticed here.
+ */
+static struct eigrp_packet *
+eigrp_hello_template (struct eigrp_interface *ei)
+{
+  struct key *key;
+
+  key = eigrp_hello_send_key(ei);
+
+  /* same key, but key-string may have given it a new secret */
+  if (ei->hello
+      && (ei->hello_key != key
+          || (key && (key->string == NULL || ei->hello_key_string == NULL
+                      || strcmp(key->string, ei->hello_key_string)))))
+    eigrp_hello_template_free(ei);
+
+  if (ei->hello == NULL)
+    {
+      ei->hello = eigrp_hello_encode(ei, htonl(EIGRP_MULTICAST_ADDRESS), 0,
+                                     EIGRP_HELLO_NORMAL, 0);
+      ei->hello_key = key;
+      if (key && key->string)
+        ei->hello_key_string = XSTRDUP(MTYPE_EIGRP_AUTH_KEY, key->string);
+    }
+
+  return ei->hello;
+}
+
+void
+eigrp_hello_template_free (struct eigrp_interface *ei)
+{
+  if (ei->hello)
+    {
+      /* hellos still queued hold their own reference to the data */
+      eigrp_packet_free(ei->hello);
+      ei->hello = NULL;
+    }
+  ei->hello_key = NULL;
+  if (ei->hello_key_string)
+    XFREE(MTYPE_EIGRP_AUTH_KEY, ei->hello_key_string);
+}
+
+/* Configuration carried in the hello changed, encode it again when sent. */
+void
+eigrp_hello_template_flush (struct eigrp *eigrp)
+{
+  struct listnode *node;
+  struct eigrp_interface *ei;
+
+  for (ALL_LIST_ELEMENTS_RO (eigrp->eiflist, node, ei))
+    eigrp_hello_template_free(ei);
+}
+
 /**
  * @fn eigrp_hello_send
  *
@@ -638,10 +866,36 @@ eigrp_hello_encode (struct eigrp_interface *ei, in_addr_t addr, u_int32_t ack, u
 void
 eigrp_hello_send_ack (struct eigrp_neighbor *nbr)
 {
-  struct eigrp_packet *ep;
+  struct eigrp_interface *ei = nbr->ei;
+  struct eigrp_packet *hello, *ep;
+  struct eigrp_header *eigrph;
+
+  hello = eigrp_hello_template(ei);
+  if (hello == NULL)
+    return;
 
-  /* if packet succesfully created, add it to the interface queue */
-  ep = eigrp_hello_encode(nbr->ei, nbr->src.s_addr, nbr->recv_sequence_number, EIGRP_HELLO_NORMAL);
+  /* the previous ack is still queued, leave it be */
+  if (nbr->hello_ack && nbr->hello_ack->data->refcnt > 1)
+    {
+      eigrp_packet_free(nbr->hello_ack);
+      nbr->hello_ack = NULL;
+    }
+  if (nbr->hello_ack == NULL)
+    nbr->hello_ack = eigrp_packet_new(ei->ifp->mtu);
+
+  /* periodic hello with the ack field filled in */
+  ep = nbr->hello_ack;
+  stream_reset(ep->s);
+  stream_put(ep->s, STREAM_DATA(hello->s), hello->length);
+  ep->length = hello->length;
+  ep->dst = nbr->src;
+
+  eigrph = (struct eigrp_header *) STREAM_DATA(ep->s);
+  eigrph->ack = htonl(nbr->recv_sequence_number);
+  eigrph->checksum = 0;
+  eigrp_hello_sign(ei, ep->s, ep->length);
+
+  ep = eigrp_packet_duplicate(ep, nbr);
 
   if (ep)
     {
@@ -691,12 +945,22 @@ eigrp_hello_send (struct eigrp_interface *ei, u_char flags)
     zlog_debug("Queueing [Hello] Interface(%s)", IF_NAME(ei));
 
   /* if packet was succesfully created, then add it to the interface queue */
-  ep = eigrp_hello_encode(ei, htonl(EIGRP_MULTICAST_ADDRESS), 0, flags);
+  if (flags == EIGRP_HELLO_NORMAL)
+    {
+      ep = eigrp_hello_template(ei);
+      if (ep)
+        ep = eigrp_packet_duplicate(ep, NULL);
+    }
+  else
+    ep = eigrp_hello_encode(ei, htonl(EIGRP_MULTICAST_ADDRESS), 0, flags, 0);
 
   if (ep)
     {
-      // Add packet to the top of the interface output queue
-      eigrp_fifo_push_head(ei->obuf, ep);
+      // Add packet to the interface output queue, going away jumps it
+      if(flags & EIGRP_HELLO_GRACEFUL_SHUTDOWN)
+        eigrp_fifo_push_tail(ei->obuf, ep);
+      else
+        eigrp_fifo_push_head(ei->obuf, ep);
 
       /* Hook thread to write packet. */
       if (ei->on_write_q == 0)
@@ -720,3 +984,44 @@ eigrp_hello_send (struct eigrp_interface *ei, u_char flags)
 	}
     }
 }
+
+/**
+ * @fn eigrp_hello_send_sequence
+ *
+ * @param[in]		ei	pointer to interface hello should be sent
+ * @param[in]		seq	sequence number of the multicast to follow
+ *
+ * @return void
+ *
+ * @par
+ * Queue a multicast hello announcing that the next reliable multicast,
+ * sent in conditional receive mode, is to be accepted only by neighbors
+ * not listed in its Sequence TLV.
+ */
+void
+eigrp_hello_send_sequence (struct eigrp_interface *ei, u_int32_t seq)
+{
+  struct eigrp_packet *ep;
+
+  if (IS_DEBUG_EIGRP_PACKET(0, SEND))
+    zlog_debug("Queueing [Hello] Sequence [%u] Interface(%s)", seq, IF_NAME(ei));
+
+  ep = eigrp_hello_encode(ei, htonl(EIGRP_MULTICAST_ADDRESS), 0,
+                          EIGRP_HELLO_ADD_SEQUENCE, seq);
+
+  if (ep)
+    {
+      eigrp_fifo_push_head(ei->obuf, ep);
+
+      /* Hook thread to write packet. */
+      if (ei->on_write_q == 0)
+        {
+          listnode_add(ei->eigrp->oi_write_q, ei);
+          ei->on_write_q = 1;
+        }
+
+      if (ei->eigrp->t_write == NULL)
+        ei->eigrp->t_write =
+          thread_add_write(master, eigrp_write, ei->eigrp, ei->eigrp->fd);
+    }
+}
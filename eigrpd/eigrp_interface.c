@@ -30,6 +30,7 @@
 
 #include "thread.h"
 #include "linklist.h"
+#include "hash.h"
 #include "prefix.h"
 #include "if.h"
 #include "table.h"
@@ -48,6 +49,8 @@
 #include "eigrpd/eigrp_vty.h"
 #include "eigrpd/eigrp_network.h"
 #include "eigrpd/eigrp_topology.h"
+#include "eigrpd/eigrp_summary.h"
+#include "eigrpd/eigrp_fsm.h"
 
 static void
 eigrp_delete_from_if (struct interface *, struct eigrp_interface *);
@@ -93,9 +96,14 @@ eigrp_if_new (struct eigrp *eigrp, struct interface *ifp, struct prefix *p)
 
   /* Initialize neighbor list. */
   ei->nbrs = list_new ();
+  ei->nbrs_hash = hash_create (eigrp_nbr_hash_key, eigrp_nbr_hash_cmp);
 
   ei->crypt_seqnum = time (NULL);
 
+  /* New neighbors learn older changes from the initial Update exchange */
+  ei->serno_last_update = eigrp->serno;
+  ei->serno_last_query = eigrp->serno;
+
   return ei;
 }
 
@@ -133,6 +141,8 @@ eigrp_if_delete_hook (struct interface *ifp)
       eigrp_del_if_params (rn->info);
   route_table_finish (IF_OIFS_PARAMS (ifp));
 
+  eigrp_summary_finish (ifp);
+
   XFREE (MTYPE_EIGRP_IF_INFO, ifp->info);
   ifp->info = NULL;
 
@@ -165,7 +175,7 @@ eigrp_if_new_hook (struct interface *ifp)
   IF_DEF_PARAMS (ifp)->v_hello = (u_int32_t) EIGRP_HELLO_INTERVAL_DEFAULT;
 
   SET_IF_PARAM (IF_DEF_PARAMS (ifp), v_wait);
-  IF_DEF_PARAMS (ifp)->v_wait = (u_int16_t) EIGRP_HOLD_INTERVAL_DEFAULT;
+  IF_DEF_PARAMS (ifp)->v_wait = (u_int32_t) EIGRP_HOLD_INTERVAL_DEFAULT;
 
   SET_IF_PARAM (IF_DEF_PARAMS (ifp), bandwidth);
   IF_DEF_PARAMS (ifp)->bandwidth = (u_int32_t) EIGRP_BANDWIDTH_DEFAULT;
@@ -185,6 +195,8 @@ eigrp_if_new_hook (struct interface *ifp)
   SET_IF_PARAM (IF_DEF_PARAMS (ifp), auth_keychain);
   IF_DEF_PARAMS (ifp)->auth_keychain= NULL;
 
+  IF_SUMMARIES (ifp) = route_table_init ();
+
   return rc;
 }
 
@@ -247,8 +259,6 @@ eigrp_if_up (struct eigrp_interface *ei)
   struct eigrp_prefix_entry *pe;
   struct eigrp_neighbor_entry *ne;
   struct eigrp_metrics metric;
-  struct eigrp_interface *ei2;
-  struct listnode *node, *nnode;
   struct eigrp *eigrp = eigrp_lookup ();
 
   if (ei == NULL)
@@ -259,6 +269,7 @@ eigrp_if_up (struct eigrp_interface *ei)
   else
     zlog_warn ("%s: eigrp_lookup () returned NULL", __func__);
   eigrp_if_stream_set (ei);
+  eigrp_if_cost_update (ei);
 
   /* Set multicast memberships appropriately for new state. */
   eigrp_if_set_multicast (ei);
@@ -279,6 +290,9 @@ eigrp_if_up (struct eigrp_interface *ei)
 
   /*Add connected entry to topology table*/
 
+  /* sent below to every interface, pending changes go first */
+  eigrp_dual_flush_prepare (eigrp, NULL);
+
   struct prefix_ipv4 *dest_addr = prefix_ipv4_new ();
 
   dest_addr->family = AF_INET;
@@ -296,10 +310,10 @@ eigrp_if_up (struct eigrp_interface *ei)
       pe->nt = EIGRP_TOPOLOGY_TYPE_CONNECTED;
 
       pe->state = EIGRP_FSM_STATE_PASSIVE;
-      pe->fdistance = eigrp_calculate_metrics (eigrp, &metric);
-      pe->req_action |= EIGRP_FSM_NEED_UPDATE;
+      pe->distance = pe->fdistance = eigrp_calculate_metrics (eigrp, &metric);
+      pe->reported_metric = metric;
       eigrp_prefix_entry_add (eigrp->topology_table, pe);
-      listnode_add(eigrp->topology_changes_internalIPV4, pe);
+      eigrp_topology_change (eigrp, pe, EIGRP_FSM_NEED_UPDATE);
     }
   ne = eigrp_neighbor_entry_new ();
   ne->ei = ei;
@@ -312,16 +326,7 @@ eigrp_if_up (struct eigrp_interface *ei)
   ne->flags = EIGRP_NEIGHBOR_ENTRY_SUCCESSOR_FLAG;
   eigrp_neighbor_entry_add (pe, ne);
 
-  for (ALL_LIST_ELEMENTS (eigrp->eiflist, node, nnode, ei2))
-    {
-      if (ei2->nbrs->count != 0)
-        {
-          eigrp_update_send (ei2);
-        }
-    }
-
-  pe->req_action &= ~EIGRP_FSM_NEED_UPDATE;
-  listnode_delete(eigrp->topology_changes_internalIPV4, pe);
+  eigrp_update_send_all (eigrp, NULL);
 
   return 1;
 }
@@ -341,12 +346,14 @@ eigrp_if_down (struct eigrp_interface *ei)
     THREAD_OFF (ei->t_hello);
 
   eigrp_if_stream_unset (ei);
+  eigrp_hello_template_free (ei);
 
   /*Set infinite metrics to routes learned by this interface and start query process*/
   for (ALL_LIST_ELEMENTS (ei->nbrs, node, nnode, nbr))
     {
       eigrp_nbr_delete(nbr);
     }
+  THREAD_OFF (ei->t_holddown);
 
   return 1;
 }
@@ -432,9 +439,15 @@ eigrp_if_free (struct eigrp_interface *ei, int source)
   eigrp_if_down (ei);
 
   list_delete (ei->nbrs);
+  hash_free (ei->nbrs_hash);
+  eigrp_auth_key_flush (ei);
   eigrp_delete_from_if (ei->ifp, ei);
   listnode_delete (ei->eigrp->eiflist, ei);
 
+  /* changes pending from it go out of the interfaces left */
+  if (ei->eigrp->dual_flush_exception == ei)
+    ei->eigrp->dual_flush_exception = NULL;
+
   thread_cancel_event (master, ei);
 
   memset (ei, 0, sizeof (*ei));
@@ -533,6 +546,17 @@ eigrp_if_lookup_recv_if (struct eigrp *eigrp, struct in_addr src,
   return match;
 }
 
+/*
+ * Refresh the link cost cached in the interface from its parameters, to be
+ * called whenever its delay or bandwidth is changed.
+ */
+void
+eigrp_if_cost_update (struct eigrp_interface *ei)
+{
+  ei->cost_delay = EIGRP_IF_PARAM (ei, delay);
+  ei->cost_bandwidth = EIGRP_IF_PARAM (ei, bandwidth);
+}
+
 u_int32_t
 eigrp_bandwidth_to_scaled (u_int32_t bandwidth)
 {
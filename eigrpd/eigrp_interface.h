@@ -59,6 +59,8 @@ struct eigrp_interface * eigrp_if_lookup_recv_if (struct eigrp *, struct in_addr
 /* Simulate down/up on the interface. */
 extern void eigrp_if_reset (struct interface *);
 
+extern void eigrp_if_cost_update (struct eigrp_interface *);
+
 extern u_int32_t eigrp_bandwidth_to_scaled (u_int32_t);
 extern u_int32_t eigrp_scaled_to_bandwidth (u_int32_t);
 extern u_int32_t eigrp_delay_to_scaled (u_int32_t);
@@ -36,6 +36,7 @@
 
 #define SET_IF_PARAM(S, P) ((S)->P##__config) = 1
 #define IF_DEF_PARAMS(I) (IF_EIGRP_IF_INFO (I)->def_params)
+#define IF_SUMMARIES(I) (IF_EIGRP_IF_INFO (I)->summaries)
 
 #define UNSET_IF_PARAM(S, P) ((S)->P##__config) = 0
 
@@ -77,6 +78,9 @@
 //-----------------------------------------------------------------------------------------------------------------------------------
 /* Topology Macros */
 
+/* Room the route TLV of a prefix entry may take in a packet */
+#define EIGRP_TLV_IPv4_MAX_LEN(PE) \
+      ((PE)->extTLV ? EIGRP_TLV_IPv4_EXT_MAX_LEN : EIGRP_TLV_IPv4_INT_MAX_LEN)
 
 /* FSM macros*/
 #define EIGRP_FSM_EVENT_SCHEDULE(I,E) \
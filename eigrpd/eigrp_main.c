@@ -61,6 +61,7 @@
 #include "eigrpd/eigrp_network.h"
 #include "eigrpd/eigrp_snmp.h"
 #include "eigrpd/eigrp_filter.h"
+#include "eigrpd/eigrp_trace.h"
 
 /* eigprd privileges */
 zebra_capabilities_t _caps_p [] = 
@@ -287,6 +288,7 @@ main (int argc, char **argv)
   eigrp_if_init ();
   eigrp_zebra_init ();
   eigrp_debug_init ();
+  eigrp_trace_init ();
 
   /* Get configuration file. */
   /* EIGRP VTY inits */
@@ -29,6 +29,8 @@
 #include <zebra.h>
 
 #include "linklist.h"
+#include "hash.h"
+#include "jhash.h"
 #include "prefix.h"
 #include "memory.h"
 #include "command.h"
@@ -91,23 +93,105 @@ eigrp_nbr_add (struct eigrp_interface *ei, struct eigrp_header *eigrph,
   return nbr;
 }
 
+/* Neighbors of an interface are hashed by their source address */
+unsigned int
+eigrp_nbr_hash_key (void *arg)
+{
+  const struct eigrp_neighbor *nbr = arg;
+
+  return jhash_1word (nbr->src.s_addr, 0);
+}
+
+int
+eigrp_nbr_hash_cmp (const void *arg1, const void *arg2)
+{
+  const struct eigrp_neighbor *nbr1 = arg1;
+  const struct eigrp_neighbor *nbr2 = arg2;
+
+  return nbr1->src.s_addr == nbr2->src.s_addr;
+}
+
+/*
+ * All neighbors of the instance are also kept in nbrs_table, ordered by
+ * address, so the SNMP peer table can be walked without scanning every
+ * interface.  Neighbors sharing an address on different interfaces hang
+ * off the same node, chained in ifindex order.
+ */
+static void
+eigrp_nbr_index_add (struct eigrp_neighbor *nbr)
+{
+  struct prefix_ipv4 p;
+  struct route_node *rn;
+  struct eigrp_neighbor *prev;
+  unsigned int ifindex = nbr->ei->ifp->ifindex;
+
+  p.family = AF_INET;
+  p.prefix = nbr->src;
+  p.prefixlen = IPV4_MAX_BITLEN;
+
+  rn = route_node_get (nbr->ei->eigrp->nbrs_table, (struct prefix *) &p);
+  prev = rn->info;
+  if (prev == NULL || prev->ei->ifp->ifindex > ifindex)
+    {
+      /* the node keeps its lock as long as it has a chain */
+      if (prev)
+        route_unlock_node (rn);
+      nbr->addr_next = prev;
+      rn->info = nbr;
+      return;
+    }
+
+  route_unlock_node (rn);
+  while (prev->addr_next && prev->addr_next->ei->ifp->ifindex < ifindex)
+    prev = prev->addr_next;
+  nbr->addr_next = prev->addr_next;
+  prev->addr_next = nbr;
+}
+
+static void
+eigrp_nbr_index_delete (struct eigrp_neighbor *nbr)
+{
+  struct prefix_ipv4 p;
+  struct route_node *rn;
+  struct eigrp_neighbor *prev;
+
+  p.family = AF_INET;
+  p.prefix = nbr->src;
+  p.prefixlen = IPV4_MAX_BITLEN;
+
+  rn = route_node_lookup (nbr->ei->eigrp->nbrs_table, (struct prefix *) &p);
+  if (rn == NULL)
+    return;
+
+  if (rn->info == nbr)
+    rn->info = nbr->addr_next;
+  else
+    for (prev = rn->info; prev; prev = prev->addr_next)
+      if (prev->addr_next == nbr)
+        {
+          prev->addr_next = nbr->addr_next;
+          break;
+        }
+
+  route_unlock_node (rn);
+  if (rn->info == NULL)
+    route_unlock_node (rn);
+}
+
 struct eigrp_neighbor *
 eigrp_nbr_get (struct eigrp_interface *ei, struct eigrp_header *eigrph,
               struct ip *iph)
 {
   struct eigrp_neighbor *nbr;
-  struct listnode *node, *nnode;
 
-  for (ALL_LIST_ELEMENTS (ei->nbrs, node, nnode, nbr))
-    {
-      if (iph->ip_src.s_addr == nbr->src.s_addr)
-        {
-          return nbr;
-        }
-    }
+  nbr = eigrp_nbr_lookup_by_addr (ei, &iph->ip_src);
+  if (nbr)
+    return nbr;
 
   nbr = eigrp_nbr_add (ei, eigrph, iph);
   listnode_add (ei->nbrs, nbr);
+  hash_get (ei->nbrs_hash, nbr, hash_alloc_intern);
+  eigrp_nbr_index_add (nbr);
 
   return nbr;
 }
@@ -115,18 +199,12 @@ eigrp_nbr_get (struct eigrp_interface *ei, struct eigrp_header *eigrph,
 struct eigrp_neighbor *
 eigrp_nbr_lookup_by_addr (struct eigrp_interface *ei, struct in_addr *addr)
 {
-  struct eigrp_neighbor *nbr;
-  struct listnode *node, *nnode;
+  struct eigrp_neighbor key;
 
-  for (ALL_LIST_ELEMENTS (ei->nbrs, node, nnode, nbr))
-      {
-        if (addr == nbr->src.s_addr)
-          {
-            return nbr;
-          }
-      }
+  /* only the address is looked at by the hash functions */
+  key.src = *addr;
 
-  return NULL;
+  return hash_lookup (ei->nbrs_hash, &key);
 }
 
 
@@ -137,32 +215,126 @@ eigrp_nbr_delete (struct eigrp_neighbor *nbr)
 
   eigrp_nbr_state_set(nbr, EIGRP_NEIGHBOR_DOWN);
   eigrp_topology_neighbor_down(nbr->ei->eigrp, nbr);
+  eigrp_topology_neighbor_unlink_all(nbr);
 
   /* Cancel all events. *//* Thread lookup cost would be negligible. */
   thread_cancel_event (master, nbr);
   eigrp_fifo_free (nbr->multicast_queue);
   eigrp_fifo_free (nbr->retrans_queue);
-  THREAD_OFF (nbr->t_holddown);
+  if (nbr->hello_ack)
+    eigrp_packet_free (nbr->hello_ack);
 
+  hash_release (nbr->ei->nbrs_hash, nbr);
+  eigrp_nbr_index_delete (nbr);
   listnode_delete (nbr->ei->nbrs,nbr);
   XFREE (MTYPE_EIGRP_NEIGHBOR, nbr);
 }
 
-int
-holddown_timer_expired (struct thread *thread)
+static void
+eigrp_nbr_holddown_expired (struct eigrp_neighbor *nbr)
 {
-  struct eigrp_neighbor *nbr;
-
-  nbr = THREAD_ARG (thread);
-
   zlog_info ("Neighbor %s (%s) is down: holding time expired",
 	     inet_ntoa(nbr->src), ifindex2ifname(nbr->ei->ifp->ifindex));
   nbr->state = EIGRP_NEIGHBOR_DOWN;
   eigrp_nbr_delete (nbr);
+}
+
+/* Run the hold time scan of the interface at the given expiry time. */
+static void
+eigrp_nbr_holddown_schedule (struct eigrp_interface *ei, struct timeval *when,
+                             struct timeval *now)
+{
+  unsigned long msec;
+
+  THREAD_OFF (ei->t_holddown);
+
+  msec = timercmp (when, now, >)
+         ? (timeval_elapsed (*when, *now) + 999) / 1000 : 0;
+  ei->holddown_next = *when;
+  ei->t_holddown = thread_add_timer_msec (master, eigrp_nbr_holddown_scan,
+                                          ei, msec);
+}
+
+/*
+ * Hold timers of the neighbors of an interface share a single thread,
+ * firing at the earliest expiry.  Hellos only push the expiry of their
+ * neighbor forward, see eigrp_nbr_holddown_refresh(), so the thread is
+ * rearmed here rather than per hello.
+ */
+int
+eigrp_nbr_holddown_scan (struct thread *thread)
+{
+  struct eigrp_interface *ei;
+  struct eigrp_neighbor *nbr;
+  struct listnode *node, *nnode;
+  struct timeval now, next;
+  int pending = 0;
+
+  ei = THREAD_ARG (thread);
+  ei->t_holddown = NULL;
+
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &now);
+
+  for (ALL_LIST_ELEMENTS (ei->nbrs, node, nnode, nbr))
+    {
+      if (!timerisset (&nbr->holddown))
+        continue;
+
+      if (!timercmp (&nbr->holddown, &now, >))
+        {
+          eigrp_nbr_holddown_expired (nbr);
+          continue;
+        }
+
+      if (!pending || timercmp (&nbr->holddown, &next, <))
+        next = nbr->holddown;
+      pending = 1;
+    }
+
+  if (pending)
+    eigrp_nbr_holddown_schedule (ei, &next, &now);
 
   return 0;
 }
 
+/* Hello heard from the neighbor, restart its hold time. */
+void
+eigrp_nbr_holddown_refresh (struct eigrp_neighbor *nbr)
+{
+  struct eigrp_interface *ei = nbr->ei;
+  struct timeval now;
+
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &now);
+
+  nbr->holddown.tv_sec = now.tv_sec + nbr->v_holddown / 1000;
+  nbr->holddown.tv_usec = now.tv_usec + (nbr->v_holddown % 1000) * 1000;
+  if (nbr->holddown.tv_usec >= 1000000)
+    {
+      nbr->holddown.tv_sec++;
+      nbr->holddown.tv_usec -= 1000000;
+    }
+
+  /* the scan picks up later expiries by itself */
+  if (ei->t_holddown == NULL || timercmp (&nbr->holddown, &ei->holddown_next, <))
+    eigrp_nbr_holddown_schedule (ei, &nbr->holddown, &now);
+}
+
+/* Seconds until the hold time of the neighbor expires. */
+unsigned long
+eigrp_nbr_holddown_remain (struct eigrp_neighbor *nbr)
+{
+  struct timeval now;
+
+  if (!timerisset (&nbr->holddown))
+    return 0;
+
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &now);
+  if (!timercmp (&nbr->holddown, &now, >))
+    return 0;
+
+  return timeval_elapsed (nbr->holddown, now) / 1000000;
+}
+
 u_char
 eigrp_nbr_state_get (struct eigrp_neighbor *nbr)
 {
@@ -189,10 +361,17 @@ eigrp_nbr_state_set (struct eigrp_neighbor *nbr, u_char state)
       nbr->K4 = EIGRP_K4_DEFAULT;
       nbr->K5 = EIGRP_K5_DEFAULT;
       nbr->K6 = EIGRP_K6_DEFAULT;
+      nbr->stub = 0;
+      nbr->cr_mode = 0;
 
       // hold time..
       nbr->v_holddown = EIGRP_HOLD_INTERVAL_DEFAULT;
-      THREAD_OFF(nbr->t_holddown);
+      timerclear(&nbr->holddown);
+
+      // retransmission
+      eigrp_rto_cancel(nbr);
+      nbr->srtt = nbr->rttvar = nbr->rtt_samples = 0;
+      nbr->rto = EIGRP_RTO_INITIAL;
 
       /* out with the old */
       if (nbr->multicast_queue)
@@ -242,25 +421,19 @@ eigrp_nbr_state_update (struct eigrp_neighbor *nbr)
     case EIGRP_NEIGHBOR_DOWN:
       {
 	/*Start Hold Down Timer for neighbor*/
-//	THREAD_OFF(nbr->t_holddown);
-//	THREAD_TIMER_ON(master, nbr->t_holddown, holddown_timer_expired,
-//			nbr, nbr->v_holddown);
+//	eigrp_nbr_holddown_refresh(nbr);
 	break;
       }
     case EIGRP_NEIGHBOR_PENDING:
       {
 	/*Reset Hold Down Timer for neighbor*/
-	THREAD_OFF(nbr->t_holddown);
-	THREAD_TIMER_ON(master, nbr->t_holddown, holddown_timer_expired, nbr,
-			nbr->v_holddown);
+	eigrp_nbr_holddown_refresh(nbr);
 	break;
       }
     case EIGRP_NEIGHBOR_UP:
       {
 	/*Reset Hold Down Timer for neighbor*/
-	THREAD_OFF(nbr->t_holddown);
-	THREAD_TIMER_ON(master, nbr->t_holddown, holddown_timer_expired, nbr,
-			nbr->v_holddown);
+	eigrp_nbr_holddown_refresh(nbr);
 	break;
       }
     }
@@ -285,7 +458,8 @@ int eigrp_nbr_count_get(void){
 	  {
 	    for (ALL_LIST_ELEMENTS(iface->nbrs, node2, nnode2, nbr))
 	      {
-	        if (nbr->state == EIGRP_NEIGHBOR_UP){
+	        /* stub neighbors are never queried, don't count them */
+	        if (nbr->state == EIGRP_NEIGHBOR_UP && !nbr->stub){
 	          counter++;
 	        }
 	      }
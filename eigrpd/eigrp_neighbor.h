@@ -36,7 +36,9 @@ extern struct eigrp_neighbor *eigrp_nbr_get(struct eigrp_interface *,
 extern struct eigrp_neighbor *eigrp_nbr_new (struct eigrp_interface *);
 extern void eigrp_nbr_delete(struct eigrp_neighbor *);
 
-extern int holddown_timer_expired(struct thread *);
+extern int eigrp_nbr_holddown_scan(struct thread *);
+extern void eigrp_nbr_holddown_refresh(struct eigrp_neighbor *);
+extern unsigned long eigrp_nbr_holddown_remain(struct eigrp_neighbor *);
 
 extern int eigrp_neighborship_check(struct eigrp_neighbor *,struct TLV_Parameter_Type *);
 extern void eigrp_nbr_state_update(struct eigrp_neighbor *);
@@ -45,6 +47,8 @@ extern u_char eigrp_nbr_state_get(struct eigrp_neighbor *);
 extern int eigrp_nbr_count_get(void);
 extern const char *eigrp_nbr_state_str(struct eigrp_neighbor *);
 extern struct eigrp_neighbor *eigrp_nbr_lookup_by_addr (struct eigrp_interface *, struct in_addr *);
+extern unsigned int eigrp_nbr_hash_key (void *);
+extern int eigrp_nbr_hash_cmp (const void *, const void *);
 
 
 #endif /* _ZEBRA_EIGRP_NEIGHBOR_H */
@@ -384,6 +384,20 @@ eigrp_network_unset(struct eigrp *eigrp, struct prefix_ipv4 *p)
   return 1;
 }
 
+/*
+ * Pick the metric formula for the K values of the instance, to be called
+ * whenever they change.  With the default (and most common) K values the
+ * load and reliability terms vanish, and so do the divisions.
+ */
+void
+eigrp_metric_kernel_update(struct eigrp *eigrp)
+{
+  if (!eigrp->k_values[1] && !eigrp->k_values[3] && !eigrp->k_values[4])
+    eigrp->metric_kernel = EIGRP_METRIC_KERNEL_LINEAR;
+  else
+    eigrp->metric_kernel = EIGRP_METRIC_KERNEL_GENERIC;
+}
+
 u_int32_t
 eigrp_calculate_metrics(struct eigrp *eigrp, struct eigrp_metrics *metric)
 {
@@ -393,6 +407,15 @@ eigrp_calculate_metrics(struct eigrp *eigrp, struct eigrp_metrics *metric)
   if(metric->delay == EIGRP_MAX_METRIC)
     return EIGRP_MAX_METRIC;
 
+  if (eigrp->metric_kernel == EIGRP_METRIC_KERNEL_LINEAR)
+    {
+      temp_metric = (u_int64_t) eigrp->k_values[0] * metric->bandwith
+          + (u_int64_t) eigrp->k_values[2] * metric->delay;
+
+      return temp_metric <= EIGRP_MAX_METRIC ?
+          (u_int32_t) temp_metric : EIGRP_MAX_METRIC;
+    }
+
   // EIGRP Metric = {K1*BW+[(K2*BW)/(256-load)]+(K3*delay)}*{K5/(reliability+K4)}
 
   if (eigrp->k_values[0])
@@ -422,11 +445,11 @@ eigrp_calculate_total_metrics(struct eigrp *eigrp,
 {
   entry->total_metric = entry->reported_metric;
   u_int64_t temp_delay = (u_int64_t) entry->total_metric.delay
-      + (u_int64_t) EIGRP_IF_PARAM (entry->ei, delay);
+      + (u_int64_t) entry->ei->cost_delay;
   entry->total_metric.delay =
       temp_delay > EIGRP_MAX_METRIC ? EIGRP_MAX_METRIC : (u_int32_t) temp_delay;
 
-  u_int32_t bw = EIGRP_IF_PARAM (entry->ei,bandwidth);
+  u_int32_t bw = entry->ei->cost_bandwidth;
   entry->total_metric.bandwith =
       entry->total_metric.bandwith > bw ? bw : entry->total_metric.bandwith;
 
@@ -449,10 +472,4 @@ eigrp_metrics_is_same(struct eigrp_metrics *metric1,
 
     return 0; // if different
 }
-void
-eigrp_external_routes_refresh (struct eigrp *eigrp, int type)
-{
-
-
-}
 
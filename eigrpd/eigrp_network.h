@@ -44,9 +44,9 @@ extern int eigrp_if_drop_allspfrouters (struct eigrp *top, struct prefix *p,
                                         unsigned int ifindex);
 extern void eigrp_adjust_sndbuflen (struct eigrp *, unsigned int);
 
+extern void eigrp_metric_kernel_update (struct eigrp *);
 extern u_int32_t eigrp_calculate_metrics (struct eigrp *, struct eigrp_metrics *);
 extern u_int32_t eigrp_calculate_total_metrics (struct eigrp *, struct eigrp_neighbor_entry *);
 extern u_char eigrp_metrics_is_same(struct eigrp_metrics *,struct eigrp_metrics *);
-extern void eigrp_external_routes_refresh (struct eigrp *, int);
 
 #endif /* EIGRP_NETWORK_H_ */
@@ -54,6 +54,7 @@
 #include "eigrpd/eigrp_network.h"
 #include "eigrpd/eigrp_topology.h"
 #include "eigrpd/eigrp_fsm.h"
+#include "eigrpd/eigrp_stats.h"
 
 /* Packet Type String. */
 const struct message eigrp_packet_type_str[] =
@@ -72,13 +73,14 @@ const struct message eigrp_packet_type_str[] =
 const size_t eigrp_packet_type_str_max = sizeof(eigrp_packet_type_str) /
   sizeof(eigrp_packet_type_str[0]);
 
-static unsigned char zeropad[16] = {0};
-
 /* Forward function reference*/
 static struct stream * eigrp_recv_packet (int, struct interface **, struct stream *);
 static int eigrp_verify_header (struct stream *, struct eigrp_interface *, struct ip *,
 				struct eigrp_header *);
 static int eigrp_check_network_mask (struct eigrp_interface *, struct in_addr);
+static void eigrp_packet_output (struct eigrp_interface *, struct eigrp_packet *);
+static void eigrp_rto_start (struct eigrp_neighbor *);
+static void eigrp_rto_ack (struct eigrp_neighbor *, struct eigrp_packet *);
 
 
 static int eigrp_retrans_count_exceeded(struct eigrp_packet *ep, struct eigrp_neighbor *nbr)
@@ -86,108 +88,147 @@ static int eigrp_retrans_count_exceeded(struct eigrp_packet *ep, struct eigrp_ne
   return 1;
 }
 
-int
-eigrp_make_md5_digest (struct eigrp_interface *ei, struct stream *s, u_char flags)
+/* HMAC-SHA-256 keyed for packets from src, pads applied */
+struct eigrp_auth_sha256
 {
+  HMAC_SHA256_CTX ctx;
+  struct in_addr src;
+  u_char valid;
+};
 
-  struct key *key;
-  struct keychain *keychain;
+/*
+ * Authentication state derived from one key of the interface key chain,
+ * so that the key material is not prepared again for every packet.  The
+ * key chain library has no change notification: the key string the state
+ * was built from is kept and compared on use.
+ */
+struct eigrp_auth_key
+{
+  u_int32_t index;              /* key id */
+  char *string;                 /* key string the state is built from */
 
-  unsigned char digest[EIGRP_AUTH_TYPE_MD5_LEN];
-  MD5_CTX ctx;
-  void *ibuf;
-  size_t backup_get, backup_end;
-  struct TLV_MD5_Authentication_Type *auth_TLV;
+  /* Keyed MD5: the key, zero padded to at least 16 bytes */
+  u_char *md5_key;
+  size_t md5_key_len;
 
-  ibuf = s->data;
-  backup_end = s->endp;
-  backup_get = s->getp;
+  /* HMAC-SHA-256 for what we send and for the last neighbor heard */
+  struct eigrp_auth_sha256 sha256_send;
+  struct eigrp_auth_sha256 sha256_recv;
+};
 
-  auth_TLV = eigrp_authTLV_MD5_new();
+static void
+eigrp_auth_key_free (void *arg)
+{
+  struct eigrp_auth_key *ak = arg;
 
-  stream_set_getp(s,EIGRP_HEADER_LEN);
-  stream_get(auth_TLV,s,EIGRP_AUTH_MD5_TLV_SIZE);
-  stream_set_getp(s, backup_get);
+  XFREE(MTYPE_EIGRP_AUTH_KEY, ak->string);
+  XFREE(MTYPE_EIGRP_AUTH_KEY, ak->md5_key);
+  XFREE(MTYPE_EIGRP_AUTH_KEY, ak);
+}
 
-  keychain = keychain_lookup(IF_DEF_PARAMS (ei->ifp)->auth_keychain);
-   if(keychain)
-     key = key_lookup_for_send(keychain);
-
-   memset(&ctx, 0, sizeof(ctx));
-   MD5Init(&ctx);
-
-   /* Generate a digest. Each situation needs different handling */
-   if(flags & EIGRP_AUTH_BASIC_HELLO_FLAG)
-     {
-       MD5Update(&ctx, ibuf, EIGRP_MD5_BASIC_COMPUTE);
-       MD5Update(&ctx, key->string, strlen(key->string));
-       if(strlen(key->string) < 16)
-         MD5Update(&ctx, zeropad, 16 - strlen(key->string));
-     }
-   else if(flags & EIGRP_AUTH_UPDATE_INIT_FLAG)
-     {
-       MD5Update(&ctx, ibuf, EIGRP_MD5_UPDATE_INIT_COMPUTE);
-     }
-   else if(flags & EIGRP_AUTH_UPDATE_FLAG)
-     {
-       MD5Update(&ctx, ibuf, EIGRP_MD5_BASIC_COMPUTE);
-       MD5Update(&ctx, key->string, strlen(key->string));
-       if(strlen(key->string) < 16)
-         MD5Update(&ctx, zeropad, 16 - strlen(key->string));
-       if(backup_end > (EIGRP_HEADER_LEN + EIGRP_AUTH_MD5_TLV_SIZE))
-         {
-           MD5Update(&ctx, ibuf + (EIGRP_HEADER_LEN + EIGRP_AUTH_MD5_TLV_SIZE),
-               backup_end - 20 - (EIGRP_HEADER_LEN + EIGRP_AUTH_MD5_TLV_SIZE));
-         }
-     }
-
-   MD5Final(digest, &ctx);
-
-  /* Append md5 digest to the end of the stream. */
-  memcpy(auth_TLV->digest,digest,EIGRP_AUTH_TYPE_MD5_LEN);
-
-  stream_set_endp(s,EIGRP_HEADER_LEN);
-  stream_put(s,auth_TLV,EIGRP_AUTH_MD5_TLV_SIZE);
-  stream_set_endp(s, backup_end);
-
-  eigrp_authTLV_MD5_free(auth_TLV);
-  return EIGRP_AUTH_TYPE_MD5_LEN;
+/* Drop the authentication state cached on the interface. */
+void
+eigrp_auth_key_flush (struct eigrp_interface *ei)
+{
+  if (ei->auth_keys)
+    {
+      list_delete(ei->auth_keys);
+      ei->auth_keys = NULL;
+    }
 }
 
-int
-eigrp_check_md5_digest (struct stream *s, struct TLV_MD5_Authentication_Type *authTLV,struct eigrp_neighbor *nbr, u_char flags)
+/* Key chain key the packets sent out of the interface are signed with. */
+struct key *
+eigrp_auth_send_key (struct eigrp_interface *ei)
 {
-  MD5_CTX ctx;
-  unsigned char digest[EIGRP_AUTH_TYPE_MD5_LEN];
-  struct key *key;
   struct keychain *keychain;
-  void *ibuf;
-  size_t backup_end;
-  struct TLV_MD5_Authentication_Type *auth_TLV;
-  struct eigrp_header *eigrph;
 
+  if (IF_DEF_PARAMS (ei->ifp)->auth_keychain == NULL)
+    return NULL;
 
-  if (nbr && ntohl(nbr->crypt_seqnum) > ntohl(authTLV->key_sequence))
+  keychain = keychain_lookup(IF_DEF_PARAMS (ei->ifp)->auth_keychain);
+  if (keychain == NULL)
+    return NULL;
+
+  return key_lookup_for_send(keychain);
+}
+
+static struct eigrp_auth_key *
+eigrp_auth_key_get (struct eigrp_interface *ei, struct key *key)
+{
+  struct eigrp_auth_key *ak;
+  struct listnode *node;
+  size_t len;
+
+  if (ei->auth_keys == NULL)
     {
-      zlog_warn ("interface %s: eigrp_check_md5 bad sequence %d (expect %d)",
-                 IF_NAME (nbr->ei),
-                 ntohl(authTLV->key_sequence),
-                 ntohl(nbr->crypt_seqnum));
-      return 0;
+      ei->auth_keys = list_new();
+      ei->auth_keys->del = eigrp_auth_key_free;
     }
 
-  eigrph = (struct eigrp_header *) s->data;
-  eigrph->checksum = 0;
+  for (ALL_LIST_ELEMENTS_RO(ei->auth_keys, node, ak))
+    if (ak->index == key->index)
+      {
+        if (strcmp(ak->string, key->string) == 0)
+          return ak;
 
-  auth_TLV =(struct TLV_MD5_Authentication_Type *) (s->data + EIGRP_HEADER_LEN);
-  memcpy(auth_TLV->digest, "0", sizeof(auth_TLV->digest));
+        /* key string changed */
+        listnode_delete(ei->auth_keys, ak);
+        eigrp_auth_key_free(ak);
+        break;
+      }
 
-  ibuf = s->data;
-  backup_end = s->endp;
+  ak = XCALLOC(MTYPE_EIGRP_AUTH_KEY, sizeof(struct eigrp_auth_key));
+  ak->index = key->index;
+  ak->string = XSTRDUP(MTYPE_EIGRP_AUTH_KEY, key->string);
 
-  keychain = keychain_lookup(IF_DEF_PARAMS (nbr->ei->ifp)->auth_keychain);
-     if(keychain)
-       key = key_lookup_for_send(keychain);
+  len = strlen(key->string);
+  ak->md5_key_len = MAX(len, 16);
+  ak->md5_key = XCALLOC(MTYPE_EIGRP_AUTH_KEY, ak->md5_key_len);
+  memcpy(ak->md5_key, key->string, len);
+
+  listnode_add(ei->auth_keys, ak);
+
+  return ak;
+}
+
+/*
+ * HMAC-SHA-256 state for packets from src, kept in sha, the HMAC key
+ * being a newline, the key string and src in dotted decimal notation.
+ */
+static HMAC_SHA256_CTX *
+eigrp_auth_key_sha256 (struct eigrp_auth_key *ak, struct eigrp_auth_sha256 *sha,
+                       struct in_addr src)
+{
+  unsigned char buffer[1 + PLAINTEXT_LENGTH + INET_ADDRSTRLEN + 1];
+  char source_ip[INET_ADDRSTRLEN];
+  size_t keylen, iplen;
+
+  if (sha->valid && sha->src.s_addr == src.s_addr)
+    return &sha->ctx;
+
+  inet_ntop(AF_INET, &src, source_ip, sizeof(source_ip));
+  keylen = MIN(strlen(ak->string), PLAINTEXT_LENGTH);
+  iplen = strlen(source_ip);
+
+  buffer[0] = '\n';
+  memcpy(buffer + 1, ak->string, keylen);
+  memcpy(buffer + 1 + keylen, source_ip, iplen);
+
+  memset(&sha->ctx, 0, sizeof(sha->ctx));
+  HMAC__SHA256_Init(&sha->ctx, buffer, 1 + keylen + iplen);
+  sha->src = src;
+  sha->valid = 1;
+
+  return &sha->ctx;
+}
+
+/* Keyed MD5 of the packet in ibuf, as each situation needs it. */
+static void
+eigrp_md5_compute (struct eigrp_auth_key *ak, u_char *ibuf, size_t length,
+                   u_char flags, unsigned char *digest)
+{
+  MD5_CTX ctx;
 
   memset(&ctx, 0, sizeof(ctx));
   MD5Init(&ctx);
@@ -196,9 +237,7 @@ eigrp_check_md5_digest (struct stream *s, struct TLV_MD5_Authentication_Type *au
   if(flags & EIGRP_AUTH_BASIC_HELLO_FLAG)
     {
       MD5Update(&ctx, ibuf, EIGRP_MD5_BASIC_COMPUTE);
-      MD5Update(&ctx, key->string, strlen(key->string));
-      if(strlen(key->string) < 16)
-        MD5Update(&ctx, zeropad, 16 - strlen(key->string));
+      MD5Update(&ctx, ak->md5_key, ak->md5_key_len);
     }
   else if(flags & EIGRP_AUTH_UPDATE_INIT_FLAG)
     {
@@ -207,24 +246,79 @@ eigrp_check_md5_digest (struct stream *s, struct TLV_MD5_Authentication_Type *au
   else if(flags & EIGRP_AUTH_UPDATE_FLAG)
     {
       MD5Update(&ctx, ibuf, EIGRP_MD5_BASIC_COMPUTE);
-      MD5Update(&ctx, key->string, strlen(key->string));
-      if(strlen(key->string) < 16)
-        MD5Update(&ctx, zeropad, 16 - strlen(key->string));
-      if(backup_end > (EIGRP_HEADER_LEN + EIGRP_AUTH_MD5_TLV_SIZE))
+      MD5Update(&ctx, ak->md5_key, ak->md5_key_len);
+      if(length > (EIGRP_HEADER_LEN + EIGRP_AUTH_MD5_TLV_SIZE))
         {
           MD5Update(&ctx, ibuf + (EIGRP_HEADER_LEN + EIGRP_AUTH_MD5_TLV_SIZE),
-              backup_end - 20 - (EIGRP_HEADER_LEN + EIGRP_AUTH_MD5_TLV_SIZE));
+              length - 20 - (EIGRP_HEADER_LEN + EIGRP_AUTH_MD5_TLV_SIZE));
         }
     }
 
   MD5Final(digest, &ctx);
+}
 
-  /* compare the two */
-  if (memcmp (authTLV->digest, digest, EIGRP_AUTH_TYPE_MD5_LEN) == 0)
+int
+eigrp_make_md5_digest (struct eigrp_interface *ei, struct stream *s, u_char flags)
+{
+  struct key *key;
+  struct eigrp_auth_key *ak;
+  struct TLV_MD5_Authentication_Type *auth_TLV;
+
+  key = eigrp_auth_send_key(ei);
+  if (key == NULL)
+    return 0;
+  ak = eigrp_auth_key_get(ei, key);
+
+  /* digest goes straight into the Authentication TLV of the packet */
+  auth_TLV = (struct TLV_MD5_Authentication_Type *) (s->data + EIGRP_HEADER_LEN);
+  eigrp_md5_compute(ak, s->data, stream_get_endp(s), flags, auth_TLV->digest);
+
+  return EIGRP_AUTH_TYPE_MD5_LEN;
+}
+
+int
+eigrp_check_md5_digest (struct stream *s, struct TLV_MD5_Authentication_Type *authTLV,struct eigrp_neighbor *nbr, u_char flags)
+{
+  unsigned char digest[EIGRP_AUTH_TYPE_MD5_LEN];
+  unsigned char received[EIGRP_AUTH_TYPE_MD5_LEN];
+  struct keychain *keychain;
+  struct key *key;
+  struct eigrp_auth_key *ak;
+  struct eigrp_header *eigrph;
+  size_t length;
+
+  if (nbr && ntohl(nbr->crypt_seqnum) > ntohl(authTLV->key_sequence))
     {
-      zlog_debug("VSETKO OK");
+      zlog_warn ("interface %s: eigrp_check_md5 bad sequence %d (expect %d)",
+                 IF_NAME (nbr->ei),
+                 ntohl(authTLV->key_sequence),
+                 ntohl(nbr->crypt_seqnum));
+      return 0;
     }
-  else
+
+  keychain = keychain_lookup(IF_DEF_PARAMS (nbr->ei->ifp)->auth_keychain);
+  key = keychain ? key_lookup_for_accept(keychain, ntohl(authTLV->key_id)) : NULL;
+  if (key == NULL)
+    {
+      zlog_warn ("interface %s: eigrp_check_md5 no key %u to accept",
+                 IF_NAME (nbr->ei), ntohl(authTLV->key_id));
+      return 0;
+    }
+  ak = eigrp_auth_key_get(nbr->ei, key);
+
+  /* digest is computed with the digest field zeroed */
+  memcpy(received, authTLV->digest, sizeof(received));
+
+  /* s holds the IP header too, the TLV follows the EIGRP header */
+  eigrph = (struct eigrp_header *) ((u_char *) authTLV - EIGRP_HEADER_LEN);
+  length = stream_get_endp(s) - ((u_char *) eigrph - s->data);
+  eigrph->checksum = 0;
+  memset(authTLV->digest, 0, sizeof(authTLV->digest));
+
+  eigrp_md5_compute(ak, (u_char *) eigrph, length, flags, digest);
+
+  /* compare the two */
+  if (memcmp (received, digest, EIGRP_AUTH_TYPE_MD5_LEN) != 0)
     {
       zlog_warn ("interface %s: eigrp_check_md5 checksum mismatch",
                        IF_NAME (nbr->ei));
@@ -256,65 +350,82 @@ strnzcpyn(char *dst, const char *src, int size)
 int
 eigrp_make_sha256_digest (struct eigrp_interface *ei, struct stream *s, u_char flags)
 {
-    struct key *key;
-    struct keychain *keychain;
-    char *source_ip;
-    int saved_len;
-    char saved_key[PLAINTEXT_LENGTH + 1];
-
+  struct key *key;
+  struct eigrp_auth_key *ak;
+  HMAC_SHA256_CTX ctx;
+  struct TLV_SHA256_Authentication_Type *auth_TLV;
 
-    unsigned char digest[EIGRP_AUTH_TYPE_SHA256_LEN];
-    unsigned char buffer[1 + PLAINTEXT_LENGTH + 45 + 1] = { 0 };
-    HMAC_SHA256_CTX ctx;
-    void *ibuf;
-    size_t backup_get, backup_end;
-    struct TLV_SHA256_Authentication_Type *auth_TLV;
+  key = eigrp_auth_send_key(ei);
+  if (key == NULL)
+    return 0;
+  ak = eigrp_auth_key_get(ei, key);
 
-    ibuf = s->data;
-    backup_end = s->endp;
-    backup_get = s->getp;
+  auth_TLV = (struct TLV_SHA256_Authentication_Type *) (s->data + EIGRP_HEADER_LEN);
+  memset(auth_TLV->digest, 0, sizeof(auth_TLV->digest));
 
-    auth_TLV = eigrp_authTLV_SHA256_new ();
+  /* only the packet itself is hashed, the key is in the saved state */
+  ctx = *eigrp_auth_key_sha256(ak, &ak->sha256_send, ei->address->u.prefix4);
+  HMAC__SHA256_Update(&ctx, s->data, stream_get_endp(s));
 
-    stream_set_getp(s,EIGRP_HEADER_LEN);
-    stream_get(auth_TLV,s,EIGRP_AUTH_SHA256_TLV_SIZE);
-    stream_set_getp(s, backup_get);
+  /* Put hmac-sha256 digest to it's place */
+  HMAC__SHA256_Final(auth_TLV->digest, &ctx);
 
-    keychain = keychain_lookup(IF_DEF_PARAMS (ei->ifp)->auth_keychain);
-     if(keychain)
-       key = key_lookup_for_send(keychain);
+  return EIGRP_AUTH_TYPE_SHA256_LEN;
+}
 
-//     saved_len[index] = strnzcpyn(saved_key[index], key,
-//                             PLAINTEXT_LENGTH + 1);
+int
+eigrp_check_sha256_digest (struct stream *s, struct TLV_SHA256_Authentication_Type *authTLV,struct eigrp_neighbor *nbr, u_char flags)
+{
+  unsigned char digest[EIGRP_AUTH_TYPE_SHA256_LEN];
+  unsigned char received[EIGRP_AUTH_TYPE_SHA256_LEN];
+  struct keychain *keychain;
+  struct key *key;
+  struct eigrp_auth_key *ak;
+  struct eigrp_header *eigrph;
+  HMAC_SHA256_CTX ctx;
+  size_t length;
 
-     source_ip = calloc(16, sizeof(char));
-     inet_ntop(AF_INET, &ei->address->u.prefix4, source_ip, 16);
+  if (ntohl(nbr->crypt_seqnum) > ntohl(authTLV->key_sequence))
+    {
+      zlog_warn ("interface %s: eigrp_check_sha256 bad sequence %d (expect %d)",
+                 IF_NAME (nbr->ei),
+                 ntohl(authTLV->key_sequence),
+                 ntohl(nbr->crypt_seqnum));
+      return 0;
+    }
 
-     memset(&ctx, 0, sizeof(ctx));
-     buffer[0] = '\n';
-     memcpy(buffer + 1, key, strlen (key->string));
-     memcpy(buffer + 1 + strlen(key->string), source_ip, strlen(source_ip));
-     HMAC__SHA256_Init(&ctx, buffer, 1 + strlen (key->string) + strlen(source_ip));
-     HMAC__SHA256_Update(&ctx, ibuf, strlen(ibuf));
-     HMAC__SHA256_Final(digest, &ctx);
+  keychain = keychain_lookup(IF_DEF_PARAMS (nbr->ei->ifp)->auth_keychain);
+  key = keychain ? key_lookup_for_accept(keychain, ntohl(authTLV->key_id)) : NULL;
+  if (key == NULL)
+    {
+      zlog_warn ("interface %s: eigrp_check_sha256 no key %u to accept",
+                 IF_NAME (nbr->ei), ntohl(authTLV->key_id));
+      return 0;
+    }
+  ak = eigrp_auth_key_get(nbr->ei, key);
 
+  /* digest is computed with the digest field zeroed */
+  memcpy(received, authTLV->digest, sizeof(received));
 
-     /* Put hmac-sha256 digest to it's place */
-     memcpy(auth_TLV->digest,digest,EIGRP_AUTH_TYPE_SHA256_LEN);
+  /* s holds the IP header too, the TLV follows the EIGRP header */
+  eigrph = (struct eigrp_header *) ((u_char *) authTLV - EIGRP_HEADER_LEN);
+  length = stream_get_endp(s) - ((u_char *) eigrph - s->data);
+  eigrph->checksum = 0;
+  memset(authTLV->digest, 0, sizeof(authTLV->digest));
 
-     stream_set_endp(s,EIGRP_HEADER_LEN);
-     stream_put(s,auth_TLV,EIGRP_AUTH_SHA256_TLV_SIZE);
-     stream_set_endp(s, backup_end);
+  /* the neighbor keyed it with its own address */
+  ctx = *eigrp_auth_key_sha256(ak, &ak->sha256_recv, nbr->src);
+  HMAC__SHA256_Update(&ctx, (u_char *) eigrph, length);
+  HMAC__SHA256_Final(digest, &ctx);
 
-     eigrp_authTLV_SHA256_free(auth_TLV);
-     free(source_ip);
+  if (memcmp (received, digest, EIGRP_AUTH_TYPE_SHA256_LEN) != 0)
+    {
+      zlog_warn ("interface %s: eigrp_check_sha256 digest mismatch",
+                 IF_NAME (nbr->ei));
+      return 0;
+    }
 
-    return EIGRP_AUTH_TYPE_SHA256_LEN;
-}
-
-int
-eigrp_check_sha256_digest (struct stream *s, struct TLV_SHA256_Authentication_Type *authTLV,struct eigrp_neighbor *nbr, u_char flags)
-{
+  nbr->crypt_seqnum = authTLV->key_sequence;
 
   return 1;
 }
@@ -386,8 +497,9 @@ eigrp_write (struct thread *thread)
   ipid = (time(NULL) & 0xffff);
 #endif /* WANT_EIGRP_WRITE_FRAGMENT */
 
-  /* Get one packet from queue. */
-  ep = eigrp_fifo_head(ei->obuf);
+  /* Get the oldest packet from queue, reliable packets must go out
+   * in sequence. */
+  ep = eigrp_fifo_tail(ei->obuf);
   assert(ep);
   assert(ep->length >= EIGRP_HEADER_LEN);
 
@@ -439,7 +551,7 @@ eigrp_write (struct thread *thread)
 
   iov[0].iov_base = (char*)&iph;
   iov[0].iov_len = iph.ip_hl << EIGRP_WRITE_IPHL_SHIFT;
-  iov[1].iov_base = STREAM_PNT(ep->s);
+  iov[1].iov_base = STREAM_DATA(ep->s);
   iov[1].iov_len = ep->length;
 
   /* send final fragment (could be first) */
@@ -492,17 +604,8 @@ eigrp_write (struct thread *thread)
 int
 eigrp_read (struct thread *thread)
 {
-  int ret;
-  struct stream *ibuf;
   struct eigrp *eigrp;
-  struct eigrp_interface *ei;
-  struct ip *iph;
-  struct eigrp_header *eigrph;
   struct interface *ifp;
-  struct eigrp_neighbor *nbr;
-
-  u_int16_t opcode = 0;
-  u_int16_t length = 0;
 
   /* first of all get interface pointer. */
   eigrp = THREAD_ARG(thread);
@@ -511,12 +614,36 @@ eigrp_read (struct thread *thread)
   eigrp->t_read = thread_add_read(master, eigrp_read, eigrp, eigrp->fd);
 
   stream_reset(eigrp->ibuf);
-  if (!(ibuf = eigrp_recv_packet(eigrp->fd, &ifp, eigrp->ibuf)))
+  if (!eigrp_recv_packet(eigrp->fd, &ifp, eigrp->ibuf))
     {
       /* This raw packet is known to be at least as big as its IP header. */
       return -1;
     }
 
+  return eigrp_packet_ingest(eigrp, eigrp->ibuf, ifp);
+}
+
+/*
+ * Process one received packet.  ibuf holds the whole IP datagram from
+ * its start, with the IP header fields in host byte order as left by
+ * eigrp_recv_packet().  ifp is the interface it came in on, or NULL if
+ * unknown.  Does no socket I/O of its own, so packets from elsewhere,
+ * e.g. a capture file, can be fed in as well.
+ */
+int
+eigrp_packet_ingest (struct eigrp *eigrp, struct stream *ibuf,
+                     struct interface *ifp)
+{
+  int ret;
+  struct eigrp_interface *ei;
+  struct ip *iph;
+  struct eigrp_header *eigrph;
+  struct eigrp_neighbor *nbr;
+
+  u_int16_t opcode = 0;
+  u_int16_t length = 0;
+  struct timeval start;
+
   /* Note that there should not be alignment problems with this assignment
    because this is at the beginning of the stream data buffer. */
   iph = (struct ip *)STREAM_DATA(ibuf);
@@ -642,6 +769,23 @@ eigrp_read (struct thread *thread)
 	       LOOKUP(eigrp_packet_type_str, opcode), length,
 	       IF_NAME(ei), inet_ntoa(iph->ip_src), inet_ntoa(iph->ip_dst));
 
+  /* Multicast sent in conditional receive mode is only for neighbors told
+   * to expect it by the Sequence TLV of the Hello before it */
+  if ((ntohl(eigrph->flags) & EIGRP_CR_FLAG)
+      && iph->ip_dst.s_addr == htonl(EIGRP_MULTICAST_ADDRESS))
+    {
+      nbr = eigrp_nbr_lookup_by_addr(ei, &iph->ip_src);
+      if (nbr == NULL || !nbr->cr_mode
+          || nbr->cr_sequence != ntohl(eigrph->sequence))
+        {
+          if (IS_DEBUG_EIGRP_TRANSMIT(0, RECV))
+            zlog_debug("eigrp_read[%s]: Not in CR mode, dropping.",
+                       inet_ntoa(iph->ip_src));
+          return 0;
+        }
+      nbr->cr_mode = 0;
+    }
+
   /* Read rest of the packet and call each sort of packet routine. */
   stream_forward_getp(ibuf, EIGRP_HEADER_LEN);
 
@@ -669,8 +813,9 @@ eigrp_read (struct thread *thread)
                  nbr->recv_sequence_number = ntohl(eigrph->sequence);
                  eigrp_update_send_EOT(nbr);
                }
+             eigrp_rto_ack(nbr, ep);
              ep = eigrp_fifo_pop_tail(nbr->retrans_queue);
-             /*eigrp_packet_free(ep);*/
+             eigrp_packet_free(ep);
              if (nbr->retrans_queue->count > 0)
                {
                  eigrp_send_packet_reliably(nbr);
@@ -693,6 +838,12 @@ eigrp_read (struct thread *thread)
     }
 
 
+  quagga_gettime(QUAGGA_CLK_MONOTONIC, &start);
+
+  /* flush what other interfaces changed before DUAL runs for this one */
+  if (opcode != EIGRP_OPC_HELLO)
+    eigrp_dual_flush_prepare(eigrp, ei);
+
   switch (opcode)
     {
     case EIGRP_OPC_HELLO:
@@ -723,9 +874,12 @@ eigrp_read (struct thread *thread)
       zlog(NULL, LOG_WARNING,
 	    "interface %s: EIGRP packet header type %d unsupported",
 	    IF_NAME(ei), opcode);
-      break;
+      return 0;
     }
 
+  eigrp_histogram_add(&eigrp->stats.recv_time[opcode],
+                      eigrp_stats_elapsed(&start));
+
   return 0;
 }
 
@@ -857,7 +1011,10 @@ eigrp_packet_new (size_t size)
   struct eigrp_packet *new;
 
   new = XCALLOC(MTYPE_EIGRP_PACKET, sizeof(struct eigrp_packet));
-  new->s = stream_new(size);
+  new->data = XCALLOC(MTYPE_EIGRP_PACKET_DATA, sizeof(struct eigrp_packet_data));
+  new->data->s = stream_new(size);
+  new->data->refcnt = 1;
+  new->s = new->data->s;
   new->retrans_counter = 0;
 
   return new;
@@ -878,11 +1035,7 @@ eigrp_send_packet_reliably (struct eigrp_neighbor *nbr)
       eigrp_fifo_push_head(nbr->ei->obuf, duplicate);
 
       /*Start retransmission timer*/
-      THREAD_TIMER_ON(master, ep->t_retrans_timer, eigrp_unack_packet_retrans,
-          nbr, EIGRP_PACKET_RETRANS_TIME);
-
-      /*Increment sequence number counter*/
-      nbr->ei->eigrp->sequence_number++;
+      eigrp_rto_start(nbr);
 
       /* Hook thread to write packet. */
       if (nbr->ei->on_write_q == 0)
@@ -896,6 +1049,190 @@ eigrp_send_packet_reliably (struct eigrp_neighbor *nbr)
     }
 }
 
+/* Queue packet for output on the interface and kick the write thread. */
+static void
+eigrp_packet_output (struct eigrp_interface *ei, struct eigrp_packet *ep)
+{
+  eigrp_fifo_push_head(ei->obuf, ep);
+
+  if (ei->on_write_q == 0)
+    {
+      listnode_add(ei->eigrp->oi_write_q, ei);
+      ei->on_write_q = 1;
+    }
+  if (ei->eigrp->t_write == NULL)
+    ei->eigrp->t_write =
+        thread_add_write(master, eigrp_write, ei->eigrp, ei->eigrp->fd);
+}
+
+/*
+ * Copy of the multicast packet with the conditional receive flag set and
+ * signature and checksum redone.  The original stays as it is, unicast
+ * retransmissions go out without the flag.
+ */
+static struct eigrp_packet *
+eigrp_packet_cr_copy (struct eigrp_interface *ei, struct eigrp_packet *ep)
+{
+  struct eigrp_packet *cr;
+  struct eigrp_header *eigrph;
+
+  cr = XCALLOC(MTYPE_EIGRP_PACKET, sizeof(struct eigrp_packet));
+  cr->data = XCALLOC(MTYPE_EIGRP_PACKET_DATA, sizeof(struct eigrp_packet_data));
+  cr->data->s = stream_dup(ep->s);
+  cr->data->refcnt = 1;
+  cr->s = cr->data->s;
+  cr->length = ep->length;
+  cr->dst = ep->dst;
+  cr->sequence_number = ep->sequence_number;
+
+  eigrph = (struct eigrp_header *) STREAM_DATA(cr->s);
+  eigrph->flags = htonl(ntohl(eigrph->flags) | EIGRP_CR_FLAG);
+  eigrph->checksum = 0;
+
+  if((IF_DEF_PARAMS (ei->ifp)->auth_type == EIGRP_AUTH_TYPE_MD5) && (IF_DEF_PARAMS (ei->ifp)->auth_keychain != NULL))
+    {
+      eigrp_make_md5_digest(ei, cr->s, EIGRP_AUTH_UPDATE_FLAG);
+    }
+
+  eigrp_packet_checksum(ei, cr->s, cr->length);
+
+  return cr;
+}
+
+/*
+ * Send reliable packet to every neighbor which is up on the interface,
+ * using reliable multicast.  Consumes ep.
+ *
+ * Each neighbor gets its own eigrp_packet in its retransmission queue,
+ * all of them sharing the encoded data and addressed to the neighbor.
+ * A neighbor has only the oldest packet of its queue in flight, the ack
+ * for it releases the next one.  Neighbors with nothing else in flight
+ * are sent the packet by a single multicast, with only their
+ * retransmissions going unicast.  Neighbors still busy with older packets
+ * get it unicast when its turn comes; while there are any, the multicast
+ * is sent in conditional receive mode, announced by a Hello telling them
+ * to ignore it.
+ *
+ * Non zero serno is the newest topology change carried by the packet:
+ * neighbors which already have it (from their initial Update exchange)
+ * are skipped, the others move their cursor up to it.
+ */
+void
+eigrp_send_packet_reliably_all (struct eigrp_interface *ei,
+				struct eigrp_packet *ep, u_int64_t serno)
+{
+  struct eigrp_neighbor *nbr;
+  struct eigrp_packet *dup;
+  struct listnode *node, *nnode;
+  unsigned int receivers = 0;
+
+  for (ALL_LIST_ELEMENTS(ei->nbrs, node, nnode, nbr))
+    {
+      if (nbr->state != EIGRP_NEIGHBOR_UP)
+        continue;
+
+      if (serno)
+        {
+          if (nbr->serno_last_update >= serno)
+            continue;
+          nbr->serno_last_update = serno;
+        }
+
+      /*Put packet to retransmission queue*/
+      dup = eigrp_packet_duplicate(ep, nbr);
+      dup->dst = nbr->src;
+      eigrp_fifo_push_head(nbr->retrans_queue, dup);
+
+      if (nbr->retrans_queue->count == 1)
+        {
+          /* in flight with the multicast below */
+          eigrp_rto_start(nbr);
+          receivers++;
+        }
+    }
+
+  if (receivers == 0)
+    {
+      eigrp_packet_free(ep);
+      return;
+    }
+
+  if (receivers < listcount(ei->nbrs))
+    {
+      eigrp_hello_send_sequence(ei, ep->sequence_number);
+      eigrp_packet_output(ei, eigrp_packet_cr_copy(ei, ep));
+      eigrp_packet_free(ep);
+    }
+  else
+    eigrp_packet_output(ei, ep);
+}
+
+/*
+ * Start reliable packet of given type on interface: EIGRP header and the
+ * authentication TLV, if one is configured, are put in place and
+ * ep->length accounts for them.  Route TLVs are appended by the caller.
+ */
+struct eigrp_packet *
+eigrp_packet_reliable_new (int type, struct eigrp_interface *ei, u_int32_t ack)
+{
+  struct eigrp_packet *ep;
+
+  ep = eigrp_packet_new(ei->ifp->mtu);
+
+  eigrp_packet_header_init(type, ei, ep->s, 0, ei->eigrp->sequence_number,
+                           ack);
+  ep->length = EIGRP_HEADER_LEN;
+
+  // encode Authentication TLV, if needed
+  if((IF_DEF_PARAMS (ei->ifp)->auth_type == EIGRP_AUTH_TYPE_MD5) && (IF_DEF_PARAMS (ei->ifp)->auth_keychain != NULL))
+    {
+      ep->length += eigrp_add_authTLV_MD5_to_stream(ep->s, ei);
+    }
+
+  return ep;
+}
+
+/*
+ * Finish packet started by eigrp_packet_reliable_new(): set header flags,
+ * sign and checksum it and consume the sequence number it carries.  The
+ * number is taken only now, as other packets may have been sent while
+ * this one was being filled.
+ */
+void
+eigrp_packet_reliable_finish (struct eigrp_interface *ei,
+			      struct eigrp_packet *ep, u_int32_t flags)
+{
+  struct eigrp_header *eigrph;
+
+  eigrph = (struct eigrp_header *) STREAM_DATA(ep->s);
+  eigrph->flags = htonl(flags);
+  eigrph->sequence = htonl(ei->eigrp->sequence_number);
+
+  if((IF_DEF_PARAMS (ei->ifp)->auth_type == EIGRP_AUTH_TYPE_MD5) && (IF_DEF_PARAMS (ei->ifp)->auth_keychain != NULL))
+    {
+      eigrp_make_md5_digest(ei, ep->s, EIGRP_AUTH_UPDATE_FLAG);
+    }
+
+  /* EIGRP Checksum */
+  eigrp_packet_checksum(ei, ep->s, ep->length);
+
+  /*This ack number we await from neighbor*/
+  ep->sequence_number = ei->eigrp->sequence_number++;
+}
+
+/*
+ * Largest EIGRP packet, authentication TLV included, which fits into the
+ * interface MTU together with the IP header.
+ */
+u_int16_t
+eigrp_packet_max_len (struct eigrp_interface *ei)
+{
+  if (ei->ifp->mtu <= sizeof(struct ip) + EIGRP_HEADER_LEN)
+    return EIGRP_HEADER_LEN;
+
+  return MIN(ei->ifp->mtu, EIGRP_PACKET_MAX_LEN) - sizeof(struct ip);
+}
+
 /* Calculate EIGRP checksum */
 void
 eigrp_packet_checksum (struct eigrp_interface *ei, struct stream *s,
@@ -953,6 +1290,28 @@ eigrp_fifo_push_head (struct eigrp_fifo *fifo, struct eigrp_packet *ep)
   fifo->head = ep;
 
   fifo->count++;
+  if (fifo->count > fifo->count_max)
+    fifo->count_max = fifo->count;
+}
+
+/* Add new packet to tail of fifo, it is the next one out. */
+void
+eigrp_fifo_push_tail (struct eigrp_fifo *fifo, struct eigrp_packet *ep)
+{
+  ep->next = NULL;
+  ep->previous = fifo->tail;
+
+  if (fifo->head == NULL)
+    fifo->head = ep;
+
+  if (fifo->count != 0)
+    fifo->tail->next = ep;
+
+  fifo->tail = ep;
+
+  fifo->count++;
+  if (fifo->count > fifo->count_max)
+    fifo->count_max = fifo->count;
 }
 
 /* Return first fifo entry. */
@@ -974,7 +1333,7 @@ eigrp_packet_delete (struct eigrp_interface *ei)
 {
   struct eigrp_packet *ep;
 
-  ep = eigrp_fifo_pop (ei->obuf);
+  ep = eigrp_fifo_pop_tail (ei->obuf);
 
   if (ep)
     eigrp_packet_free(ep);
@@ -1006,10 +1365,11 @@ eigrp_fifo_pop (struct eigrp_fifo *fifo)
 void
 eigrp_packet_free (struct eigrp_packet *ep)
 {
-  if (ep->s)
-    stream_free(ep->s);
-
-  THREAD_OFF(ep->t_retrans_timer);
+  if (ep->data && --ep->data->refcnt == 0)
+    {
+      stream_free(ep->data->s);
+      XFREE(MTYPE_EIGRP_PACKET_DATA, ep->data);
+    }
 
   XFREE(MTYPE_EIGRP_PACKET, ep);
 
@@ -1059,81 +1419,161 @@ eigrp_check_network_mask (struct eigrp_interface *ei, struct in_addr ip_src)
   return 0;
 }
 
-int
-eigrp_unack_packet_retrans (struct thread *thread)
+/* Retransmit the in-flight packet of the neighbor, its RTO has expired. */
+static void
+eigrp_packet_retrans (struct eigrp_neighbor *nbr)
 {
-  struct eigrp_neighbor *nbr;
-  nbr = (struct eigrp_neighbor *) THREAD_ARG(thread);
-
   struct eigrp_packet *ep;
+  u_int32_t timeout;
+
   ep = eigrp_fifo_tail(nbr->retrans_queue);
 
   if (ep)
     {
-      struct eigrp_packet *duplicate;
-      duplicate = eigrp_packet_duplicate(ep, nbr);
-
-      /* Add packet to the top of the interface output queue*/
-      eigrp_fifo_push_head(nbr->ei->obuf, duplicate);
+      eigrp_packet_output(nbr->ei, eigrp_packet_duplicate(ep, nbr));
+      nbr->retrans_sent++;
+      nbr->ei->eigrp->stats.retransmissions++;
 
       ep->retrans_counter++;
       if(ep->retrans_counter == EIGRP_PACKET_RETRANS_MAX)
-        return eigrp_retrans_count_exceeded(ep, nbr);
-
-      /*Start retransmission timer*/
-      ep->t_retrans_timer =
-          thread_add_timer(master, eigrp_unack_packet_retrans, nbr,EIGRP_PACKET_RETRANS_TIME);
-
-      /* Hook thread to write packet. */
-      if (nbr->ei->on_write_q == 0)
         {
-          listnode_add(nbr->ei->eigrp->oi_write_q, nbr->ei);
-          nbr->ei->on_write_q = 1;
+          eigrp_retrans_count_exceeded(ep, nbr);
+          return;
         }
-      if (nbr->ei->eigrp->t_write == NULL)
-        nbr->ei->eigrp->t_write =
-            thread_add_write(master, eigrp_write, nbr->ei->eigrp, nbr->ei->eigrp->fd);
-    }
 
-  return 0;
+      /* exponential backoff, the RTO itself is left to the next sample */
+      timeout = nbr->rto << MIN(ep->retrans_counter, 5);
+      eigrp_rto_arm(nbr, MIN(timeout, EIGRP_RTO_MAX));
+    }
 }
 
-int
-eigrp_unack_multicast_packet_retrans (struct thread *thread)
+static int
+eigrp_rto_wheel_tick (struct thread *thread)
 {
+  struct eigrp *eigrp = THREAD_ARG(thread);
+  struct eigrp_rto_wheel *wheel = &eigrp->rto_wheel;
   struct eigrp_neighbor *nbr;
-  nbr = (struct eigrp_neighbor *) THREAD_ARG(thread);
+  u_int32_t slot;
 
-  struct eigrp_packet *ep;
-  ep = eigrp_fifo_tail(nbr->multicast_queue);
+  wheel->t_tick = NULL;
 
-  if (ep)
+  slot = wheel->current;
+  wheel->current = (wheel->current + 1) % EIGRP_RTO_WHEEL_SLOTS;
+
+  /* re-arming never lands in the slot being drained, see eigrp_rto_arm */
+  while ((nbr = wheel->slots[slot]) != NULL)
     {
-      struct eigrp_packet *duplicate;
-      duplicate = eigrp_packet_duplicate(ep, nbr);
-      /* Add packet to the top of the interface output queue*/
-      eigrp_fifo_push_head(nbr->ei->obuf, duplicate);
+      eigrp_rto_cancel(nbr);
+      eigrp_packet_retrans(nbr);
+    }
 
-      ep->retrans_counter++;
-      if(ep->retrans_counter == EIGRP_PACKET_RETRANS_MAX)
-        return eigrp_retrans_count_exceeded(ep, nbr);
+  if (wheel->count > 0 && wheel->t_tick == NULL)
+    wheel->t_tick = thread_add_timer_msec(master, eigrp_rto_wheel_tick, eigrp,
+                                          EIGRP_RTO_WHEEL_TICK);
 
-      /*Start retransmission timer*/
-      ep->t_retrans_timer =
-          thread_add_timer(master, eigrp_unack_multicast_packet_retrans, nbr,EIGRP_PACKET_RETRANS_TIME);
+  return 0;
+}
 
-      /* Hook thread to write packet. */
-      if (nbr->ei->on_write_q == 0)
-        {
-          listnode_add(nbr->ei->eigrp->oi_write_q, nbr->ei);
-          nbr->ei->on_write_q = 1;
-        }
-      if (nbr->ei->eigrp->t_write == NULL)
-        nbr->ei->eigrp->t_write =
-            thread_add_write(master, eigrp_write, nbr->ei->eigrp, nbr->ei->eigrp->fd);
+/*
+ * Arm the retransmission timer of the neighbor to expire in msec, rounded
+ * up to the wheel tick.  Any running timer of the neighbor is cancelled.
+ */
+void
+eigrp_rto_arm (struct eigrp_neighbor *nbr, u_int32_t msec)
+{
+  struct eigrp *eigrp = nbr->ei->eigrp;
+  struct eigrp_rto_wheel *wheel = &eigrp->rto_wheel;
+  u_int32_t ticks;
+
+  eigrp_rto_cancel(nbr);
+
+  ticks = (msec + EIGRP_RTO_WHEEL_TICK - 1) / EIGRP_RTO_WHEEL_TICK;
+  if (ticks == 0)
+    ticks = 1;
+  if (ticks > EIGRP_RTO_WHEEL_SLOTS - 1)
+    ticks = EIGRP_RTO_WHEEL_SLOTS - 1;
+
+  nbr->rto_slot = (wheel->current + ticks - 1) % EIGRP_RTO_WHEEL_SLOTS;
+  nbr->rto_prev = NULL;
+  nbr->rto_next = wheel->slots[nbr->rto_slot];
+  if (nbr->rto_next)
+    nbr->rto_next->rto_prev = nbr;
+  wheel->slots[nbr->rto_slot] = nbr;
+  nbr->rto_armed = 1;
+
+  if (wheel->count++ == 0 && wheel->t_tick == NULL)
+    wheel->t_tick = thread_add_timer_msec(master, eigrp_rto_wheel_tick, eigrp,
+                                          EIGRP_RTO_WHEEL_TICK);
+}
+
+void
+eigrp_rto_cancel (struct eigrp_neighbor *nbr)
+{
+  struct eigrp_rto_wheel *wheel;
+
+  if (!nbr->rto_armed)
+    return;
+
+  wheel = &nbr->ei->eigrp->rto_wheel;
+
+  if (nbr->rto_prev)
+    nbr->rto_prev->rto_next = nbr->rto_next;
+  else
+    wheel->slots[nbr->rto_slot] = nbr->rto_next;
+  if (nbr->rto_next)
+    nbr->rto_next->rto_prev = nbr->rto_prev;
+
+  nbr->rto_next = nbr->rto_prev = NULL;
+  nbr->rto_armed = 0;
+
+  if (--wheel->count == 0)
+    THREAD_OFF(wheel->t_tick);
+}
+
+/* First transmission of the in-flight packet, RTT is measured from here. */
+static void
+eigrp_rto_start (struct eigrp_neighbor *nbr)
+{
+  quagga_gettime(QUAGGA_CLK_MONOTONIC, &nbr->rtt_start);
+  eigrp_rto_arm(nbr, nbr->rto);
+}
+
+/*
+ * The in-flight packet ep got acked: stop its timer and update SRTT and
+ * RTO the way TCP does (RFC 6298).  Acks of retransmitted packets are
+ * ambiguous and not sampled (Karn's algorithm).
+ */
+static void
+eigrp_rto_ack (struct eigrp_neighbor *nbr, struct eigrp_packet *ep)
+{
+  struct timeval now;
+  u_int32_t rtt, delta;
+
+  eigrp_rto_cancel(nbr);
+
+  if (ep->retrans_counter)
+    return;
+
+  quagga_gettime(QUAGGA_CLK_MONOTONIC, &now);
+  rtt = timeval_elapsed(now, nbr->rtt_start) / 1000;
+
+  if (nbr->rtt_samples++ == 0)
+    {
+      nbr->srtt = rtt;
+      nbr->rttvar = rtt / 2;
+    }
+  else
+    {
+      delta = (nbr->srtt > rtt) ? nbr->srtt - rtt : rtt - nbr->srtt;
+      nbr->rttvar = (3 * nbr->rttvar + delta) / 4;
+      nbr->srtt = (7 * nbr->srtt + rtt) / 8;
     }
 
-  return 0;
+  nbr->rto = nbr->srtt + MAX(EIGRP_RTO_WHEEL_TICK, 4 * nbr->rttvar);
+  if (nbr->rto < EIGRP_RTO_MIN)
+    nbr->rto = EIGRP_RTO_MIN;
+  if (nbr->rto > EIGRP_RTO_MAX)
+    nbr->rto = EIGRP_RTO_MAX;
 }
 
 /* Get packet from tail of fifo. */
@@ -1159,103 +1599,148 @@ eigrp_fifo_pop_tail (struct eigrp_fifo *fifo)
   return ep;
 }
 
+/*
+ * Returns new packet referring to the encoded data of old one, only the
+ * queueing and retransmission state is per packet.
+ */
 struct eigrp_packet *
 eigrp_packet_duplicate (struct eigrp_packet *old, struct eigrp_neighbor *nbr)
 {
   struct eigrp_packet *new;
 
-  new = eigrp_packet_new(nbr->ei->ifp->mtu);
+  new = XCALLOC(MTYPE_EIGRP_PACKET, sizeof(struct eigrp_packet));
+  new->data = old->data;
+  new->data->refcnt++;
+  new->s = old->s;
   new->length = old->length;
   new->retrans_counter = old->retrans_counter;
   new->dst = old->dst;
   new->sequence_number = old->sequence_number;
-  stream_copy(new->s, old->s);
 
   return new;
 }
 
-struct TLV_IPv4_Internal_type *
-eigrp_read_ipv4_tlv (struct stream *s)
+/* Decode the metric block shared by internal and external route TLVs. */
+static void
+eigrp_tlv_metric_decode (const u_char *p, struct eigrp_metrics *metric)
 {
-  struct TLV_IPv4_Internal_type *tlv;
+  u_int32_t val;
+
+  memcpy (&val, p, 4);
+  metric->delay = ntohl(val);
+  memcpy (&val, p + 4, 4);
+  metric->bandwith = ntohl(val);
+  metric->mtu[0] = p[8];
+  metric->mtu[1] = p[9];
+  metric->mtu[2] = p[10];
+  metric->hop_count = p[11];
+  metric->reliability = p[12];
+  metric->load = p[13];
+  metric->tag = p[14];
+  metric->flags = p[15];
+}
 
-  tlv = eigrp_IPv4_InternalTLV_new ();
+/*
+ * Decode the next IPv4 route TLV of the stream into storage provided by
+ * the caller and advance past it.  The TLV is read in place: its length
+ * is checked once against the remaining bytes and the fields are taken
+ * straight out of the buffer.  TLVs other than routes are skipped.
+ * Returns 0 when no route TLV is left, or on a malformed length, in which
+ * case the rest of the packet is dropped.
+ */
+int
+eigrp_tlv_route_next (struct stream *s, struct eigrp_route_tlv *route)
+{
+  const u_char *p;
+  size_t remain;
+  u_int16_t type, length;
+  u_int32_t val;
+  u_char plen;
+  size_t off;
+
+  while ((remain = STREAM_READABLE(s)) >= 4)
+    {
+      p = STREAM_PNT(s);
+      type = (p[0] << 8) | p[1];
+      length = (p[2] << 8) | p[3];
 
-  tlv->type = stream_getw(s);
-  tlv->length = stream_getw(s);
-  tlv->forward.s_addr = stream_getl(s);
-  tlv->metric.delay = stream_getl(s);
-  tlv->metric.bandwith = stream_getl(s);
-  tlv->metric.mtu[0] = stream_getc(s);
-  tlv->metric.mtu[1] = stream_getc(s);
-  tlv->metric.mtu[2] = stream_getc(s);
-  tlv->metric.hop_count = stream_getc(s);
-  tlv->metric.reliability = stream_getc(s);
-  tlv->metric.load = stream_getc(s);
-  tlv->metric.tag = stream_getc(s);
-  tlv->metric.flags = stream_getc(s);
+      if (length < 4 || length > remain)
+        {
+          stream_set_getp(s, stream_get_endp(s));
+          return 0;
+        }
+      stream_forward_getp(s, length);
 
-  tlv->prefix_length = stream_getc(s);
+      if (type == EIGRP_TLV_IPv4_INT)
+        off = 24;
+      else if (type == EIGRP_TLV_IPv4_EXT)
+        off = 44;
+      else
+        continue;
 
-  if (tlv->prefix_length <= 8)
-    {
-      tlv->destination_part[0] = stream_getc(s);
-      tlv->destination.s_addr = (tlv->destination_part[0]);
+      if (length < off + 1)
+        continue;
+      plen = p[off];
+      if (plen > IPV4_MAX_BITLEN || off + 1 + (plen + 7) / 8 > length)
+        continue;
 
+      memset (route, 0, sizeof (*route));
+      route->type = type;
+      memcpy (&route->nexthop, p + 4, 4);
+
+      if (type == EIGRP_TLV_IPv4_EXT)
+        {
+          memcpy (&route->originating_router, p + 8, 4);
+          memcpy (&val, p + 12, 4);
+          route->originating_as = ntohl(val);
+          memcpy (&val, p + 16, 4);
+          route->administrative_tag = ntohl(val);
+          memcpy (&val, p + 20, 4);
+          route->external_metric = ntohl(val);
+          route->external_protocol = p[26];
+          route->external_flags = p[27];
+        }
+      eigrp_tlv_metric_decode (p + off - 16, &route->metric);
+
+      route->prefix.family = AF_INET;
+      route->prefix.prefixlen = plen;
+      memcpy (&route->prefix.prefix, p + off + 1, (plen + 7) / 8);
+      apply_mask_ipv4 (&route->prefix);
+
+      return 1;
     }
-  else if (tlv->prefix_length > 8 && tlv->prefix_length <= 16)
-    {
-      tlv->destination_part[0] = stream_getc(s);
-      tlv->destination_part[1] = stream_getc(s);
-      tlv->destination.s_addr = ((tlv->destination_part[1] << 8)
-          + tlv->destination_part[0]);
-    }
-  else if (tlv->prefix_length > 16 && tlv->prefix_length <= 24)
-    {
-      tlv->destination_part[0] = stream_getc(s);
-      tlv->destination_part[1] = stream_getc(s);
-      tlv->destination_part[2] = stream_getc(s);
-      tlv->destination.s_addr = ((tlv->destination_part[2] << 16)
-          + (tlv->destination_part[1] << 8) + tlv->destination_part[0]);
-    }
-  else if (tlv->prefix_length > 24 && tlv->prefix_length <= 32)
-    {
-      tlv->destination_part[0] = stream_getc(s);
-      tlv->destination_part[1] = stream_getc(s);
-      tlv->destination_part[2] = stream_getc(s);
-      tlv->destination_part[3] = stream_getc(s);
-      tlv->destination.s_addr = ((tlv->destination_part[3] << 24)
-          + (tlv->destination_part[2] << 16) + (tlv->destination_part[1] << 8)
-          + tlv->destination_part[0]);
-    }
-  return tlv;
+
+  return 0;
 }
 
+/*
+ * Encode an internal IPv4 route TLV for destination p with given metric.
+ */
 u_int16_t
-eigrp_add_internalTLV_to_stream (struct stream *s,
-    struct eigrp_prefix_entry *pe)
+eigrp_add_ipv4_tlv_to_stream (struct stream *s, struct prefix_ipv4 *p,
+    struct eigrp_metrics *metric)
 {
   u_int16_t length;
 
   stream_putw(s, EIGRP_TLV_IPv4_INT);
-  if (pe->destination_ipv4->prefixlen <= 8)
+  if (p->prefixlen <= 8)
     {
       stream_putw(s, 0x001A);
       length = 0x001A;
     }
-  if ((pe->destination_ipv4->prefixlen > 8)
-      && (pe->destination_ipv4->prefixlen <= 16))
+  if ((p->prefixlen > 8)
+      && (p->prefixlen <= 16))
     {
       stream_putw(s, 0x001B);
       length = 0x001B;
     }
-  if ((pe->destination_ipv4->prefixlen > 16)
-      && (pe->destination_ipv4->prefixlen <= 24))
+  if ((p->prefixlen > 16)
+      && (p->prefixlen <= 24))
     {
       stream_putw(s, 0x001C);
       length = 0x001C;
     }
-  if (pe->destination_ipv4->prefixlen > 24)
+  if (p->prefixlen > 24)
     {
       stream_putw(s, 0x001D);
       length = 0x001D;
@@ -1264,47 +1749,117 @@ eigrp_add_internalTLV_to_stream (struct stream *s,
   stream_putl(s, 0x00000000);
 
   /*Metric*/
-  stream_putl(s, pe->reported_metric.delay);
-  stream_putl(s, pe->reported_metric.bandwith);
-  stream_putc(s, pe->reported_metric.mtu[2]);
-  stream_putc(s, pe->reported_metric.mtu[1]);
-  stream_putc(s, pe->reported_metric.mtu[0]);
-  stream_putc(s, pe->reported_metric.hop_count);
-  stream_putc(s, pe->reported_metric.reliability);
-  stream_putc(s, pe->reported_metric.load);
-  stream_putc(s, pe->reported_metric.tag);
-  stream_putc(s, pe->reported_metric.flags);
-
-  stream_putc(s, pe->destination_ipv4->prefixlen);
-
-  if (pe->destination_ipv4->prefixlen <= 8)
+  stream_putl(s, metric->delay);
+  stream_putl(s, metric->bandwith);
+  stream_putc(s, metric->mtu[2]);
+  stream_putc(s, metric->mtu[1]);
+  stream_putc(s, metric->mtu[0]);
+  stream_putc(s, metric->hop_count);
+  stream_putc(s, metric->reliability);
+  stream_putc(s, metric->load);
+  stream_putc(s, metric->tag);
+  stream_putc(s, metric->flags);
+
+  stream_putc(s, p->prefixlen);
+
+  if (p->prefixlen <= 8)
     {
-      stream_putc(s, pe->destination_ipv4->prefix.s_addr & 0xFF);
+      stream_putc(s, p->prefix.s_addr & 0xFF);
     }
-  if ((pe->destination_ipv4->prefixlen > 8)
-      && (pe->destination_ipv4->prefixlen <= 16))
+  if ((p->prefixlen > 8)
+      && (p->prefixlen <= 16))
     {
-      stream_putc(s, pe->destination_ipv4->prefix.s_addr & 0xFF);
-      stream_putc(s, (pe->destination_ipv4->prefix.s_addr >> 8) & 0xFF);
+      stream_putc(s, p->prefix.s_addr & 0xFF);
+      stream_putc(s, (p->prefix.s_addr >> 8) & 0xFF);
     }
-  if ((pe->destination_ipv4->prefixlen > 16)
-      && (pe->destination_ipv4->prefixlen <= 24))
+  if ((p->prefixlen > 16)
+      && (p->prefixlen <= 24))
     {
-      stream_putc(s, pe->destination_ipv4->prefix.s_addr & 0xFF);
-      stream_putc(s, (pe->destination_ipv4->prefix.s_addr >> 8) & 0xFF);
-      stream_putc(s, (pe->destination_ipv4->prefix.s_addr >> 16) & 0xFF);
+      stream_putc(s, p->prefix.s_addr & 0xFF);
+      stream_putc(s, (p->prefix.s_addr >> 8) & 0xFF);
+      stream_putc(s, (p->prefix.s_addr >> 16) & 0xFF);
     }
-  if (pe->destination_ipv4->prefixlen > 24)
+  if (p->prefixlen > 24)
     {
-      stream_putc(s, pe->destination_ipv4->prefix.s_addr & 0xFF);
-      stream_putc(s, (pe->destination_ipv4->prefix.s_addr >> 8) & 0xFF);
-      stream_putc(s, (pe->destination_ipv4->prefix.s_addr >> 16) & 0xFF);
-      stream_putc(s, (pe->destination_ipv4->prefix.s_addr >> 24) & 0xFF);
+      stream_putc(s, p->prefix.s_addr & 0xFF);
+      stream_putc(s, (p->prefix.s_addr >> 8) & 0xFF);
+      stream_putc(s, (p->prefix.s_addr >> 16) & 0xFF);
+      stream_putc(s, (p->prefix.s_addr >> 24) & 0xFF);
     }
 
   return length;
 }
 
+u_int16_t
+eigrp_add_internalTLV_to_stream (struct stream *s,
+    struct eigrp_prefix_entry *pe)
+{
+  return eigrp_add_ipv4_tlv_to_stream(s, pe->destination_ipv4,
+                                      &pe->reported_metric);
+}
+
+/*
+ * Encode the external IPv4 route TLV of a route redistributed here, the
+ * external data comes from what was cached in pe->extTLV when the route
+ * was taken into the topology.
+ */
+u_int16_t
+eigrp_add_externalTLV_to_stream (struct stream *s,
+    struct eigrp_prefix_entry *pe)
+{
+  struct TLV_IPv4_External_type *ext = pe->extTLV;
+  struct prefix_ipv4 *p = pe->destination_ipv4;
+  struct eigrp_metrics *metric = &pe->reported_metric;
+  u_int16_t length;
+  int i;
+
+  length = EIGRP_TLV_IPv4_EXT_MAX_LEN - 4 + PSIZE(p->prefixlen);
+
+  stream_putw(s, EIGRP_TLV_IPv4_EXT);
+  stream_putw(s, length);
+  stream_putl(s, 0x00000000);
+
+  stream_put_ipv4(s, ext->originating_router.s_addr);
+  stream_putl(s, ext->originating_as);
+  stream_putl(s, ext->administrative_tag);
+  stream_putl(s, ext->external_metric);
+  stream_putw(s, 0x0000);
+  stream_putc(s, ext->external_protocol);
+  stream_putc(s, ext->external_flags);
+
+  /*Metric*/
+  stream_putl(s, metric->delay);
+  stream_putl(s, metric->bandwith);
+  stream_putc(s, metric->mtu[2]);
+  stream_putc(s, metric->mtu[1]);
+  stream_putc(s, metric->mtu[0]);
+  stream_putc(s, metric->hop_count);
+  stream_putc(s, metric->reliability);
+  stream_putc(s, metric->load);
+  stream_putc(s, metric->tag);
+  stream_putc(s, metric->flags);
+
+  stream_putc(s, p->prefixlen);
+  for (i = 0; i < PSIZE(p->prefixlen); i++)
+    stream_putc(s, (ntohl(p->prefix.s_addr) >> (24 - 8 * i)) & 0xFF);
+
+  return length;
+}
+
+/*
+ * Encode the route TLV of a prefix entry, external for routes
+ * redistributed here and internal for everything else.
+ */
+u_int16_t
+eigrp_add_prefixTLV_to_stream (struct stream *s,
+    struct eigrp_prefix_entry *pe)
+{
+  if (pe->extTLV)
+    return eigrp_add_externalTLV_to_stream(s, pe);
+
+  return eigrp_add_internalTLV_to_stream(s, pe);
+}
+
 u_int16_t
 eigrp_add_authTLV_MD5_to_stream (struct stream *s,
     struct eigrp_interface *ei)
@@ -1379,7 +1934,7 @@ eigrp_add_authTLV_SHA256_to_stream (struct stream *s,
 
   if(key)
     {
-      authTLV->key_id = 0;
+      authTLV->key_id = htonl(key->index);
       memset(authTLV->digest,0,EIGRP_AUTH_TYPE_SHA256_LEN);
       stream_put(s,authTLV, sizeof(struct TLV_SHA256_Authentication_Type));
       eigrp_authTLV_SHA256_free(authTLV);
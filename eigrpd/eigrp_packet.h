@@ -31,6 +31,7 @@
 
 /*Prototypes*/
 extern int eigrp_read (struct thread *);
+extern int eigrp_packet_ingest (struct eigrp *, struct stream *, struct interface *);
 extern int eigrp_write (struct thread *);
 
 extern struct eigrp_packet *eigrp_packet_new (size_t);
@@ -47,18 +48,26 @@ extern struct eigrp_packet *eigrp_fifo_tail (struct eigrp_fifo *);
 extern struct eigrp_packet *eigrp_fifo_pop (struct eigrp_fifo *);
 extern struct eigrp_packet *eigrp_fifo_pop_tail (struct eigrp_fifo *);
 extern void eigrp_fifo_push_head (struct eigrp_fifo *, struct eigrp_packet *);
+extern void eigrp_fifo_push_tail (struct eigrp_fifo *, struct eigrp_packet *);
 extern void eigrp_fifo_free (struct eigrp_fifo *);
 extern void eigrp_fifo_reset (struct eigrp_fifo *);
 
 extern void eigrp_send_packet_reliably (struct eigrp_neighbor *);
+extern void eigrp_send_packet_reliably_all (struct eigrp_interface *, struct eigrp_packet *, u_int64_t);
+extern u_int16_t eigrp_packet_max_len (struct eigrp_interface *);
+extern struct eigrp_packet *eigrp_packet_reliable_new (int, struct eigrp_interface *, u_int32_t);
+extern void eigrp_packet_reliable_finish (struct eigrp_interface *, struct eigrp_packet *, u_int32_t);
 
-extern struct TLV_IPv4_Internal_type *eigrp_read_ipv4_tlv (struct stream *);
+extern int eigrp_tlv_route_next (struct stream *, struct eigrp_route_tlv *);
+extern u_int16_t eigrp_add_ipv4_tlv_to_stream (struct stream *, struct prefix_ipv4 *, struct eigrp_metrics *);
 extern u_int16_t eigrp_add_internalTLV_to_stream (struct stream *, struct eigrp_prefix_entry *);
+extern u_int16_t eigrp_add_externalTLV_to_stream (struct stream *, struct eigrp_prefix_entry *);
+extern u_int16_t eigrp_add_prefixTLV_to_stream (struct stream *, struct eigrp_prefix_entry *);
 extern u_int16_t eigrp_add_authTLV_MD5_to_stream (struct stream *, struct eigrp_interface *);
 extern u_int16_t eigrp_add_authTLV_SHA256_to_stream (struct stream *, struct eigrp_interface *);
 
-extern int eigrp_unack_packet_retrans (struct thread *);
-extern int eigrp_unack_multicast_packet_retrans (struct thread *);
+extern void eigrp_rto_arm (struct eigrp_neighbor *, u_int32_t);
+extern void eigrp_rto_cancel (struct eigrp_neighbor *);
 
 /*
  * untill there is reason to have their own header, these externs are found in
@@ -66,6 +75,9 @@ extern int eigrp_unack_multicast_packet_retrans (struct thread *);
  */
 extern void eigrp_hello_send (struct eigrp_interface *, u_char);
 extern void eigrp_hello_send_ack (struct eigrp_neighbor *);
+extern void eigrp_hello_send_sequence (struct eigrp_interface *, u_int32_t);
+extern void eigrp_hello_template_flush (struct eigrp *);
+extern void eigrp_hello_template_free (struct eigrp_interface *);
 extern void eigrp_hello_receive (struct eigrp *, struct ip *, struct eigrp_header *,
 				struct stream *, struct eigrp_interface *, int);
 extern int  eigrp_hello_timer (struct thread *);
@@ -79,6 +91,7 @@ extern void eigrp_update_receive (struct eigrp *, struct ip *, struct eigrp_head
 extern void eigrp_update_send_all (struct eigrp *, struct eigrp_interface *);
 extern void eigrp_update_send_init (struct eigrp_neighbor *);
 extern void eigrp_update_send_EOT (struct eigrp_neighbor *);
+extern void eigrp_update_send_summary (struct eigrp_interface *, struct eigrp_summary *, int);
 
 /*
  * These externs are found in eigrp_query.c
@@ -93,6 +106,8 @@ extern u_int32_t eigrp_query_send_all (struct eigrp *);
  * These externs are found in eigrp_reply.c
  */
 extern void eigrp_send_reply (struct eigrp_neighbor *, struct eigrp_prefix_entry *);
+extern void eigrp_send_reply_unreachable (struct eigrp_neighbor *, struct eigrp_packet **, struct prefix_ipv4 *);
+extern void eigrp_send_reply_packet (struct eigrp_neighbor *, struct eigrp_packet *);
 extern void eigrp_reply_receive (struct eigrp *, struct ip *, struct eigrp_header *,
                                  struct stream *, struct eigrp_interface *, int);
 
@@ -115,6 +130,8 @@ extern void eigrp_authTLV_MD5_free (struct TLV_MD5_Authentication_Type *);
 extern struct TLV_SHA256_Authentication_Type *eigrp_authTLV_SHA256_new (void);
 extern void eigrp_authTLV_SHA256_free (struct TLV_SHA256_Authentication_Type *);
 
+extern struct key *eigrp_auth_send_key (struct eigrp_interface *);
+extern void eigrp_auth_key_flush (struct eigrp_interface *);
 extern int eigrp_make_md5_digest (struct eigrp_interface *, struct stream *,
                                   u_char);
 extern int eigrp_check_md5_digest (struct stream *, struct TLV_MD5_Authentication_Type *,
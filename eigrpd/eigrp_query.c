@@ -58,8 +58,7 @@ u_int32_t
 eigrp_query_send_all (struct eigrp *eigrp)
 {
   struct eigrp_interface *iface;
-  struct listnode *node, *node2, *nnode2;
-  struct eigrp_neighbor *nbr;
+  struct listnode *node;
   struct eigrp_prefix_entry *pe;
   u_int32_t counter;
 
@@ -76,14 +75,10 @@ eigrp_query_send_all (struct eigrp *eigrp)
       counter++;
     }
 
-  for (ALL_LIST_ELEMENTS(eigrp->topology_changes_internalIPV4, node2, nnode2, pe))
-    {
-      if(pe->req_action & EIGRP_FSM_NEED_QUERY)
-        {
-          pe->req_action &= ~EIGRP_FSM_NEED_QUERY;
-          listnode_delete(eigrp->topology_changes_internalIPV4, pe);
-        }
-    }
+  for (pe = eigrp_topology_changes_since(eigrp, eigrp->serno_last_query); pe;
+       pe = pe->change_next)
+    pe->req_action &= ~EIGRP_FSM_NEED_QUERY;
+  eigrp->serno_last_query = eigrp->serno;
 
   return counter;
 }
@@ -94,11 +89,13 @@ eigrp_query_receive (struct eigrp *eigrp, struct ip *iph, struct eigrp_header *e
                      struct stream * s, struct eigrp_interface *ei, int size)
 {
   struct eigrp_neighbor *nbr;
-  struct TLV_IPv4_Internal_type *tlv;
+  struct eigrp_route_tlv route;
+  struct eigrp_fsm_action_message msg;
+  struct prefix_ipv4 dest_addr;
   struct eigrp_prefix_entry *temp_tn;
   struct eigrp_neighbor_entry *temp_te;
+  struct eigrp_packet *unreachable = NULL;
 
-  u_int16_t type;
 
   /* increment statistics. */
   ei->query_in++;
@@ -111,118 +108,137 @@ eigrp_query_receive (struct eigrp *eigrp, struct ip *iph, struct eigrp_header *e
 
   nbr->recv_sequence_number = ntohl(eigrph->sequence);
 
-  while (s->endp > s->getp)
+  while (eigrp_tlv_route_next(s, &route))
     {
-      type = stream_getw(s);
-      if (type == EIGRP_TLV_IPv4_INT)
+      /* external routes are not taken into DUAL yet */
+      if (route.type == EIGRP_TLV_IPv4_INT)
         {
-          stream_set_getp(s, s->getp - sizeof(u_int16_t));
-
-          tlv = eigrp_read_ipv4_tlv(s);
-
-          struct prefix_ipv4 *dest_addr;
-          dest_addr = prefix_ipv4_new();
-          dest_addr->prefix = tlv->destination;
-          dest_addr->prefixlen = tlv->prefix_length;
+          dest_addr = route.prefix;
           struct eigrp_prefix_entry *dest = eigrp_topology_table_lookup_ipv4(
-              eigrp->topology_table, dest_addr);
+              eigrp->topology_table, &dest_addr);
 
           /* If the destination exists (it should, but one never know)*/
           if (dest != NULL)
             {
-              struct eigrp_fsm_action_message *msg;
-              msg = XCALLOC(MTYPE_EIGRP_FSM_MSG,
-                  sizeof(struct eigrp_fsm_action_message));
               struct eigrp_neighbor_entry *entry = eigrp_prefix_entry_lookup(
-                  dest->entries, nbr);
-              msg->packet_type = EIGRP_OPC_QUERY;
-              msg->eigrp = eigrp;
-              msg->data_type = EIGRP_TLV_IPv4_INT;
-              msg->adv_router = nbr;
-              msg->data.ipv4_int_type = tlv;
-              msg->entry = entry;
-              msg->prefix = dest;
-              int event = eigrp_get_fsm_event(msg);
-              eigrp_fsm_event(msg, event);
+                  dest, nbr);
+              msg.packet_type = EIGRP_OPC_QUERY;
+              msg.eigrp = eigrp;
+              msg.data_type = EIGRP_TLV_IPv4_INT;
+              msg.adv_router = nbr;
+              msg.route = &route;
+              msg.entry = entry;
+              msg.prefix = dest;
+              int event = eigrp_get_fsm_event(&msg);
+              eigrp_fsm_event(&msg, event);
+            }
+          else
+            {
+              /* beyond a summary boundary, the component is not known
+               * here, so there is nothing to look for */
+              eigrp_send_reply_unreachable(nbr, &unreachable, &dest_addr);
             }
-          eigrp_IPv4_InternalTLV_free (tlv);
         }
     }
+  if (unreachable)
+    eigrp_send_reply_packet(nbr, unreachable);
   eigrp_hello_send_ack(nbr);
-  eigrp_query_send_all(eigrp);
-  eigrp_update_send_all(eigrp,nbr->ei);
+  eigrp_dual_flush_schedule(eigrp, nbr->ei);
 }
 
-void
-eigrp_send_query (struct eigrp_interface *ei)
+/*
+ * Stub neighbors are never queried.  If there are any on the interface
+ * the Query goes unicast to each of the others, so the stubs do not pick
+ * it up from the multicast group.
+ */
+static void
+eigrp_send_query_packet (struct eigrp_interface *ei, struct eigrp_packet *ep,
+                         int has_stub)
 {
-  struct eigrp_packet *ep, *duplicate;
-  u_int16_t length = EIGRP_HEADER_LEN;
-  struct listnode *node, *nnode, *node2, *nnode2;
   struct eigrp_neighbor *nbr;
-  struct eigrp_prefix_entry *pe;
-  char has_tlv;
+  struct eigrp_packet *dup;
+  struct listnode *node, *nnode;
 
-  ep = eigrp_packet_new(ei->ifp->mtu);
+  eigrp_packet_reliable_finish(ei, ep, 0);
+  ep->dst.s_addr = htonl(EIGRP_MULTICAST_ADDRESS);
 
-  /* Prepare EIGRP INIT UPDATE header */
-  eigrp_packet_header_init(EIGRP_OPC_QUERY, ei, ep->s, 0,
-                           ei->eigrp->sequence_number, 0);
-
-  // encode Authentication TLV, if needed
-  if((IF_DEF_PARAMS (ei->ifp)->auth_type == EIGRP_AUTH_TYPE_MD5) && (IF_DEF_PARAMS (ei->ifp)->auth_keychain != NULL))
+  if (!has_stub)
     {
-      length += eigrp_add_authTLV_MD5_to_stream(ep->s,ei);
+      eigrp_send_packet_reliably_all(ei, ep, 0);
+      return;
     }
 
-  has_tlv = 0;
-  for (ALL_LIST_ELEMENTS(ei->eigrp->topology_changes_internalIPV4, node, nnode, pe))
+  for (ALL_LIST_ELEMENTS(ei->nbrs, node, nnode, nbr))
     {
-      if(pe->req_action & EIGRP_FSM_NEED_QUERY)
-        {
-          length += eigrp_add_internalTLV_to_stream(ep->s, pe);
-          for (ALL_LIST_ELEMENTS(ei->nbrs, node2, nnode2, nbr))
-            {
-        	  if(nbr->state == EIGRP_NEIGHBOR_UP)
-        	  {
-        		  listnode_add(pe->rij, nbr);
-                  has_tlv = 1;
-        	  }
-            }
-        }
-    }
+      if (nbr->state != EIGRP_NEIGHBOR_UP || nbr->stub)
+        continue;
 
-  if(!has_tlv)
-    {
-      eigrp_packet_free(ep);
-      return;
+      dup = eigrp_packet_duplicate(ep, nbr);
+      dup->dst = nbr->src;
+      eigrp_fifo_push_head(nbr->retrans_queue, dup);
+
+      if (nbr->retrans_queue->count == 1)
+        eigrp_send_packet_reliably(nbr);
     }
 
-  if((IF_DEF_PARAMS (ei->ifp)->auth_type == EIGRP_AUTH_TYPE_MD5) && (IF_DEF_PARAMS (ei->ifp)->auth_keychain != NULL))
+  eigrp_packet_free(ep);
+}
+
+/*
+ * Queries for active prefixes are split in as many packets as it takes to
+ * keep each of them within the interface MTU.
+ */
+void
+eigrp_send_query (struct eigrp_interface *ei)
+{
+  struct eigrp_packet *ep = NULL;
+  struct listnode *node2, *nnode2;
+  struct eigrp_neighbor *nbr;
+  struct eigrp_prefix_entry *pe;
+  u_int16_t max_len = eigrp_packet_max_len(ei);
+  u_int64_t since = ei->serno_last_query;
+  char has_nbr, has_stub;
+
+  ei->serno_last_query = ei->eigrp->serno;
+
+  has_nbr = has_stub = 0;
+  for (ALL_LIST_ELEMENTS(ei->nbrs, node2, nnode2, nbr))
     {
-      eigrp_make_md5_digest(ei,ep->s, EIGRP_AUTH_UPDATE_FLAG);
+      if (nbr->state != EIGRP_NEIGHBOR_UP)
+        continue;
+
+      if (nbr->stub)
+        has_stub = 1;
+      else
+        has_nbr = 1;
     }
 
-  /* EIGRP Checksum */
-    eigrp_packet_checksum(ei, ep->s, length);
+  if (!has_nbr)
+    return;
+
+  for (pe = eigrp_topology_changes_since(ei->eigrp, since); pe;
+       pe = pe->change_next)
+    {
+      if(!(pe->req_action & EIGRP_FSM_NEED_QUERY))
+        continue;
 
-    ep->length = length;
-    ep->dst.s_addr = htonl(EIGRP_MULTICAST_ADDRESS);
+      if (ep && ep->length + EIGRP_TLV_IPv4_MAX_LEN(pe) > max_len)
+        {
+          eigrp_send_query_packet(ei, ep, has_stub);
+          ep = NULL;
+        }
 
-    /*This ack number we await from neighbor*/
-    ep->sequence_number = ei->eigrp->sequence_number;
+      if (ep == NULL)
+        ep = eigrp_packet_reliable_new(EIGRP_OPC_QUERY, ei, 0);
 
-    for (ALL_LIST_ELEMENTS(ei->nbrs, node2, nnode2, nbr))
-      {
-        if (nbr->state == EIGRP_NEIGHBOR_UP)
-          {
-            /*Put packet to retransmission queue*/
-            eigrp_fifo_push_head(nbr->retrans_queue, ep);
+      ep->length += eigrp_add_prefixTLV_to_stream(ep->s, pe);
+      for (ALL_LIST_ELEMENTS(ei->nbrs, node2, nnode2, nbr))
+        {
+          if(nbr->state == EIGRP_NEIGHBOR_UP && !nbr->stub)
+            listnode_add(pe->rij, nbr);
+        }
+    }
 
-            if (nbr->retrans_queue->count == 1)
-              {
-                eigrp_send_packet_reliably(nbr);
-              }
-          }
-      }
+  if (ep)
+    eigrp_send_query_packet(ei, ep, has_stub);
 }
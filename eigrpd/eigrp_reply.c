@@ -54,47 +54,64 @@
 #include "eigrpd/eigrp_topology.h"
 #include "eigrpd/eigrp_fsm.h"
 
+/*
+ * Finish Reply started by eigrp_packet_reliable_new() and queue it for
+ * the neighbor.
+ */
 void
-eigrp_send_reply (struct eigrp_neighbor *nbr, struct eigrp_prefix_entry *pe)
+eigrp_send_reply_packet (struct eigrp_neighbor *nbr, struct eigrp_packet *ep)
 {
-  struct eigrp_packet *ep;
-  u_int16_t length = EIGRP_HEADER_LEN;
-
-  ep = eigrp_packet_new(nbr->ei->ifp->mtu);
+  eigrp_packet_reliable_finish(nbr->ei, ep, 0);
+  ep->dst.s_addr = nbr->src.s_addr;
 
-  /* Prepare EIGRP INIT UPDATE header */
-  eigrp_packet_header_init(EIGRP_OPC_REPLY, nbr->ei, ep->s, 0,
-                           nbr->ei->eigrp->sequence_number, 0);
+  /*Put packet to retransmission queue*/
+  eigrp_fifo_push_head(nbr->retrans_queue, ep);
 
-  // encode Authentication TLV, if needed
-  if((IF_DEF_PARAMS (nbr->ei->ifp)->auth_type == EIGRP_AUTH_TYPE_MD5) && (IF_DEF_PARAMS (nbr->ei->ifp)->auth_keychain != NULL))
+  if (nbr->retrans_queue->count == 1)
     {
-      length += eigrp_add_authTLV_MD5_to_stream(ep->s,nbr->ei);
+      eigrp_send_packet_reliably(nbr);
     }
+}
 
-  length += eigrp_add_internalTLV_to_stream(ep->s, pe);
+void
+eigrp_send_reply (struct eigrp_neighbor *nbr, struct eigrp_prefix_entry *pe)
+{
+  struct eigrp_packet *ep;
 
-  if((IF_DEF_PARAMS (nbr->ei->ifp)->auth_type == EIGRP_AUTH_TYPE_MD5) && (IF_DEF_PARAMS (nbr->ei->ifp)->auth_keychain != NULL))
-    {
-      eigrp_make_md5_digest(nbr->ei,ep->s, EIGRP_AUTH_UPDATE_FLAG);
-    }
+  ep = eigrp_packet_reliable_new(EIGRP_OPC_REPLY, nbr->ei, 0);
+  ep->length += eigrp_add_ipv4_tlv_to_stream(ep->s, pe->destination_ipv4,
+                                             &pe->reported_metric);
+  eigrp_send_reply_packet(nbr, ep);
+}
 
-  /* EIGRP Checksum */
-  eigrp_packet_checksum(nbr->ei, ep->s, length);
+/*
+ * Answer a Query for a destination we know nothing about, so the querying
+ * router does not have to wait for us.  The destination is added to the
+ * Reply in *ep, which is started or, once it is full, sent and replaced
+ * as needed.  The caller sends the last one with eigrp_send_reply_packet(),
+ * so all such destinations of a Query take as few packets as the MTU
+ * allows.
+ */
+void
+eigrp_send_reply_unreachable (struct eigrp_neighbor *nbr,
+                              struct eigrp_packet **ep, struct prefix_ipv4 *p)
+{
+  struct eigrp_metrics metric;
 
-  ep->length = length;
-  ep->dst.s_addr = nbr->src.s_addr;
+  if (*ep && (*ep)->length + EIGRP_TLV_IPv4_INT_MAX_LEN
+             > eigrp_packet_max_len(nbr->ei))
+    {
+      eigrp_send_reply_packet(nbr, *ep);
+      *ep = NULL;
+    }
 
-  /*This ack number we await from neighbor*/
-  ep->sequence_number = nbr->ei->eigrp->sequence_number;
+  if (*ep == NULL)
+    *ep = eigrp_packet_reliable_new(EIGRP_OPC_REPLY, nbr->ei, 0);
 
-  /*Put packet to retransmission queue*/
-  eigrp_fifo_push_head(nbr->retrans_queue, ep);
+  memset(&metric, 0, sizeof(metric));
+  metric.delay = EIGRP_MAX_METRIC;
 
-  if (nbr->retrans_queue->count == 1)
-    {
-      eigrp_send_packet_reliably(nbr);
-    }
+  (*ep)->length += eigrp_add_ipv4_tlv_to_stream((*ep)->s, p, &metric);
 }
 
 /*EIGRP REPLY read function*/
@@ -103,9 +120,10 @@ eigrp_reply_receive (struct eigrp *eigrp, struct ip *iph, struct eigrp_header *e
                      struct stream * s, struct eigrp_interface *ei, int size)
 {
   struct eigrp_neighbor *nbr;
-  struct TLV_IPv4_Internal_type *tlv;
+  struct eigrp_route_tlv route;
+  struct eigrp_fsm_action_message msg;
+  struct prefix_ipv4 dest_addr;
 
-  u_int16_t type;
 
   /* increment statistics. */
   ei->reply_in++;
@@ -118,47 +136,35 @@ eigrp_reply_receive (struct eigrp *eigrp, struct ip *iph, struct eigrp_header *e
 
   nbr->recv_sequence_number = ntohl(eigrph->sequence);
 
-  while (s->endp > s->getp)
+  while (eigrp_tlv_route_next(s, &route))
     {
-      type = stream_getw(s);
-      if (type == EIGRP_TLV_IPv4_INT)
+      /* external routes are not taken into DUAL yet */
+      if (route.type == EIGRP_TLV_IPv4_INT)
         {
-          stream_set_getp(s, s->getp - sizeof(u_int16_t));
-
-          tlv = eigrp_read_ipv4_tlv(s);
-
-          struct prefix_ipv4 *dest_addr;
-          dest_addr = prefix_ipv4_new();
-          dest_addr->prefix = tlv->destination;
-          dest_addr->prefixlen = tlv->prefix_length;
+          dest_addr = route.prefix;
           struct eigrp_prefix_entry *dest = eigrp_topology_table_lookup_ipv4(
-              eigrp->topology_table, dest_addr);
+              eigrp->topology_table, &dest_addr);
           /*
            * Destination must exists
            */
           assert(dest);
 
-          struct eigrp_fsm_action_message *msg;
-          msg = XCALLOC(MTYPE_EIGRP_FSM_MSG,
-              sizeof(struct eigrp_fsm_action_message));
+          /* none if nbr never advertised it, DUAL adds one */
           struct eigrp_neighbor_entry *entry = eigrp_prefix_entry_lookup(
-              dest->entries, nbr);
-
-          assert(entry); //testing
-
-          msg->packet_type = EIGRP_OPC_REPLY;
-          msg->eigrp = eigrp;
-          msg->data_type = EIGRP_TLV_IPv4_INT;
-          msg->adv_router = nbr;
-          msg->data.ipv4_int_type = tlv;
-          msg->entry = entry;
-          msg->prefix = dest;
-          int event = eigrp_get_fsm_event(msg);
-          eigrp_fsm_event(msg, event);
-
-          eigrp_IPv4_InternalTLV_free (tlv);
+              dest, nbr);
+
+          msg.packet_type = EIGRP_OPC_REPLY;
+          msg.eigrp = eigrp;
+          msg.data_type = EIGRP_TLV_IPv4_INT;
+          msg.adv_router = nbr;
+          msg.route = &route;
+          msg.entry = entry;
+          msg.prefix = dest;
+          int event = eigrp_get_fsm_event(&msg);
+          eigrp_fsm_event(&msg, event);
         }
     }
   eigrp_hello_send_ack(nbr);
+  eigrp_dual_flush_schedule(eigrp, ei);
 }
 
@@ -60,11 +60,12 @@ eigrp_siaquery_receive (struct eigrp *eigrp, struct ip *iph, struct eigrp_header
                      struct stream * s, struct eigrp_interface *ei, int size)
 {
   struct eigrp_neighbor *nbr;
-  struct TLV_IPv4_Internal_type *tlv;
+  struct eigrp_route_tlv route;
+  struct eigrp_fsm_action_message msg;
+  struct prefix_ipv4 dest_addr;
   struct eigrp_prefix_entry *temp_tn;
   struct eigrp_neighbor_entry *temp_te;
 
-  u_int16_t type;
 
   /* increment statistics. */
   ei->siaQuery_in++;
@@ -77,41 +78,30 @@ eigrp_siaquery_receive (struct eigrp *eigrp, struct ip *iph, struct eigrp_header
 
   nbr->recv_sequence_number = ntohl(eigrph->sequence);
 
-  while (s->endp > s->getp)
+  while (eigrp_tlv_route_next(s, &route))
     {
-      type = stream_getw(s);
-      if (type == EIGRP_TLV_IPv4_INT)
+      /* external routes are not taken into DUAL yet */
+      if (route.type == EIGRP_TLV_IPv4_INT)
         {
-          stream_set_getp(s, s->getp - sizeof(u_int16_t));
-
-          tlv = eigrp_read_ipv4_tlv(s);
-
-          struct prefix_ipv4 *dest_addr;
-          dest_addr = prefix_ipv4_new();
-          dest_addr->prefix = tlv->destination;
-          dest_addr->prefixlen = tlv->prefix_length;
+          dest_addr = route.prefix;
           struct eigrp_prefix_entry *dest = eigrp_topology_table_lookup_ipv4(
-              eigrp->topology_table, dest_addr);
+              eigrp->topology_table, &dest_addr);
 
           /* If the destination exists (it should, but one never know)*/
           if (dest != NULL)
             {
-              struct eigrp_fsm_action_message *msg;
-              msg = XCALLOC(MTYPE_EIGRP_FSM_MSG,
-                  sizeof(struct eigrp_fsm_action_message));
               struct eigrp_neighbor_entry *entry = eigrp_prefix_entry_lookup(
-                  dest->entries, nbr);
-              msg->packet_type = EIGRP_OPC_SIAQUERY;
-              msg->eigrp = eigrp;
-              msg->data_type = EIGRP_TLV_IPv4_INT;
-              msg->adv_router = nbr;
-              msg->data.ipv4_int_type = tlv;
-              msg->entry = entry;
-              msg->prefix = dest;
-              int event = eigrp_get_fsm_event(msg);
-              eigrp_fsm_event(msg, event);
+                  dest, nbr);
+              msg.packet_type = EIGRP_OPC_SIAQUERY;
+              msg.eigrp = eigrp;
+              msg.data_type = EIGRP_TLV_IPv4_INT;
+              msg.adv_router = nbr;
+              msg.route = &route;
+              msg.entry = entry;
+              msg.prefix = dest;
+              int event = eigrp_get_fsm_event(&msg);
+              eigrp_fsm_event(&msg, event);
             }
-          eigrp_IPv4_InternalTLV_free (tlv);
         }
     }
   eigrp_hello_send_ack(nbr);
@@ -137,7 +127,7 @@ eigrp_send_siaquery (struct eigrp_neighbor *nbr, struct eigrp_prefix_entry *pe)
       length += eigrp_add_authTLV_MD5_to_stream(ep->s,nbr->ei);
     }
 
-    length += eigrp_add_internalTLV_to_stream(ep->s, pe);
+    length += eigrp_add_prefixTLV_to_stream(ep->s, pe);
 
   if((IF_DEF_PARAMS (nbr->ei->ifp)->auth_type == EIGRP_AUTH_TYPE_MD5) && (IF_DEF_PARAMS (nbr->ei->ifp)->auth_keychain != NULL))
     {
@@ -152,6 +142,7 @@ eigrp_send_siaquery (struct eigrp_neighbor *nbr, struct eigrp_prefix_entry *pe)
 
     /*This ack number we await from neighbor*/
     ep->sequence_number = nbr->ei->eigrp->sequence_number;
+    nbr->ei->eigrp->sequence_number++;
 
     if (nbr->state == EIGRP_NEIGHBOR_UP)
       {
@@ -243,9 +243,9 @@ struct variable eigrp_variables[] =
   /* EIGRP topology variables */
   {EIGRPDESTNETTYPE,       		IPADDRESSTYPE, NOACCESS, eigrpTopologyEntry,
    4, {3, 1, 1, 1}},
-  {EIGRPDESTNET,       	   		IPADDRESSPREFIXLEN, NOACCESS, eigrpTopologyEntry,
+  {EIGRPDESTNET,       	   		IPADDRESS, NOACCESS, eigrpTopologyEntry,
    4, {3, 1, 1, 2}},
-  {EIGRPDESTNETPREFIXLEN,      	IPADDRESSTYPE, NOACCESS, eigrpTopologyEntry,
+  {EIGRPDESTNETPREFIXLEN,      	IPADDRESSPREFIXLEN, NOACCESS, eigrpTopologyEntry,
    4, {3, 1, 1, 4}},
   {EIGRPACTIVE,       	   		INTEGER, RONLY, eigrpTopologyEntry,
    4, {3, 1, 1, 5}},
@@ -345,75 +345,131 @@ struct variable eigrp_variables[] =
    4, {5, 1, 1, 23}}
 };
 
+/*
+ * GETNEXT walks both tables row by row, each request carrying the index
+ * of the row returned last.  The rows come from route tables, whose
+ * route_top()/route_next() order is the same as the order of the index
+ * oids, so the next row is found from the node of the previous one.
+ * That node is kept locked in a cursor: a walk then resumes without a
+ * lookup, and the node stays in the tree even if its row is deleted
+ * between two requests.
+ */
+struct eigrp_snmp_cursor
+{
+  struct route_table *table;
+  struct route_node *rn;
+};
+
+static struct eigrp_snmp_cursor eigrp_snmp_topo_cursor;
+static struct eigrp_snmp_cursor eigrp_snmp_nbr_cursor;
+
+/* Hand a locked node (or NULL) over to the cursor. */
+static void
+eigrp_snmp_cursor_set (struct eigrp_snmp_cursor *cursor,
+                       struct route_table *table, struct route_node *rn)
+{
+  if (cursor->rn)
+    route_unlock_node (cursor->rn);
+  cursor->table = table;
+  cursor->rn = rn;
+}
+
+/* Locked node for p, taken from the cursor when it is there. */
+static struct route_node *
+eigrp_snmp_cursor_get (struct eigrp_snmp_cursor *cursor,
+                       struct route_table *table, struct prefix_ipv4 *p)
+{
+  if (cursor->table == table && cursor->rn
+      && prefix_same (&cursor->rn->p, (struct prefix *) p))
+    return route_lock_node (cursor->rn);
+
+  return route_node_get (table, (struct prefix *) p);
+}
+
+/* Next node holding a row, the node passed in is unlocked. */
+static struct route_node *
+eigrp_snmp_route_next (struct route_node *rn)
+{
+  while ((rn = route_next (rn)) != NULL)
+    if (rn->info)
+      break;
+  return rn;
+}
+
+/* The table is going away, drop the node we hold in it. */
+void
+eigrp_snmp_finish (struct eigrp *eigrp)
+{
+  if (eigrp_snmp_topo_cursor.table == eigrp->topology_table)
+    eigrp_snmp_cursor_set (&eigrp_snmp_topo_cursor, NULL, NULL);
+  if (eigrp_snmp_nbr_cursor.table == eigrp->nbrs_table)
+    eigrp_snmp_cursor_set (&eigrp_snmp_nbr_cursor, NULL, NULL);
+}
+
 static struct eigrp_neighbor *
 eigrp_snmp_nbr_lookup (struct eigrp *eigrp, struct in_addr *nbr_addr,
 		      unsigned int *ifindex)
 {
-  struct listnode *node, *nnode, *node2, *nnode2;
-  struct eigrp_interface *ei;
+  struct prefix_ipv4 p;
+  struct route_node *rn;
   struct eigrp_neighbor *nbr;
 
-  for (ALL_LIST_ELEMENTS (eigrp->eiflist, node, nnode, ei))
-    {
-      for (ALL_LIST_ELEMENTS (ei->nbrs, node2, nnode2, nbr))
-	  {
-	    if (IPV4_ADDR_SAME (&nbr->src, nbr_addr))
-	      {
-			return nbr;
-	      }
-	  }
-    }
+  p.family = AF_INET;
+  p.prefix = *nbr_addr;
+  p.prefixlen = IPV4_MAX_BITLEN;
+
+  rn = route_node_lookup (eigrp->nbrs_table, (struct prefix *) &p);
+  if (! rn)
+    return NULL;
+  route_unlock_node (rn);
+
+  for (nbr = rn->info; nbr; nbr = nbr->addr_next)
+    if (nbr->ei->ifp->ifindex == *ifindex)
+      return nbr;
   return NULL;
 }
 
+/* First neighbor after nbr_addr/ifindex, or at it if inclusive. */
 static struct eigrp_neighbor *
-eigrp_snmp_nbr_lookup_next (struct in_addr *nbr_addr, unsigned int *ifindex,
-			   int first)
+eigrp_snmp_nbr_lookup_next (struct eigrp *eigrp, struct in_addr *nbr_addr,
+			   unsigned int *ifindex, int inclusive)
 {
-  struct listnode *node, *nnode, *node2, *nnode2;
-  struct eigrp_interface *ei;
-  struct eigrp_neighbor *nbr;
+  struct prefix_ipv4 p;
   struct route_node *rn;
-  struct eigrp_neighbor *min = NULL;
-  struct eigrp *eigrp = eigrp;
+  struct eigrp_neighbor *nbr;
 
-  eigrp = eigrp_lookup ();
+  p.family = AF_INET;
+  p.prefix = *nbr_addr;
+  p.prefixlen = IPV4_MAX_BITLEN;
 
-  for (ALL_LIST_ELEMENTS (eigrp->eiflist, node, nnode, ei))
+  rn = eigrp_snmp_cursor_get (&eigrp_snmp_nbr_cursor, eigrp->nbrs_table, &p);
+
+  for (nbr = rn->info; nbr; nbr = nbr->addr_next)
+    if (nbr->ei->ifp->ifindex > *ifindex
+        || (inclusive && nbr->ei->ifp->ifindex == *ifindex))
+      break;
+
+  if (! nbr)
     {
-      for (ALL_LIST_ELEMENTS (ei->nbrs, node2, nnode2, nbr))
-	    {
-			if (first)
-			  {
-				if (! min)
-				  min = nbr;
-				else if (ntohl (nbr->src.s_addr) < ntohl (min->src.s_addr))
-					min = nbr;
-			  }
-			else if (ntohl (nbr->src.s_addr) > ntohl (nbr_addr->s_addr))
-			  {
-				if (! min)
-				  min = nbr;
-				else if (ntohl (nbr->src.s_addr) < ntohl (min->src.s_addr))
-				  min = nbr;
-			  }
-	    }
+      rn = eigrp_snmp_route_next (rn);
+      nbr = rn ? rn->info : NULL;
     }
-  if (min)
+  eigrp_snmp_cursor_set (&eigrp_snmp_nbr_cursor, eigrp->nbrs_table, rn);
+
+  if (nbr)
     {
-      *nbr_addr = min->src;
-      *ifindex = 0;
-      return min;
+      *nbr_addr = nbr->src;
+      *ifindex = nbr->ei->ifp->ifindex;
     }
-  return NULL;
+  return nbr;
 }
 
+/* Peer table INDEX is the peer address followed by its ifindex. */
 static struct eigrp_neighbor *
 eigrpNbrLookup (struct variable *v, oid *name, size_t *length,
 	       struct in_addr *nbr_addr, unsigned int *ifindex, int exact)
 {
-  unsigned int len;
-  int first;
+  int len;
   struct eigrp_neighbor *nbr;
   struct eigrp *eigrp;
 
@@ -434,22 +490,22 @@ eigrpNbrLookup (struct variable *v, oid *name, size_t *length,
     }
   else
     {
-      first = 0;
       len = *length - v->namelen;
-
-      if (len <= 0)
-	first = 1;
+      if (len < 0)
+	len = 0;
 
       if (len > IN_ADDR_SIZE)
-	len = IN_ADDR_SIZE;
+	oid2in_addr (name + v->namelen, IN_ADDR_SIZE, nbr_addr);
+      else if (len > 0)
+	oid2in_addr (name + v->namelen, len, nbr_addr);
 
-      oid2in_addr (name + v->namelen, len, nbr_addr);
-
-      len = *length - v->namelen - IN_ADDR_SIZE;
-      if (len >= 1)
+      /* A complete index asks for the row after it, a partial one for
+         the first row at or after it. */
+      if (len > IN_ADDR_SIZE)
 	*ifindex = name[v->namelen + IN_ADDR_SIZE];
 
-      nbr = eigrp_snmp_nbr_lookup_next (nbr_addr, ifindex, first);
+      nbr = eigrp_snmp_nbr_lookup_next (eigrp, nbr_addr, ifindex,
+					len <= IN_ADDR_SIZE);
 
       if (nbr)
 	{
@@ -462,6 +518,99 @@ eigrpNbrLookup (struct variable *v, oid *name, size_t *length,
   return NULL;
 }
 
+/*
+ * Shortest prefix length addr is a valid network address for, so that
+ * an index naming no real prefix can still be placed in the table.
+ */
+static int
+eigrp_snmp_prefixlen_min (struct in_addr addr)
+{
+  u_int32_t host = ntohl (addr.s_addr);
+  int len = IPV4_MAX_BITLEN;
+
+  if (host == 0)
+    return 0;
+  while ((host & 1) == 0)
+    {
+      host >>= 1;
+      len--;
+    }
+  return len;
+}
+
+/* Topology table INDEX is the destination address and prefix length. */
+static struct eigrp_prefix_entry *
+eigrpTopologyLookup (struct variable *v, oid *name, size_t *length,
+		     struct prefix_ipv4 *p, int exact)
+{
+  int len, min, inclusive;
+  struct route_node *rn;
+  struct eigrp *eigrp;
+
+  eigrp = eigrp_lookup ();
+
+  if (! eigrp)
+    return NULL;
+
+  p->family = AF_INET;
+  len = *length - v->namelen;
+  if (len < 0)
+    len = 0;
+
+  if (exact)
+    {
+      if (len != IN_ADDR_SIZE + 1)
+	return NULL;
+
+      oid2in_addr (name + v->namelen, IN_ADDR_SIZE, &p->prefix);
+      if (name[v->namelen + IN_ADDR_SIZE] > IPV4_MAX_BITLEN
+          || name[v->namelen + IN_ADDR_SIZE]
+             < (oid) eigrp_snmp_prefixlen_min (p->prefix))
+	return NULL;
+      p->prefixlen = name[v->namelen + IN_ADDR_SIZE];
+
+      rn = route_node_lookup (eigrp->topology_table, (struct prefix *) p);
+      if (! rn)
+	return NULL;
+      route_unlock_node (rn);
+      return rn->info;
+    }
+
+  if (len > IN_ADDR_SIZE)
+    oid2in_addr (name + v->namelen, IN_ADDR_SIZE, &p->prefix);
+  else if (len > 0)
+    oid2in_addr (name + v->namelen, len, &p->prefix);
+
+  /* Like the peer table: complete index is exclusive, partial is not.
+     Lengths out of range for the address are moved to where the
+     rows they would sort among actually are. */
+  min = eigrp_snmp_prefixlen_min (p->prefix);
+  inclusive = len <= IN_ADDR_SIZE;
+  p->prefixlen = inclusive ? min : IPV4_MAX_BITLEN;
+  if (! inclusive && name[v->namelen + IN_ADDR_SIZE] < (oid) min)
+    {
+      p->prefixlen = min;
+      inclusive = 1;
+    }
+  else if (! inclusive && name[v->namelen + IN_ADDR_SIZE] < IPV4_MAX_BITLEN)
+    p->prefixlen = name[v->namelen + IN_ADDR_SIZE];
+
+  rn = eigrp_snmp_cursor_get (&eigrp_snmp_topo_cursor,
+			      eigrp->topology_table, p);
+  if (! inclusive || ! rn->info)
+    rn = eigrp_snmp_route_next (rn);
+  eigrp_snmp_cursor_set (&eigrp_snmp_topo_cursor, eigrp->topology_table, rn);
+
+  if (! rn)
+    return NULL;
+
+  *p = *(struct prefix_ipv4 *) &rn->p;
+  *length = v->namelen + IN_ADDR_SIZE + 1;
+  oid_copy_addr (name + v->namelen, &p->prefix, IN_ADDR_SIZE);
+  name[v->namelen + IN_ADDR_SIZE] = p->prefixlen;
+  return rn->info;
+}
+
 
   static u_char *
   eigrpVpnEntry (struct variable *v, oid *name, size_t *length,
@@ -830,17 +979,23 @@ eigrpNbrLookup (struct variable *v, oid *name, size_t *length,
 			 	 int exact, size_t *var_len, WriteMethod **write_method)
   {
 	  struct eigrp *eigrp;
-	  struct eigrp_interface *ei;
-	  struct listnode *node, *nnode;
+	  struct eigrp_prefix_entry *pe;
+	  struct prefix_ipv4 p;
 
 
 	  eigrp = eigrp_lookup ();
 
 	  /* Check whether the instance identifier is valid */
-	  if (smux_header_generic (v, name, length, exact, var_len, write_method)
+	  if (smux_header_table (v, name, length, exact, var_len, write_method)
 	    == MATCH_FAILED)
 	  return NULL;
 
+	  memset (&p, 0, sizeof (struct prefix_ipv4));
+
+	  pe = eigrpTopologyLookup (v, name, length, &p, exact);
+	  if (! pe)
+	    return NULL;
+
 	/* Return the current value of the variable */
 	switch (v->magic)
 	{
@@ -856,32 +1011,18 @@ eigrpNbrLookup (struct variable *v, oid *name, size_t *length,
 			break;
 	case EIGRPDESTNET:           /* 2 */
 	/* The destination IP network number for a single route in the topology table*/
-			if (eigrp)
-			{
-				return SNMP_INTEGER(1);
-			}
-			else
-				return SNMP_INTEGER (0);
+			return SNMP_IPADDRESS (p.prefix);
 			break;
 	case EIGRPDESTNETPREFIXLEN:           /* 4 */
 	/* The prefix length associated with the destination IP network address
 	   for a single route in the topology table in the AS*/
-			if (eigrp)
-			{
-				return SNMP_INTEGER(1);
-			}
-			else
-				return SNMP_INTEGER (0);
+			return SNMP_INTEGER (p.prefixlen);
 			break;
 	case EIGRPACTIVE:           /* 5 */
 	/* A value of true(1) indicates the route to the destination network has failed
 	   A value of false(2) indicates the route is stable (passive).*/
-			if (eigrp)
-			{
-				return SNMP_INTEGER(1);
-			}
-			else
-				return SNMP_INTEGER (0);
+			return SNMP_INTEGER (pe->state == EIGRP_FSM_STATE_PASSIVE
+					     ? SNMP_FALSE : SNMP_TRUE);
 			break;
 	case EIGRPSTUCKINACTIVE:           /* 6 */
 	/* A value of true(1) indicates that that this route which is in active state
@@ -895,21 +1036,11 @@ eigrpNbrLookup (struct variable *v, oid *name, size_t *length,
 			break;
 	case EIGRPDESTSUCCESSORS:           /* 7 */
 	/* Next routing hop for a path to the destination IP network */
-			if (eigrp)
-			{
-				return SNMP_INTEGER(1);
-			}
-			else
-				return SNMP_INTEGER (0);
+			return SNMP_INTEGER (pe->successor_count);
 			break;
 	case EIGRPFDISTANCE:           /* 8 */
 	/* Minimum distance from this router to the destination IP network */
-			if (eigrp)
-			{
-				return SNMP_INTEGER(1);
-			}
-			else
-				return SNMP_INTEGER (0);
+			return SNMP_INTEGER (pe->fdistance);
 			break;
 	case EIGRPROUTEORIGINTYPE:           /* 9 */
 	/* Text string describing the internal origin of the EIGRP route */
@@ -969,22 +1100,12 @@ eigrpNbrLookup (struct variable *v, oid *name, size_t *length,
 			break;
 	case EIGRPDISTANCE:           /* 15 */
 	/* The computed distance to the destination network entry from this router */
-			if (eigrp)
-			{
-				return SNMP_INTEGER(1);
-			}
-			else
-				return SNMP_INTEGER (0);
+			return SNMP_INTEGER (pe->distance);
 			break;
 	case EIGRPREPORTDISTANCE:           /* 16 */
 	/* The computed distance to the destination network in the topology entry
 	   reported to this router by the originator of this route */
-			if (eigrp)
-			{
-				return SNMP_INTEGER(1);
-			}
-			else
-				return SNMP_INTEGER (0);
+			return SNMP_INTEGER (pe->rdistance);
 			break;
 	default:
 		return NULL;
@@ -1006,7 +1127,7 @@ eigrpNbrLookup (struct variable *v, oid *name, size_t *length,
 	  eigrp = eigrp_lookup ();
 
 	  /* Check whether the instance identifier is valid */
-	  if (smux_header_generic (v, name, length, exact, var_len, write_method)
+	  if (smux_header_table (v, name, length, exact, var_len, write_method)
 	  	 == MATCH_FAILED)
 	  return NULL;
 
@@ -1043,21 +1164,11 @@ eigrpNbrLookup (struct variable *v, oid *name, size_t *length,
 	  	  	break;
 	  case EIGRPPEERADDR:           /* 3 */
 	  /* The source IP address used by the peer */
-	  	  	if (eigrp)
-	  	  	{
-	  	  	  	return SNMP_INTEGER(1);
-	  	  	}
-	  	  	else
-	  	  	    return SNMP_INTEGER (0);
+	  	  	return SNMP_IPADDRESS (nbr->src);
 	  	  	break;
 	  case EIGRPPEERIFINDEX:           /* 4 */
 	  /* The ifIndex of the interface on this router */
-	  		if (eigrp)
-	  		{
-	  			return SNMP_INTEGER(1);
-	  		}
-	  		else
-	  			return SNMP_INTEGER (0);
+	  		return SNMP_INTEGER (ifindex);
 	  		break;
 	  case EIGRPHOLDTIME:           /* 5 */
 	  /* How much time must pass without receiving a hello packet from this
@@ -1082,7 +1193,7 @@ eigrpNbrLookup (struct variable *v, oid *name, size_t *length,
 	  /* The computed smooth round trip time for packets to and from the peer */
 	  	  	if (eigrp)
 	  	  	{
-	  	  		return SNMP_INTEGER(1);
+	  	  		return SNMP_INTEGER(nbr->srtt);
 	  	  	}
 	  	  	else
 	  	  	    return SNMP_INTEGER (0);
@@ -1091,7 +1202,7 @@ eigrpNbrLookup (struct variable *v, oid *name, size_t *length,
 	  /* The computed retransmission timeout for the peer */
 	  	  	if (eigrp)
 	  	  	{
-	  	  		return SNMP_INTEGER(1);
+	  	  		return SNMP_INTEGER(nbr->rto);
 	  	  	}
 	  	  	else
 	  	  		return SNMP_INTEGER (0);
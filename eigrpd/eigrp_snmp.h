@@ -31,6 +31,7 @@
 #define _ZEBRA_EIGRP_SNMP_H
 
 extern void eigrp_snmp_init (void);
+extern void eigrp_snmp_finish (struct eigrp *);
 
 
 #endif /* _ZEBRA_EIGRP_SNMP_H */
@@ -0,0 +1,309 @@
+/*
+ * EIGRP Performance Statistics.
+ * Copyright (C) 2013-2014
+ * Authors:
+ *   Donnie Savage
+ *   Jan Janovic
+ *   Matej Perina
+ *   Peter Orsag
+ *   Peter Paluch
+ *
+ * This file is part of GNU Zebra.
+ *
+ * GNU Zebra is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * GNU Zebra is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Zebra; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include <zebra.h>
+
+#include "thread.h"
+#include "prefix.h"
+#include "table.h"
+#include "linklist.h"
+#include "log.h"
+#include "vty.h"
+
+#include "eigrpd/eigrp_structs.h"
+#include "eigrpd/eigrpd.h"
+#include "eigrpd/eigrp_packet.h"
+#include "eigrpd/eigrp_fsm.h"
+#include "eigrpd/eigrp_stats.h"
+
+/*
+ * Counters are bumped inline where things happen; timings go into log2
+ * histograms, which cost an increment and a bit scan per sample and
+ * still give percentiles to within a factor of two.  Everything is kept
+ * in struct eigrp_stats of the instance and only read by the show
+ * commands below.
+ */
+
+static u_int
+eigrp_histogram_bucket (u_int32_t value)
+{
+  u_int i = 0;
+
+  while (value && i < EIGRP_HISTOGRAM_BUCKETS - 1)
+    {
+      value >>= 1;
+      i++;
+    }
+  return i;
+}
+
+void
+eigrp_histogram_add (struct eigrp_histogram *h, u_int32_t value)
+{
+  h->bucket[eigrp_histogram_bucket (value)]++;
+  h->count++;
+  h->sum += value;
+  if (value > h->max)
+    h->max = value;
+}
+
+/* Upper bound of the bucket holding the pct percentile, at most max. */
+static u_int32_t
+eigrp_histogram_percentile (struct eigrp_histogram *h, u_int pct)
+{
+  u_int64_t want, seen = 0;
+  u_int i;
+
+  if (h->count == 0)
+    return 0;
+
+  want = ((u_int64_t) h->count * pct + 99) / 100;
+  for (i = 0; i < EIGRP_HISTOGRAM_BUCKETS - 1; i++)
+    {
+      seen += h->bucket[i];
+      if (seen >= want)
+        return MIN (((u_int64_t) 1 << i) - 1, h->max);
+    }
+  return h->max;
+}
+
+/* Microseconds from start to now, both monotonic. */
+u_int32_t
+eigrp_stats_elapsed (struct timeval *start)
+{
+  struct timeval now;
+  long usec;
+
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &now);
+  usec = (now.tv_sec - start->tv_sec) * 1000000L
+    + (now.tv_usec - start->tv_usec);
+
+  return usec > 0 ? usec : 0;
+}
+
+/* Account one DUAL event, state is the one the prefix was in before. */
+void
+eigrp_stats_fsm (struct eigrp_fsm_action_message *msg, int event,
+                 u_char state)
+{
+  struct eigrp_stats *stats = &msg->eigrp->stats;
+  struct eigrp_prefix_entry *prefix = msg->prefix;
+
+  if (event <= EIGRP_FSM_KEEP_STATE)
+    stats->dual_events[event]++;
+
+  if (state == EIGRP_FSM_STATE_PASSIVE
+      && prefix->state != EIGRP_FSM_STATE_PASSIVE)
+    {
+      stats->went_active++;
+      quagga_gettime (QUAGGA_CLK_MONOTONIC, &prefix->active_since);
+    }
+  else if (state != EIGRP_FSM_STATE_PASSIVE
+           && prefix->state == EIGRP_FSM_STATE_PASSIVE)
+    {
+      stats->went_passive++;
+      eigrp_histogram_add (&stats->active_time,
+                           eigrp_stats_elapsed (&prefix->active_since));
+    }
+}
+
+void
+eigrp_stats_clear (struct eigrp *eigrp)
+{
+  struct eigrp_interface *ei;
+  struct eigrp_neighbor *nbr;
+  struct listnode *node, *node2;
+
+  memset (&eigrp->stats, 0, sizeof (eigrp->stats));
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &eigrp->stats.cleared);
+
+  for (ALL_LIST_ELEMENTS_RO (eigrp->eiflist, node, ei))
+    for (ALL_LIST_ELEMENTS_RO (ei->nbrs, node2, nbr))
+      {
+        nbr->retrans_sent = 0;
+        nbr->retrans_queue->count_max = nbr->retrans_queue->count;
+        nbr->multicast_queue->count_max = nbr->multicast_queue->count;
+      }
+}
+
+static void
+eigrp_stats_show_histogram (struct vty *vty, const char *name,
+                            struct eigrp_histogram *h)
+{
+  vty_out (vty, "%-30s %10u %9llu %9u %9u %9u %9u%s", name, h->count,
+           h->count ? (unsigned long long) (h->sum / h->count) : 0ULL,
+           eigrp_histogram_percentile (h, 50),
+           eigrp_histogram_percentile (h, 90),
+           eigrp_histogram_percentile (h, 99),
+           h->max, VTY_NEWLINE);
+}
+
+void
+eigrp_stats_show (struct vty *vty, struct eigrp *eigrp)
+{
+  struct eigrp_stats *stats = &eigrp->stats;
+  struct eigrp_interface *ei;
+  struct eigrp_neighbor *nbr;
+  struct listnode *node, *node2;
+  unsigned long queued = 0, peak = 0;
+  char name[32];
+  int i;
+
+  vty_out (vty, "%sEIGRP statistics for AS(%d), collected over %u sec%s%s",
+           VTY_NEWLINE, eigrp->AS,
+           eigrp_stats_elapsed (&stats->cleared) / 1000000,
+           VTY_NEWLINE, VTY_NEWLINE);
+
+  vty_out (vty, "DUAL events:%s", VTY_NEWLINE);
+  for (i = 0; i <= EIGRP_FSM_KEEP_STATE; i++)
+    vty_out (vty, "  %-12s %u%s", eigrp_fsm_event_str[i],
+             stats->dual_events[i], VTY_NEWLINE);
+  vty_out (vty, "Prefixes gone active %u, back to passive %u%s",
+           stats->went_active, stats->went_passive, VTY_NEWLINE);
+
+  for (ALL_LIST_ELEMENTS_RO (eigrp->eiflist, node, ei))
+    for (ALL_LIST_ELEMENTS_RO (ei->nbrs, node2, nbr))
+      {
+        queued += nbr->retrans_queue->count;
+        peak = MAX (peak, nbr->retrans_queue->count_max);
+      }
+  vty_out (vty, "Retransmissions %u, retransmit queues hold %lu packets, "
+           "deepest was %lu%s%s", stats->retransmissions, queued, peak,
+           VTY_NEWLINE, VTY_NEWLINE);
+
+  vty_out (vty, "%-30s %10s %9s %9s %9s %9s %9s%s", "", "Count", "Avg",
+           "p50", "p90", "p99", "Max", VTY_NEWLINE);
+  eigrp_stats_show_histogram (vty, "Active time (usec)",
+                              &stats->active_time);
+  for (i = 0; i <= EIGRP_OPC_SIAREPLY; i++)
+    {
+      if (stats->recv_time[i].count == 0)
+        continue;
+      snprintf (name, sizeof (name), "Receive %s (usec)",
+                LOOKUP (eigrp_packet_type_str, i));
+      eigrp_stats_show_histogram (vty, name, &stats->recv_time[i]);
+    }
+  eigrp_stats_show_histogram (vty, "Zebra install latency (usec)",
+                              &stats->zebra_latency);
+  eigrp_stats_show_histogram (vty, "Prefixes per zebra flush",
+                              &stats->zebra_batch);
+  eigrp_stats_show_histogram (vty, "Packets per DUAL flush",
+                              &stats->flush_batch);
+}
+
+static void
+eigrp_stats_raw_histogram (struct vty *vty, struct eigrp *eigrp,
+                           const char *name, const char *label,
+                           struct eigrp_histogram *h)
+{
+  u_int64_t seen = 0;
+  int i, last;
+
+  for (last = EIGRP_HISTOGRAM_BUCKETS - 1; last > 0; last--)
+    if (h->bucket[last])
+      break;
+
+  for (i = 0; i <= last && i < EIGRP_HISTOGRAM_BUCKETS - 1; i++)
+    {
+      seen += h->bucket[i];
+      vty_out (vty, "eigrp_%s_bucket{as=\"%d\"%s,le=\"%llu\"} %llu%s",
+               name, eigrp->AS, label,
+               (unsigned long long) (((u_int64_t) 1 << i) - 1),
+               (unsigned long long) seen, VTY_NEWLINE);
+    }
+  vty_out (vty, "eigrp_%s_bucket{as=\"%d\"%s,le=\"+Inf\"} %u%s",
+           name, eigrp->AS, label, h->count, VTY_NEWLINE);
+  vty_out (vty, "eigrp_%s_sum{as=\"%d\"%s} %llu%s", name, eigrp->AS, label,
+           (unsigned long long) h->sum, VTY_NEWLINE);
+  vty_out (vty, "eigrp_%s_count{as=\"%d\"%s} %u%s", name, eigrp->AS, label,
+           h->count, VTY_NEWLINE);
+}
+
+/*
+ * The same numbers in the Prometheus text format, one sample per line,
+ * for scripts that graph convergence over time.  Histogram buckets are
+ * cumulative, as the format wants.
+ */
+void
+eigrp_stats_show_raw (struct vty *vty, struct eigrp *eigrp)
+{
+  struct eigrp_stats *stats = &eigrp->stats;
+  struct eigrp_interface *ei;
+  struct eigrp_neighbor *nbr;
+  struct listnode *node, *node2;
+  char label[64];
+  int i;
+
+  vty_out (vty, "eigrp_stats_age_seconds{as=\"%d\"} %u%s", eigrp->AS,
+           eigrp_stats_elapsed (&stats->cleared) / 1000000, VTY_NEWLINE);
+  for (i = 0; i <= EIGRP_FSM_KEEP_STATE; i++)
+    vty_out (vty, "eigrp_dual_events_total{as=\"%d\",event=\"%s\"} %u%s",
+             eigrp->AS, eigrp_fsm_event_str[i], stats->dual_events[i],
+             VTY_NEWLINE);
+  vty_out (vty, "eigrp_went_active_total{as=\"%d\"} %u%s", eigrp->AS,
+           stats->went_active, VTY_NEWLINE);
+  vty_out (vty, "eigrp_went_passive_total{as=\"%d\"} %u%s", eigrp->AS,
+           stats->went_passive, VTY_NEWLINE);
+  vty_out (vty, "eigrp_retransmissions_total{as=\"%d\"} %u%s", eigrp->AS,
+           stats->retransmissions, VTY_NEWLINE);
+
+  eigrp_stats_raw_histogram (vty, eigrp, "active_usec", "",
+                             &stats->active_time);
+  for (i = 0; i <= EIGRP_OPC_SIAREPLY; i++)
+    {
+      if (stats->recv_time[i].count == 0)
+        continue;
+      snprintf (label, sizeof (label), ",opcode=\"%s\"",
+                LOOKUP (eigrp_packet_type_str, i));
+      eigrp_stats_raw_histogram (vty, eigrp, "recv_usec", label,
+                                 &stats->recv_time[i]);
+    }
+  eigrp_stats_raw_histogram (vty, eigrp, "zebra_latency_usec", "",
+                             &stats->zebra_latency);
+  eigrp_stats_raw_histogram (vty, eigrp, "zebra_batch_prefixes", "",
+                             &stats->zebra_batch);
+  eigrp_stats_raw_histogram (vty, eigrp, "dual_flush_packets", "",
+                             &stats->flush_batch);
+
+  for (ALL_LIST_ELEMENTS_RO (eigrp->eiflist, node, ei))
+    for (ALL_LIST_ELEMENTS_RO (ei->nbrs, node2, nbr))
+      {
+        snprintf (label, sizeof (label), "as=\"%d\",neighbor=\"%s\"",
+                  eigrp->AS, inet_ntoa (nbr->src));
+        vty_out (vty, "eigrp_neighbor_srtt_msec{%s} %u%s", label,
+                 nbr->srtt, VTY_NEWLINE);
+        vty_out (vty, "eigrp_neighbor_rto_msec{%s} %u%s", label,
+                 nbr->rto, VTY_NEWLINE);
+        vty_out (vty, "eigrp_neighbor_retransmissions_total{%s} %u%s", label,
+                 nbr->retrans_sent, VTY_NEWLINE);
+        vty_out (vty, "eigrp_neighbor_retrans_queue{%s} %lu%s", label,
+                 nbr->retrans_queue->count, VTY_NEWLINE);
+        vty_out (vty, "eigrp_neighbor_retrans_queue_peak{%s} %lu%s", label,
+                 nbr->retrans_queue->count_max, VTY_NEWLINE);
+      }
+}
@@ -0,0 +1,39 @@
+/*
+ * EIGRP Performance Statistics.
+ * Copyright (C) 2013-2014
+ * Authors:
+ *   Donnie Savage
+ *   Jan Janovic
+ *   Matej Perina
+ *   Peter Orsag
+ *   Peter Paluch
+ *
+ * This file is part of GNU Zebra.
+ *
+ * GNU Zebra is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * GNU Zebra is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Zebra; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef _ZEBRA_EIGRP_STATS_H_
+#define _ZEBRA_EIGRP_STATS_H_
+
+extern void eigrp_histogram_add (struct eigrp_histogram *, u_int32_t);
+extern u_int32_t eigrp_stats_elapsed (struct timeval *);
+extern void eigrp_stats_fsm (struct eigrp_fsm_action_message *, int, u_char);
+extern void eigrp_stats_clear (struct eigrp *);
+extern void eigrp_stats_show (struct vty *, struct eigrp *);
+extern void eigrp_stats_show_raw (struct vty *, struct eigrp *);
+
+#endif /* _ZEBRA_EIGRP_STATS_H_ */
@@ -71,13 +71,65 @@ struct eigrp_metrics
   u_char flags;
 };
 
+/*
+ * Log2 histogram: bucket 0 counts zeros, bucket i counts values in
+ * [2^(i-1), 2^i), the last bucket everything above.
+ */
+#define EIGRP_HISTOGRAM_BUCKETS		32
+
+struct eigrp_histogram
+{
+  u_int32_t bucket[EIGRP_HISTOGRAM_BUCKETS];
+  u_int32_t count;
+  u_int32_t max;
+  u_int64_t sum;
+};
+
+/* Instrumentation of one EIGRP instance, see eigrp_stats.c */
+struct eigrp_stats
+{
+  struct timeval cleared;		/* monotonic time of last clear */
+
+  u_int32_t dual_events[EIGRP_FSM_KEEP_STATE + 1];
+  u_int32_t went_active;		/* prefixes gone active */
+  u_int32_t went_passive;		/* prefixes back to passive */
+  struct eigrp_histogram active_time;	/* usec spent active */
+
+  struct eigrp_histogram recv_time[EIGRP_OPC_SIAREPLY + 1]; /* usec per packet */
+
+  u_int32_t retransmissions;
+
+  struct timeval zebra_queued;		/* first prefix queued for the flush */
+  struct eigrp_histogram zebra_latency;	/* usec from queueing to sent */
+  struct eigrp_histogram zebra_batch;	/* prefixes per zebra flush */
+
+  u_int32_t flush_packets;		/* packets since the last DUAL flush */
+  struct eigrp_histogram flush_batch;	/* packets per DUAL flush */
+};
+
+/*
+ * Hashed timer wheel of the neighbors waiting for an ack.  Slot i holds
+ * the neighbors whose RTO expires i ticks after the slot 0 tick; only the
+ * tail of the retransmission queue is ever in flight, so it is one timer
+ * per neighbor.
+ */
+struct eigrp_rto_wheel
+{
+  struct eigrp_neighbor *slots[EIGRP_RTO_WHEEL_SLOTS];
+  u_int32_t current;            /* slot expiring on the next tick */
+  u_int32_t count;              /* armed neighbors */
+  struct thread *t_tick;        /* running while count > 0 */
+};
+
 struct eigrp
 {
   u_int16_t AS;			/* Autonomous system number */
   u_int16_t vrid;		/* Virtual Router ID */
   u_char    k_values[6];	/*Array for K values configuration*/
+  u_char    metric_kernel;	/*Metric formula for k_values, see eigrp_metric_kernel_update()*/
   u_char variance;              /*Metric variance multiplier*/
   u_char max_paths;             /*Maximum allowed paths for 1 prefix*/
+  u_int16_t stub;               /*EIGRP_STUB_* flags, 0 when not a stub router*/
 
   /*Name of this EIGRP instance*/
   char *name;
@@ -87,6 +139,7 @@ struct eigrp
   u_int32_t router_id_static; /* Configured manually. */
 
   struct list *eiflist; /* eigrp interfaces */
+  struct route_table *nbrs_table; /* neighbors of all interfaces, by address */
   u_char passive_interface_default; /* passive-interface default */
 
   unsigned int fd;
@@ -103,20 +156,47 @@ struct eigrp
 
   struct route_table *networks; /* EIGRP config networks. */
 
-  struct list *topology_table;
+  struct route_table *topology_table; /* EIGRP topology, keyed by prefix */
+  struct route_table *topology_active; /* active prefixes of the topology */
 
   u_int64_t serno; /* Global serial number counter for topology entry changes*/
   u_int64_t serno_last_update; /* Highest serial number of information send by last update*/
-  struct list *topology_changes_internalIPV4;
+  u_int64_t serno_last_query; /* Highest serial number of information send by last query*/
+
+  /* Changed internal IPv4 prefixes, ordered by serno */
+  struct eigrp_prefix_entry *topology_changes_head;
+  struct eigrp_prefix_entry *topology_changes_tail;
   struct list *topology_changes_externalIPV4;
 
+  /* Deferred sending of Queries/Updates for topology changes */
+  struct thread *t_dual_flush;
+  u_int32_t dual_flush_delay; /* coalescing window, msec */
+  struct eigrp_interface *dual_flush_exception; /* no Updates sent here */
+
+  /* Prefixes whose routes are to be (re)installed into zebra */
+  struct list *zebra_route_queue;
+  struct thread *t_zebra_flush;
+
+  /* Retransmission timers of all the neighbors */
+  struct eigrp_rto_wheel rto_wheel;
+
+  /* Counters and histograms for show ip eigrp statistics */
+  struct eigrp_stats stats;
+
   /*Neighbor self*/
   struct eigrp_neighbor *neighbor_self;
 
-  /*Configured metric for redistributed routes*/
+  /*Configured metric for redistributed routes, bandwidth in kbps and
+    delay in tens of microseconds as entered*/
   struct eigrp_metrics dmetric[ZEBRA_ROUTE_MAX + 1];
   int redistribute;           /* Num of redistributed protocols. */
 
+  /* Redistributed routes by source protocol, keyed by prefix */
+  struct route_table *external[ZEBRA_ROUTE_MAX + 1];
+  struct eigrp_external *external_pending_head;
+  struct eigrp_external *external_pending_tail;
+  struct thread *t_external;
+
 };
 
 //------------------------------------------------------------------------------------------------------------------------------------------
@@ -148,12 +228,23 @@ struct eigrp_interface
 
   /* Neighbor information. */
   struct list *nbrs; /* EIGRP Neighbor List */
+  struct hash *nbrs_hash; /* Same neighbors, keyed by source address */
 
   /* Threads. */
   struct thread *t_hello; /* timer */
+  struct thread *t_holddown; /* earliest hold time expiry of the neighbors */
+  struct timeval holddown_next; /* when t_holddown fires */
 
   int on_write_q;
 
+  /* Authentication state per key id, see eigrp_auth_key_get() */
+  struct list *auth_keys;
+
+  /* Encoded periodic Hello, see eigrp_hello_template() */
+  struct eigrp_packet *hello;
+  struct key *hello_key; /* key it is signed with, if any */
+  char *hello_key_string; /* and the secret of that key then */
+
   /* Access-list. */
   struct access_list *list[EIGRP_FILTER_MAX];
 
@@ -180,13 +271,21 @@ struct eigrp_interface
   u_int32_t ack_in;
 
   u_int32_t crypt_seqnum;             /* Cryptographic Sequence Number */
+
+  /* Link cost added to routes learned here, see eigrp_if_cost_update() */
+  u_int32_t cost_delay;
+  u_int32_t cost_bandwidth;
+
+  /* Highest topology change serno sent out of the interface */
+  u_int64_t serno_last_update;
+  u_int64_t serno_last_query;
 };
 
 struct eigrp_if_params
 {
   DECLARE_IF_PARAM (u_char, passive_interface); /* EIGRP Interface is passive: no sending or receiving (no need to join multicast groups) */
-  DECLARE_IF_PARAM (u_int32_t, v_hello); /* Hello Interval */
-  DECLARE_IF_PARAM (u_int16_t, v_wait); /* Router Hold Time Interval */
+  DECLARE_IF_PARAM (u_int32_t, v_hello); /* Hello Interval, msec */
+  DECLARE_IF_PARAM (u_int32_t, v_wait); /* Router Hold Time Interval, msec */
   DECLARE_IF_PARAM (u_char, type); /* type of interface */
   DECLARE_IF_PARAM (u_int32_t, bandwidth);
   DECLARE_IF_PARAM (u_int32_t, delay);
@@ -208,6 +307,37 @@ struct eigrp_if_info
   struct route_table *params;
   struct route_table *eifs;
   unsigned int membership_counts[MEMBER_MAX]; /* multicast group refcnts */
+  struct route_table *summaries; /* struct eigrp_summary by prefix, ip summary-address */
+};
+
+/* Summary address configured on an interface, see eigrp_summary.c */
+struct eigrp_summary
+{
+  struct prefix_ipv4 prefix;
+  u_int32_t components;         /* reachable routes covered by the summary */
+  u_int32_t distance;           /* best distance among them */
+  struct eigrp_metrics metric;  /* reported metric of that route */
+  u_int32_t adv_distance;       /* distance last sent in Updates */
+  u_char dirty;                 /* components changed since last count */
+};
+
+/* Route redistributed from zebra, see eigrp_external.c */
+struct eigrp_external
+{
+  struct prefix_ipv4 p;
+  u_char type;                  /* ZEBRA_ROUTE_* it came from */
+  struct in_addr nexthop;
+  u_int32_t metric;             /* metric of the route in its protocol */
+
+  /* Redistribute metric evaluated for the route, and what is advertised */
+  struct eigrp_metrics emetric;
+  u_int32_t distance;
+  u_char originated;            /* the route is ours in the topology */
+
+  /* Waiting to be taken into the topology */
+  u_char pending;
+  u_char withdrawn;             /* gone from zebra, freed once processed */
+  struct eigrp_external *pending_next;
 };
 
 //------------------------------------------------------------------------------------------------------------------------------------------
@@ -228,11 +358,13 @@ struct eigrp_neighbor
   u_char retrans_counter;
 
   struct in_addr src; /* Neighbor Src address. */
+  struct eigrp_neighbor *addr_next; /* same src on another interface */
 
   u_char os_rel_major;		// system version - just for show
   u_char os_rel_minor;		// system version - just for show
   u_char tlv_rel_major;		// eigrp version - tells us what TLV format to use
   u_char tlv_rel_minor;		// eigrp version - tells us what TLV format to use
+  u_int16_t stub;		// EIGRP_STUB_* flags from the Stub TLV, 0 if not a stub
 
   u_char K1;
   u_char K2;
@@ -242,34 +374,75 @@ struct eigrp_neighbor
   u_char K6;
 
   /* Timer values. */
-  u_int16_t v_holddown;
+  u_int32_t v_holddown; /* msec */
 
-  /* Threads. */
-  struct thread *t_holddown;
+  /* Hold time expiry, scanned by the interface t_holddown; zero if not running */
+  struct timeval holddown;
 
   struct eigrp_fifo *retrans_queue;
   struct eigrp_fifo *multicast_queue;
 
+  /* Hello carrying our acks to the neighbor, reused once written */
+  struct eigrp_packet *hello_ack;
+
+  /* Retransmission timer, see struct eigrp_rto_wheel */
+  struct eigrp_neighbor *rto_next;
+  struct eigrp_neighbor *rto_prev;
+  u_int16_t rto_slot;
+  u_char rto_armed;
+
+  /* Round trip time estimation, msec */
+  u_int32_t srtt;
+  u_int32_t rttvar;
+  u_int32_t rto;
+  u_int32_t rtt_samples;
+  u_int32_t retrans_sent;        /* retransmissions of all packets */
+  struct timeval rtt_start;     /* first transmission of the in-flight packet */
+
+  /* Conditional receive: accept the multicast with cr_sequence */
+  u_char cr_mode;
+  u_int32_t cr_sequence;
+
   u_int32_t crypt_seqnum;           /* Cryptographic Sequence Number. */
+
+  /* Highest topology change serno the neighbor has been sent */
+  u_int64_t serno_last_update;
+
+  /* Topology entries advertised by this neighbor */
+  struct eigrp_neighbor_entry *entries;
+  u_int32_t entries_count;
 };
 
 //---------------------------------------------------------------------------------------------------------------------------------------------
 
 
+/*
+ * Encoded packet, shared by all the eigrp_packets (retransmission queue
+ * entries of each neighbor, interface output queue entries) sending it.
+ * Immutable once the packet is queued.
+ */
+struct eigrp_packet_data
+{
+  struct stream *s;
+
+  /* Number of eigrp_packets referring to the data */
+  u_int32_t refcnt;
+};
+
 struct eigrp_packet
 {
   struct eigrp_packet *next;
   struct eigrp_packet *previous;
 
-  /* Pointer to data stream. */
+  /* Shared encoded packet. */
+  struct eigrp_packet_data *data;
+
+  /* Pointer to data stream, same as data->s. */
   struct stream *s;
 
   /* IP destination address. */
   struct in_addr dst;
 
-  /*Packet retransmission thread*/
-  struct thread *t_retrans_timer;
-
   /*Packet retransmission counter*/
   u_char retrans_counter;
 
@@ -285,6 +458,7 @@ struct eigrp_fifo
   struct eigrp_packet *tail;
 
   unsigned long count;
+  unsigned long count_max;	/* high-water mark of count */
 };
 
 struct eigrp_header
@@ -382,6 +556,13 @@ struct TLV_Software_Type
   u_char eigrp_minor;
 }__attribute__((packed));
 
+struct TLV_Stub_Type
+{
+  u_int16_t type;
+  u_int16_t length;
+  u_int16_t flags;
+}__attribute__((packed));
+
 struct TLV_IPv4_Internal_type
 {
   u_int16_t type;
@@ -418,6 +599,23 @@ struct TLV_IPv4_External_type
   struct in_addr destination;
 }__attribute__((packed));
 
+/* Route TLV of a received packet, decoded by eigrp_tlv_route_next() */
+struct eigrp_route_tlv
+{
+  u_int16_t type;               /* EIGRP_TLV_IPv4_INT or EIGRP_TLV_IPv4_EXT */
+  struct prefix_ipv4 prefix;
+  struct in_addr nexthop;
+  struct eigrp_metrics metric;
+
+  /* External routes only */
+  struct in_addr originating_router;
+  u_int32_t originating_as;
+  u_int32_t administrative_tag;
+  u_int32_t external_metric;
+  u_char external_protocol;
+  u_char external_flags;
+};
+
 //---------------------------------------------------------------------------------------------------------------------------------------------
 
 /* EIGRP Topology table node structure */
@@ -433,6 +631,7 @@ struct eigrp_prefix_entry
   u_char state; 							//route fsm state
   u_char af;								// address family
   u_char req_action;						// required action
+  u_char zebra_queued;						// waiting in zebra route queue
 
   struct prefix_ipv4 *destination_ipv4;		// pointer to struct with ipv4 address
   struct prefix_ipv6 *destination_ipv6;		// pointer to struct with ipv6 address
@@ -441,6 +640,17 @@ struct eigrp_prefix_entry
   struct TLV_IPv4_External_type *extTLV;
 
   u_int64_t serno; /*Serial number for this entry. Increased with each change of entry*/
+
+  struct timeval active_since;	/* monotonic time the entry went active */
+
+  /* Selection cached from entries flags, see eigrp_prefix_entry_select() */
+  struct eigrp_neighbor_entry *successor;	// best successor
+  struct eigrp_neighbor_entry *fsuccessor;	// best feasible successor
+  u_int32_t successor_count;
+
+  /* Links in the instance change log */
+  struct eigrp_prefix_entry *change_next;
+  struct eigrp_prefix_entry *change_prev;
 };
 
 /* EIGRP Topology table record structure */
@@ -458,6 +668,9 @@ struct eigrp_neighbor_entry
 
   struct eigrp_interface *ei; 				//pointer for case of connected entry
 
+  /* Links in adv_router's list of advertised entries */
+  struct eigrp_neighbor_entry *nbr_next;
+  struct eigrp_neighbor_entry *nbr_prev;
 };
 
 //---------------------------------------------------------------------------------------------------------------------------------------------
@@ -472,10 +685,7 @@ struct eigrp_fsm_action_message
   struct eigrp_neighbor_entry *entry;
   struct eigrp_prefix_entry *prefix;
   int data_type; // internal or external tlv type
-  union{
-    struct TLV_IPv4_External_type *ipv4_ext_data;
-    struct TLV_IPv4_Internal_type *ipv4_int_type;
-  }data;
+  struct eigrp_route_tlv *route;
 };
 
 #endif /* _ZEBRA_EIGRP_STRUCTURES_H_ */
@@ -0,0 +1,225 @@
+/*
+ * EIGRP Summary Addresses.
+ * Copyright (C) 2013-2014
+ * Authors:
+ *   Donnie Savage
+ *   Jan Janovic
+ *   Matej Perina
+ *   Peter Orsag
+ *   Peter Paluch
+ *
+ * This file is part of GNU Zebra.
+ *
+ * GNU Zebra is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * GNU Zebra is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Zebra; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include <zebra.h>
+
+#include "prefix.h"
+#include "table.h"
+#include "memory.h"
+#include "linklist.h"
+#include "if.h"
+
+#include "eigrpd/eigrp_structs.h"
+#include "eigrpd/eigrpd.h"
+#include "eigrpd/eigrp_macros.h"
+#include "eigrpd/eigrp_summary.h"
+
+/*
+ * A summary address configured on an interface replaces, in everything
+ * sent out of it, all the routes it covers (its components) with one
+ * route to the summary.  The summary is advertised with the metric of
+ * its best component for as long as there is a reachable one.
+ *
+ * Components are not tracked one by one: every topology change marks
+ * the summaries covering the prefix dirty, and a dirty summary walks its
+ * part of the topology table again the next time it is looked at.
+ *
+ * The summaries of an interface are kept in a table keyed by their
+ * prefix, so those covering a prefix are found by walking up from its
+ * longest match, whatever the number of summaries.
+ */
+
+struct eigrp_summary *
+eigrp_summary_find (struct interface *ifp, struct prefix_ipv4 *p)
+{
+  struct route_node *rn;
+
+  rn = route_node_lookup(IF_SUMMARIES(ifp), (struct prefix *)p);
+  if (rn == NULL)
+    return NULL;
+
+  route_unlock_node(rn);
+  return rn->info;
+}
+
+struct eigrp_summary *
+eigrp_summary_get (struct interface *ifp, struct prefix_ipv4 *p)
+{
+  struct eigrp_summary *sum;
+  struct route_node *rn;
+
+  rn = route_node_get(IF_SUMMARIES(ifp), (struct prefix *)p);
+  if (rn->info)
+    {
+      route_unlock_node(rn);
+      return rn->info;
+    }
+
+  sum = XCALLOC(MTYPE_EIGRP_SUMMARY, sizeof(struct eigrp_summary));
+  sum->prefix = *p;
+  apply_mask_ipv4(&sum->prefix);
+  sum->distance = sum->adv_distance = EIGRP_MAX_METRIC;
+  sum->metric.delay = EIGRP_MAX_METRIC;
+  sum->dirty = 1;
+
+  /* the node keeps the lock taken by route_node_get() */
+  rn->info = sum;
+
+  return sum;
+}
+
+/*
+ * Take the summary out of the interface's table, components are no
+ * longer matched against it.  It is still to be freed.
+ */
+void
+eigrp_summary_remove (struct interface *ifp, struct eigrp_summary *sum)
+{
+  struct route_node *rn;
+
+  rn = route_node_lookup(IF_SUMMARIES(ifp), (struct prefix *)&sum->prefix);
+  if (rn == NULL || rn->info != sum)
+    {
+      if (rn)
+        route_unlock_node(rn);
+      return;
+    }
+
+  rn->info = NULL;
+  route_unlock_node(rn); /* lock taken by eigrp_summary_get() */
+  route_unlock_node(rn); /* lock taken by route_node_lookup() */
+}
+
+void
+eigrp_summary_free (struct eigrp_summary *sum)
+{
+  XFREE(MTYPE_EIGRP_SUMMARY, sum);
+}
+
+/* Free all the summaries of the interface together with their table */
+void
+eigrp_summary_finish (struct interface *ifp)
+{
+  struct route_node *rn;
+
+  for (rn = route_top(IF_SUMMARIES(ifp)); rn; rn = route_next(rn))
+    if (rn->info)
+      {
+        eigrp_summary_free(rn->info);
+        rn->info = NULL;
+        route_unlock_node(rn);
+      }
+
+  route_table_finish(IF_SUMMARIES(ifp));
+  IF_SUMMARIES(ifp) = NULL;
+}
+
+/*
+ * Return the summary on the interface the prefix is a component of, NULL
+ * if it is advertised out of the interface as it is.  Of nested summaries
+ * the most specific one is returned.
+ */
+struct eigrp_summary *
+eigrp_summary_lookup (struct eigrp_interface *ei, struct prefix_ipv4 *p)
+{
+  struct route_node *rn;
+
+  rn = route_node_match(IF_SUMMARIES(ei->ifp), (struct prefix *)p);
+  if (rn == NULL)
+    return NULL;
+
+  route_unlock_node(rn);
+  return rn->info;
+}
+
+/*
+ * Prefix entry has changed, summaries covering it must be recomputed.
+ */
+void
+eigrp_summary_touch (struct eigrp *eigrp, struct eigrp_prefix_entry *pe)
+{
+  struct eigrp_interface *ei;
+  struct eigrp_summary *sum;
+  struct route_node *rn, *match;
+  struct listnode *node;
+
+  for (ALL_LIST_ELEMENTS_RO(eigrp->eiflist, node, ei))
+    {
+      match = route_node_match(IF_SUMMARIES(ei->ifp),
+                               (struct prefix *)pe->destination_ipv4);
+      if (match == NULL)
+        continue;
+
+      /* the match and the nodes above it cover the prefix */
+      for (rn = match; rn; rn = rn->parent)
+        if ((sum = rn->info) != NULL)
+          sum->dirty = 1;
+
+      route_unlock_node(match);
+    }
+}
+
+/*
+ * Recount the reachable components of a dirty summary and pick up the
+ * metric of the best one.  Only the part of the topology table below the
+ * summary prefix is walked.
+ */
+void
+eigrp_summary_refresh (struct eigrp *eigrp, struct eigrp_summary *sum)
+{
+  struct eigrp_prefix_entry *pe;
+  struct route_node *rn, *top;
+
+  if (!sum->dirty)
+    return;
+
+  sum->dirty = 0;
+  sum->components = 0;
+  sum->distance = EIGRP_MAX_METRIC;
+  memset(&sum->metric, 0, sizeof(sum->metric));
+  sum->metric.delay = EIGRP_MAX_METRIC;
+
+  top = route_node_get(eigrp->topology_table, (struct prefix *)&sum->prefix);
+  /* keep top in place while the walk drops its own lock on it */
+  route_lock_node(top);
+
+  for (rn = top; rn; rn = route_next_until(rn, top))
+    {
+      if ((pe = rn->info) == NULL || pe->distance == EIGRP_MAX_METRIC)
+        continue;
+
+      sum->components++;
+      if (pe->distance < sum->distance)
+        {
+          sum->distance = pe->distance;
+          sum->metric = pe->reported_metric;
+        }
+    }
+
+  route_unlock_node(top);
+}
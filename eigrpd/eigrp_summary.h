@@ -0,0 +1,42 @@
+/*
+ * EIGRP Summary Addresses.
+ * Copyright (C) 2013-2014
+ * Authors:
+ *   Donnie Savage
+ *   Jan Janovic
+ *   Matej Perina
+ *   Peter Orsag
+ *   Peter Paluch
+ *
+ * This file is part of GNU Zebra.
+ *
+ * GNU Zebra is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * GNU Zebra is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Zebra; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef _ZEBRA_EIGRP_SUMMARY_H
+#define _ZEBRA_EIGRP_SUMMARY_H
+
+/* Per interface summary addresses, see eigrp_summary.c */
+extern struct eigrp_summary *eigrp_summary_get (struct interface *, struct prefix_ipv4 *);
+extern struct eigrp_summary *eigrp_summary_find (struct interface *, struct prefix_ipv4 *);
+extern void eigrp_summary_remove (struct interface *, struct eigrp_summary *);
+extern void eigrp_summary_free (struct eigrp_summary *);
+extern void eigrp_summary_finish (struct interface *);
+extern struct eigrp_summary *eigrp_summary_lookup (struct eigrp_interface *, struct prefix_ipv4 *);
+extern void eigrp_summary_touch (struct eigrp *, struct eigrp_prefix_entry *);
+extern void eigrp_summary_refresh (struct eigrp *, struct eigrp_summary *);
+
+#endif /* _ZEBRA_EIGRP_SUMMARY_H */
@@ -45,84 +45,212 @@
 #include "eigrpd/eigrp_dump.h"
 #include "eigrpd/eigrp_topology.h"
 #include "eigrpd/eigrp_fsm.h"
+#include "eigrpd/eigrp_summary.h"
+#include "eigrpd/eigrp_external.h"
 
-static int
-eigrp_prefix_entry_cmp(struct eigrp_prefix_entry *, struct eigrp_prefix_entry *);
-static void
-eigrp_prefix_entry_del(struct eigrp_prefix_entry *);
 static int
 eigrp_neighbor_entry_cmp(struct eigrp_neighbor_entry *,
     struct eigrp_neighbor_entry *);
+static void
+eigrp_prefix_entry_select(struct eigrp_prefix_entry *);
 
 /*
- * asdf;laksdjf;lajsdf;kasdjf;asdjf;
- * asdfaskdjfa;sdkjf;adlskj
- * Returns linkedlist used as topology table
- * cmp - assigned function for comparing topology nodes
- * del - assigned function executed before deleting topology node by list function
+ * Returns route table used as topology table
+ * Prefix entries are stored in rn->info of the node keyed by destination,
+ * so lookup, insertion and removal are bounded by the prefix length and
+ * route_top()/route_next() walk the table in prefix order.
  */
-struct list *
+struct route_table *
 eigrp_topology_new()
 {
-  struct list* new = list_new();
-  new->cmp = (int
-  (*)(void *, void *)) eigrp_prefix_entry_cmp;
-  new->del = (void
-  (*)(void *)) eigrp_prefix_entry_del;
+  return route_table_init();
+}
 
-  return new;
+/*
+ * Index neighbor entry under the neighbor that advertised it
+ */
+
+static void
+eigrp_neighbor_entry_link(struct eigrp_neighbor_entry *ne)
+{
+  struct eigrp_neighbor *nbr = ne->adv_router;
+
+  ne->nbr_prev = NULL;
+  ne->nbr_next = nbr->entries;
+  if (nbr->entries)
+    nbr->entries->nbr_prev = ne;
+  nbr->entries = ne;
+  nbr->entries_count++;
 }
 
 /*
- * Topology node comparison
+ * Remove neighbor entry from its advertising neighbor's index
  */
 
-static int
-eigrp_prefix_entry_cmp(struct eigrp_prefix_entry *node1,
-    struct eigrp_prefix_entry *node2)
+static void
+eigrp_neighbor_entry_unlink(struct eigrp_neighbor_entry *ne)
 {
-  if (node1->af == AF_INET)
+  struct eigrp_neighbor *nbr = ne->adv_router;
+
+  if (ne->nbr_prev)
+    ne->nbr_prev->nbr_next = ne->nbr_next;
+  else if (nbr && nbr->entries == ne)
+    nbr->entries = ne->nbr_next;
+  else
+    return; /* not linked */
+
+  if (ne->nbr_next)
+    ne->nbr_next->nbr_prev = ne->nbr_prev;
+  ne->nbr_next = ne->nbr_prev = NULL;
+  nbr->entries_count--;
+}
+
+/*
+ * Remove prefix entry from the change log
+ */
+
+static void
+eigrp_topology_change_unlink(struct eigrp *eigrp, struct eigrp_prefix_entry *pe)
+{
+  if (pe->change_prev)
+    pe->change_prev->change_next = pe->change_next;
+  else if (eigrp->topology_changes_head == pe)
+    eigrp->topology_changes_head = pe->change_next;
+  else
+    return; /* not in the log */
+
+  if (pe->change_next)
+    pe->change_next->change_prev = pe->change_prev;
+  else
+    eigrp->topology_changes_tail = pe->change_prev;
+
+  pe->change_next = pe->change_prev = NULL;
+}
+
+/*
+ * Drop prefix entry from the index of active prefixes
+ */
+
+static void
+eigrp_topology_active_unlink(struct eigrp *eigrp, struct eigrp_prefix_entry *pe)
+{
+  struct route_node *rn;
+
+  rn = route_node_lookup(eigrp->topology_active,
+      (struct prefix *) pe->destination_ipv4);
+  if (!rn)
+    return;
+
+  if (rn->info == pe)
     {
-      if (node2->af == AF_INET)
-        {
-          if (node1->destination_ipv4->prefix.s_addr
-              < node2->destination_ipv4->prefix.s_addr)
-            {
-              return -1; // if it belong above node2
-            }
-          else
-            {
-              if (node1->destination_ipv4->prefix.s_addr
-                  > node2->destination_ipv4->prefix.s_addr)
-                {
-                  return 1; //if it belongs under node2
-                }
-              else
-                {
-                  return 0; // same value... ERROR...in case of adding same prefix again
-                }
-            }
-        }
-      else
-        {
-          return 1;
-        }
+      rn->info = NULL;
+      route_unlock_node(rn); /* lock taken by eigrp_topology_active_update() */
     }
-  else
-    { // TODO check if the prefix dont exists
-      return 1; // add to end
+  route_unlock_node(rn); /* lock taken by route_node_lookup() */
+}
+
+/*
+ * Keep the index of active prefixes in step with the state of prefix
+ * entry, called by DUAL whenever the entry goes active or passive.  It is
+ * keyed like the topology table, so the active prefixes can be listed
+ * without walking the whole topology.
+ */
+
+void
+eigrp_topology_active_update(struct eigrp *eigrp, struct eigrp_prefix_entry *pe)
+{
+  struct route_node *rn;
+
+  if (pe->state == EIGRP_FSM_STATE_PASSIVE)
+    {
+      eigrp_topology_active_unlink(eigrp, pe);
+      return;
     }
+
+  rn = route_node_get(eigrp->topology_active,
+      (struct prefix *) pe->destination_ipv4);
+  if (rn->info)
+    route_unlock_node(rn);
+  else
+    rn->info = pe;
+}
+
+/*
+ * Record a change of prefix entry requiring given actions (Update, Query).
+ * The entry gets the next serial number and moves to the end of the change
+ * log, which therefore stays ordered by serno.
+ */
+
+void
+eigrp_topology_change(struct eigrp *eigrp, struct eigrp_prefix_entry *pe,
+    u_char action)
+{
+  pe->req_action |= action;
+  pe->serno = ++eigrp->serno;
+
+  eigrp_topology_change_unlink(eigrp, pe);
+
+  pe->change_prev = eigrp->topology_changes_tail;
+  if (eigrp->topology_changes_tail)
+    eigrp->topology_changes_tail->change_next = pe;
+  else
+    eigrp->topology_changes_head = pe;
+  eigrp->topology_changes_tail = pe;
+
+  eigrp_summary_touch(eigrp, pe);
+}
+
+/*
+ * Return the oldest prefix entry changed after serno, following change_next
+ * from it visits every later change in serno order.  Cost is the number of
+ * changes since serno.
+ */
+
+struct eigrp_prefix_entry *
+eigrp_topology_changes_since(struct eigrp *eigrp, u_int64_t serno)
+{
+  struct eigrp_prefix_entry *pe, *first = NULL;
+
+  for (pe = eigrp->topology_changes_tail; pe && pe->serno > serno;
+      pe = pe->change_prev)
+    first = pe;
+
+  return first;
 }
 
 /*
- * Topology node delete
+ * Free the prefix entry and everything hanging off it
  */
 
 static void
-eigrp_prefix_entry_del(struct eigrp_prefix_entry *node)
+eigrp_prefix_entry_free(struct eigrp_prefix_entry *pe)
 {
-  list_delete_all_node(node->entries);
-  list_free(node->entries);
+  struct listnode *node, *nnode;
+  struct eigrp_neighbor_entry *ne;
+  struct eigrp *eigrp = eigrp_lookup();
+
+  if (eigrp)
+    {
+      eigrp_topology_change_unlink(eigrp, pe);
+      if (pe->state != EIGRP_FSM_STATE_PASSIVE)
+        eigrp_topology_active_unlink(eigrp, pe);
+    }
+
+  for (ALL_LIST_ELEMENTS(pe->entries, node, nnode, ne))
+    {
+      /* withdraw the route if it is still installed */
+      if (eigrp && (ne->flags & EIGRP_NEIGHBOR_ENTRY_INTABLE_FLAG))
+        eigrp_zebra_route_update(eigrp, pe);
+      eigrp_neighbor_entry_unlink(ne);
+      XFREE(MTYPE_EIGRP_NEIGHBOR_ENTRY, ne);
+    }
+  list_delete(pe->entries);
+  list_delete(pe->rij);
+  if (pe->extTLV)
+    XFREE(MTYPE_EIGRP_IPV4_EXT_TLV, pe->extTLV);
+  if (pe->destination_ipv4)
+    prefix_ipv4_free(pe->destination_ipv4);
+  XFREE(MTYPE_EIGRP_PREFIX_ENTRY, pe);
 }
 
 /*
@@ -180,13 +308,13 @@ eigrp_neighbor_entry_new()
 }
 
 /*
- * Freeing topology table list
+ * Freeing topology table
  */
 
 void
-eigrp_topology_free(struct list *list)
+eigrp_topology_free(struct route_table *table)
 {
-  list_free(list);
+  route_table_finish(table);
 }
 
 /*
@@ -194,11 +322,11 @@ eigrp_topology_free(struct list *list)
  */
 
 void
-eigrp_topology_cleanup(struct list *topology)
+eigrp_topology_cleanup(struct route_table *table)
 {
-  assert(topology);
+  assert(table);
 
-  eigrp_topology_delete_all(topology);
+  eigrp_topology_delete_all(table);
 }
 
 /*
@@ -206,12 +334,20 @@ eigrp_topology_cleanup(struct list *topology)
  */
 
 void
-eigrp_prefix_entry_add(struct list *topology, struct eigrp_prefix_entry *node)
+eigrp_prefix_entry_add(struct route_table *topology,
+    struct eigrp_prefix_entry *pe)
 {
-  if (listnode_lookup(topology, node) == NULL)
+  struct route_node *rn;
+
+  rn = route_node_get(topology, (struct prefix *) pe->destination_ipv4);
+  if (rn->info)
     {
-      listnode_add_sort(topology, node);
+      /* Already present, drop the lock taken by route_node_get() */
+      route_unlock_node(rn);
+      return;
     }
+
+  rn->info = pe;
 }
 
 /*
@@ -226,6 +362,9 @@ eigrp_neighbor_entry_add(struct eigrp_prefix_entry *node,
     {
       listnode_add_sort(node->entries, entry);
       entry->prefix = node;
+      if (entry->adv_router)
+        eigrp_neighbor_entry_link(entry);
+      eigrp_prefix_entry_select(node);
     }
 }
 
@@ -234,17 +373,27 @@ eigrp_neighbor_entry_add(struct eigrp_prefix_entry *node,
  */
 
 void
-eigrp_prefix_entry_delete(struct list *topology,
-    struct eigrp_prefix_entry *node)
+eigrp_prefix_entry_delete(struct route_table *topology,
+    struct eigrp_prefix_entry *pe)
 {
-  if (listnode_lookup(topology, node) != NULL)
+  struct eigrp *eigrp;
+  struct route_node *rn;
+
+  rn = route_node_lookup(topology, (struct prefix *) pe->destination_ipv4);
+  if (!rn)
+    return;
+
+  if (rn->info == pe)
     {
-      list_delete_all_node(node->entries);
-      list_free(node->entries);
-      list_free(node->rij);
-      listnode_delete(topology, node);
-      XFREE(MTYPE_EIGRP_PREFIX_ENTRY,node);
+      rn->info = NULL;
+      route_unlock_node(rn); /* lock taken by eigrp_prefix_entry_add() */
+      eigrp_prefix_entry_free(pe);
+
+      /* redistributed routes to the prefix may be advertised now */
+      if ((eigrp = eigrp_lookup()) != NULL)
+        eigrp_external_prefix_freed(eigrp, (struct prefix_ipv4 *) &rn->p);
     }
+  route_unlock_node(rn); /* lock taken by route_node_lookup() */
 }
 
 /*
@@ -257,8 +406,16 @@ eigrp_neighbor_entry_delete(struct eigrp_prefix_entry *node,
 {
   if (listnode_lookup(node->entries, entry) != NULL)
     {
+      /* installed route goes away with the entry */
+      if (entry->flags & EIGRP_NEIGHBOR_ENTRY_INTABLE_FLAG)
+        {
+          entry->flags &= ~EIGRP_NEIGHBOR_ENTRY_INTABLE_FLAG;
+          eigrp_zebra_route_update(eigrp_lookup(), node);
+        }
       listnode_delete(node->entries, entry);
+      eigrp_neighbor_entry_unlink(entry);
       XFREE(MTYPE_EIGRP_NEIGHBOR_ENTRY,entry);
+      eigrp_prefix_entry_select(node);
     }
 }
 
@@ -267,9 +424,20 @@ eigrp_neighbor_entry_delete(struct eigrp_prefix_entry *node,
  */
 
 void
-eigrp_topology_delete_all(struct list *topology)
+eigrp_topology_delete_all(struct route_table *topology)
 {
-  list_delete_all_node(topology);
+  struct route_node *rn;
+  struct eigrp_prefix_entry *pe;
+
+  for (rn = route_top(topology); rn; rn = route_next(rn))
+    {
+      if ((pe = rn->info) == NULL)
+        continue;
+
+      rn->info = NULL;
+      route_unlock_node(rn);
+      eigrp_prefix_entry_free(pe);
+    }
 }
 
 /*
@@ -278,30 +446,29 @@ eigrp_topology_delete_all(struct list *topology)
  */
 
 unsigned int
-eigrp_topology_table_isempty(struct list *topology)
+eigrp_topology_table_isempty(struct route_table *topology)
 {
-  if (topology->count)
+  if (route_table_count(topology))
     return 1;
   else
     return 0;
 }
 
 struct eigrp_prefix_entry *
-eigrp_topology_table_lookup_ipv4(struct list *topology_table,
+eigrp_topology_table_lookup_ipv4(struct route_table *topology_table,
     struct prefix_ipv4 * address)
 {
-  struct eigrp_prefix_entry *data;
-  struct listnode *node;
-  for (ALL_LIST_ELEMENTS_RO(topology_table, node, data))
-    {
+  struct route_node *rn;
+  struct eigrp_prefix_entry *pe;
 
-      if ((data->af == AF_INET)
-          && (data->destination_ipv4->prefix.s_addr == address->prefix.s_addr)
-          && (data->destination_ipv4->prefixlen == address->prefixlen))
-        return data;
-    }
+  rn = route_node_lookup(topology_table, (struct prefix *) address);
+  if (!rn)
+    return NULL;
 
-  return NULL;
+  pe = rn->info;
+  route_unlock_node(rn);
+
+  return pe;
 }
 /* TODO
  struct eigrp_prefix_entry *
@@ -320,46 +487,76 @@ eigrp_topology_table_lookup_ipv4(struct list *topology_table,
  return NULL;
  }
  */
-struct list *
-eigrp_topology_get_successor(struct eigrp_prefix_entry *table_node)
+/*
+ * Refresh the selection cached in prefix entry: the best (first in
+ * distance order) successor and feasible successor and the number of
+ * successors.  To be called whenever entries are added, removed,
+ * reordered or get their flags changed.
+ */
+
+static void
+eigrp_prefix_entry_select(struct eigrp_prefix_entry *pe)
 {
-  struct list *successors = list_new();
-  ;
   struct eigrp_neighbor_entry *data;
-  struct listnode *node1, *node2;
-  for (ALL_LIST_ELEMENTS(table_node->entries, node1, node2, data))
+  struct listnode *node;
+
+  pe->successor = pe->fsuccessor = NULL;
+  pe->successor_count = 0;
+
+  for (ALL_LIST_ELEMENTS_RO(pe->entries, node, data))
     {
       if (data->flags & EIGRP_NEIGHBOR_ENTRY_SUCCESSOR_FLAG)
         {
-          listnode_add(successors, data);
+          if (pe->successor == NULL)
+            pe->successor = data;
+          pe->successor_count++;
         }
+      else if ((data->flags & EIGRP_NEIGHBOR_ENTRY_FSUCCESSOR_FLAG)
+               && pe->fsuccessor == NULL)
+        pe->fsuccessor = data;
     }
+}
 
-  return successors;
+struct eigrp_neighbor_entry *
+eigrp_topology_get_successor(struct eigrp_prefix_entry *table_node)
+{
+  return table_node->successor;
 }
 
-/*extern struct eigrp_neighbor_entry *
- eigrp_topology_get_fsuccessor (struct eigrp_prefix_entry *table_node)
- {
- struct eigrp_neighbor_entry *data;
- struct listnode *node, *nnode;
- for (ALL_LIST_ELEMENTS (table_node->entries, node, nnode, data))
- {
- if ((data->flags & EIGRP_NEIGHBOR_ENTRY_FSUCCESSOR_FLAG) == 1)
- {
- return data;
- }
- }
+struct eigrp_neighbor_entry *
+eigrp_topology_get_fsuccessor (struct eigrp_prefix_entry *table_node)
+{
+  return table_node->fsuccessor;
+}
 
- return NULL;
- }*/
+int
+eigrp_topology_get_successor_count (struct eigrp_prefix_entry *prefix)
+{
+  return prefix->successor_count;
+}
+
+/*
+ * Find the entry for prefix advertised by nbr.  Both the prefix and the
+ * neighbor index hold it, so walk whichever of the two is shorter.
+ */
 
 struct eigrp_neighbor_entry *
-eigrp_prefix_entry_lookup(struct list *entries, struct eigrp_neighbor *nbr)
+eigrp_prefix_entry_lookup(struct eigrp_prefix_entry *pe,
+    struct eigrp_neighbor *nbr)
 {
   struct eigrp_neighbor_entry *data;
-  struct listnode *node, *nnode;
-  for (ALL_LIST_ELEMENTS(entries, node, nnode, data))
+  struct listnode *node;
+
+  if (nbr->entries_count < listcount(pe->entries))
+    {
+      for (data = nbr->entries; data; data = data->nbr_next)
+        if (data->prefix == pe)
+          return data;
+
+      return NULL;
+    }
+
+  for (ALL_LIST_ELEMENTS_RO(pe->entries, node, data))
     {
       if (data->adv_router == nbr)
         {
@@ -370,43 +567,73 @@ eigrp_prefix_entry_lookup(struct list *entries, struct eigrp_neighbor *nbr)
   return NULL;
 }
 
+/*
+ * Unlink every entry advertised by nbr from its index, used when the
+ * neighbor structure itself goes away.  Entries DUAL still holds on to
+ * are left without an advertising router.
+ */
+
+void
+eigrp_topology_neighbor_unlink_all(struct eigrp_neighbor *nbr)
+{
+  struct eigrp_neighbor_entry *ne;
+
+  while ((ne = nbr->entries) != NULL)
+    {
+      eigrp_neighbor_entry_unlink(ne);
+      ne->adv_router = NULL;
+    }
+}
+
 int
 eigrp_topology_update_distance(struct eigrp_fsm_action_message *msg)
 {
   struct eigrp *eigrp = msg->eigrp;
   struct eigrp_prefix_entry *prefix = msg->prefix;
   struct eigrp_neighbor_entry *entry = msg->entry;
+  struct listnode *node;
+  u_int32_t reported_distance;
   int change = 0;
   assert(entry);
 
-  struct TLV_IPv4_External_type *ext_data = NULL;
-  struct TLV_IPv4_Internal_type *int_data = NULL;
   if (msg->data_type == EIGRP_TLV_IPv4_INT)
     {
-      int_data = msg->data.ipv4_int_type;
+      struct eigrp_route_tlv *int_data = msg->route;
       if (eigrp_metrics_is_same(&int_data->metric,&entry->reported_metric))
         {
           return 0; // No change
         }
+      reported_distance = eigrp_calculate_metrics(eigrp, &int_data->metric);
       change =
-          entry->reported_distance
-              < eigrp_calculate_metrics(eigrp, &int_data->metric) ? 1 :
-          entry->reported_distance
-              > eigrp_calculate_metrics(eigrp, &int_data->metric) ? 2 : 3; // Increase : Decrease : No change
+          entry->reported_distance < reported_distance ? 1 :
+          entry->reported_distance > reported_distance ? 2 : 3; // Increase : Decrease : No change
       entry->reported_metric = int_data->metric;
-      entry->reported_distance = eigrp_calculate_metrics(eigrp,
-          &int_data->metric);
+      entry->reported_distance = reported_distance;
       entry->distance = eigrp_calculate_total_metrics(eigrp, entry);
     }
-  else
-    {
-      ext_data = msg->data.ipv4_ext_data;
-    }
   /*
-   * Move to correct position in list according to new distance
+   * Move to correct position in list according to new distance, by
+   * swapping it with its neighbors, so that no list node is reallocated.
+   * Entry ends up after those of equal distance, as listnode_add_sort()
+   * would put it.
    */
-  listnode_delete(prefix->entries, entry);
-  listnode_add_sort(prefix->entries, entry);
+  node = listnode_lookup(prefix->entries, entry);
+  while (node->prev
+         && eigrp_neighbor_entry_cmp(node->prev->data, entry) > 0)
+    {
+      node->data = node->prev->data;
+      node = node->prev;
+      node->data = entry;
+    }
+  while (node->next
+         && eigrp_neighbor_entry_cmp(entry, node->next->data) >= 0)
+    {
+      node->data = node->next->data;
+      node = node->next;
+      node->data = entry;
+    }
+
+  eigrp_prefix_entry_select(prefix);
 
   return change;
 }
@@ -414,12 +641,12 @@ eigrp_topology_update_distance(struct eigrp_fsm_action_message *msg)
 void
 eigrp_topology_update_all_node_flags(struct eigrp *eigrp)
 {
-  struct list *table = eigrp->topology_table;
-  struct eigrp_prefix_entry *data;
-  struct listnode *node, *nnode;
-  for (ALL_LIST_ELEMENTS(table, node, nnode, data))
+  struct route_node *rn;
+
+  for (rn = route_top(eigrp->topology_table); rn; rn = route_next(rn))
     {
-      eigrp_topology_update_node_flags(data);
+      if (rn->info)
+        eigrp_topology_update_node_flags(rn->info);
     }
 }
 
@@ -447,70 +674,87 @@ eigrp_topology_update_node_flags(struct eigrp_prefix_entry *dest)
           entry->flags &= 0xfc; // 1111 1100 set successor and fs flag to zero
         }
     }
+
+  eigrp_prefix_entry_select(dest);
 }
 
+/*
+ * Mark successors as installed and the others as not, and queue the
+ * prefix for zebra if that changed anything.  Entries learned from
+ * ourselves (connected networks) are never installed.
+ */
+
 void
 eigrp_update_routing_table(struct eigrp_prefix_entry * prefix)
 {
   struct listnode *node;
   struct eigrp_neighbor_entry *entry;
+  struct eigrp *eigrp = eigrp_lookup();
+  int changed = 0;
 
   for (ALL_LIST_ELEMENTS_RO(prefix->entries, node, entry))
     {
-      if (entry->flags & EIGRP_NEIGHBOR_ENTRY_SUCCESSOR_FLAG)
+      if ((entry->flags & EIGRP_NEIGHBOR_ENTRY_SUCCESSOR_FLAG)
+          && entry->adv_router && entry->adv_router != eigrp->neighbor_self)
         {
           if (!(entry->flags & EIGRP_NEIGHBOR_ENTRY_INTABLE_FLAG))
             {
-              eigrp_zebra_route_add(prefix->destination_ipv4, entry);
-              entry->flags += EIGRP_NEIGHBOR_ENTRY_INTABLE_FLAG;
+              entry->flags |= EIGRP_NEIGHBOR_ENTRY_INTABLE_FLAG;
+              changed = 1;
             }
         }
       else if (entry->flags & EIGRP_NEIGHBOR_ENTRY_INTABLE_FLAG)
         {
-          eigrp_zebra_route_delete(prefix->destination_ipv4, entry);
-          entry->flags -= EIGRP_NEIGHBOR_ENTRY_INTABLE_FLAG;
+          entry->flags &= ~EIGRP_NEIGHBOR_ENTRY_INTABLE_FLAG;
+          changed = 1;
         }
     }
+
+  if (changed)
+    eigrp_zebra_route_update(eigrp, prefix);
 }
 
 void
 eigrp_topology_neighbor_down(struct eigrp *eigrp, struct eigrp_neighbor * nbr)
 {
-  struct listnode *node1, *node11, *node2, *node22;
-  struct eigrp_prefix_entry *prefix;
-  struct eigrp_neighbor_entry *entry;
+  struct eigrp_neighbor_entry *entry, *next;
+  struct eigrp_fsm_action_message msg;
+  struct eigrp_route_tlv route;
+
+  /* every route of the neighbor is withdrawn with the same infinite metric */
+  memset(&route, 0, sizeof(route));
+  route.type = EIGRP_TLV_IPv4_INT;
+  route.metric.delay = EIGRP_MAX_METRIC;
 
-  for (ALL_LIST_ELEMENTS(eigrp->topology_table, node1, node11, prefix))
+  msg.packet_type = EIGRP_OPC_UPDATE;
+  msg.eigrp = eigrp;
+  msg.data_type = EIGRP_TLV_IPv4_INT;
+  msg.adv_router = nbr;
+  msg.route = &route;
+
+  eigrp_dual_flush_prepare(eigrp, nbr->ei);
+
+  /*
+   * DUAL may release the entry (and its whole prefix) while we are
+   * processing it, but never another entry of this neighbor, since each
+   * neighbor advertises a prefix at most once.
+   */
+  for (entry = nbr->entries; entry; entry = next)
     {
-      for (ALL_LIST_ELEMENTS(prefix->entries, node2, node22, entry))
-        {
-          if (entry->adv_router == nbr)
-            {
-              struct eigrp_fsm_action_message *msg;
-              msg = XCALLOC(MTYPE_EIGRP_FSM_MSG,
-                  sizeof(struct eigrp_fsm_action_message));
-              struct TLV_IPv4_Internal_type * tlv = eigrp_IPv4_InternalTLV_new();
-              tlv->metric.delay = EIGRP_MAX_METRIC;
-              msg->packet_type = EIGRP_OPC_UPDATE;
-              msg->eigrp = eigrp;
-              msg->data_type = EIGRP_TLV_IPv4_INT;
-              msg->adv_router = nbr;
-              msg->data.ipv4_int_type = tlv;
-              msg->entry = entry;
-              msg->prefix = prefix;
-              int event = eigrp_get_fsm_event(msg);
-              eigrp_fsm_event(msg, event);
-            }
-        }
+      next = entry->nbr_next;
+
+      msg.entry = entry;
+      msg.prefix = entry->prefix;
+      int event = eigrp_get_fsm_event(&msg);
+      eigrp_fsm_event(&msg, event);
     }
 
-  eigrp_query_send_all(eigrp);
-  eigrp_update_send_all(eigrp,nbr->ei);
+  eigrp_dual_flush_schedule(eigrp, nbr->ei);
 
 }
 
 void
-eigrp_update_topology_table_prefix(struct list * table, struct eigrp_prefix_entry * prefix)
+eigrp_update_topology_table_prefix(struct route_table * table, struct eigrp_prefix_entry * prefix)
 {
 	struct listnode *node1, *node2;
 
@@ -522,28 +766,13 @@ eigrp_update_topology_table_prefix(struct list * table, struct eigrp_prefix_entr
 	    		  eigrp_neighbor_entry_delete(prefix,entry);
 	    	  }
 	        }
-	      if(prefix->distance == EIGRP_MAX_METRIC && prefix->nt != EIGRP_TOPOLOGY_TYPE_CONNECTED)
+	      /*
+	       * Unreachable prefix waiting for its Update or Query is removed
+	       * once that has been sent, see eigrp_update_send_all().
+	       */
+	      if(prefix->distance == EIGRP_MAX_METRIC && prefix->nt != EIGRP_TOPOLOGY_TYPE_CONNECTED
+	    	 && !prefix->req_action)
 	      {
 	    	  eigrp_prefix_entry_delete(table,prefix);
 	      }
 }
-/*int
- eigrp_topology_get_successor_count (struct eigrp_prefix_entry *prefix)
- {
-
- struct listnode *node;
- struct eigrp_neighbor_entry *entry;
-
- int count = 0;
-
- for (ALL_LIST_ELEMENTS_RO (prefix->entries,node,entry))
- {
- if ((entry->flags & EIGRP_NEIGHBOR_ENTRY_SUCCESSOR_FLAG) == EIGRP_NEIGHBOR_ENTRY_SUCCESSOR_FLAG)
- {
- count ++;
- }
- }
-
- return count;
- }
- */
@@ -0,0 +1,321 @@
+/*
+ * EIGRP DUAL Trace Ring.
+ * Copyright (C) 2013-2014
+ * Authors:
+ *   Donnie Savage
+ *   Jan Janovic
+ *   Matej Perina
+ *   Peter Orsag
+ *   Peter Paluch
+ *
+ * This file is part of GNU Zebra.
+ *
+ * GNU Zebra is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * GNU Zebra is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Zebra; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include <zebra.h>
+
+#include "memory.h"
+#include "thread.h"
+#include "prefix.h"
+#include "table.h"
+#include "linklist.h"
+#include "command.h"
+#include "vty.h"
+
+#include "eigrpd/eigrp_structs.h"
+#include "eigrpd/eigrpd.h"
+#include "eigrpd/eigrp_fsm.h"
+#include "eigrpd/eigrp_trace.h"
+
+/*
+ * Every DUAL event is recorded here as a fixed-size binary entry.
+ * Recording is a handful of stores into a static array, so it is cheap
+ * enough to leave on permanently; entries are only turned into text
+ * when someone looks at them, either from the vty or from the crash
+ * handler below.  eigrpd is single threaded, so the ring needs no
+ * locking: the only concurrent reader is a signal handler, which at
+ * worst sees the newest entry half written.
+ */
+static struct eigrp_trace_entry eigrp_trace_ring[EIGRP_TRACE_SIZE];
+static unsigned long eigrp_trace_head;
+
+static const char *eigrp_trace_opcode_str[] =
+{
+  "-", "UPDATE", "REQUEST", "QUERY", "REPLY", "HELLO", "IPXSAP", "PROBE",
+  "ACK", "-", "SIAQUERY", "SIAREPLY",
+};
+
+/* Signals the ring is dumped on, and what was installed before us. */
+static const int eigrp_trace_signals[] =
+{
+  SIGSEGV, SIGBUS, SIGILL, SIGFPE, SIGABRT,
+};
+static struct sigaction eigrp_trace_oldact[array_size (eigrp_trace_signals)];
+static volatile sig_atomic_t eigrp_trace_dumped;
+
+void
+eigrp_trace_fsm (struct eigrp_fsm_action_message *msg, int event,
+                 u_char state)
+{
+  struct eigrp_trace_entry *te;
+  struct eigrp_prefix_entry *prefix = msg->prefix;
+
+  te = &eigrp_trace_ring[eigrp_trace_head++ & (EIGRP_TRACE_SIZE - 1)];
+
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &te->time);
+  te->prefix = prefix->destination_ipv4->prefix;
+  te->prefixlen = prefix->destination_ipv4->prefixlen;
+  te->neighbor.s_addr = msg->adv_router ? msg->adv_router->src.s_addr : 0;
+  te->distance = prefix->distance;
+  te->as = msg->eigrp->AS;
+  te->packet_type = msg->packet_type;
+  te->event = event;
+  te->state = state;
+  te->new_state = prefix->state;
+}
+
+/*
+ * Formatting helpers.  They are also used from the crash handler, so
+ * they stay away from stdio and anything else that may allocate.
+ */
+static size_t
+eigrp_trace_str (char *buf, size_t size, size_t pos, const char *str)
+{
+  while (*str && pos + 1 < size)
+    buf[pos++] = *str++;
+  buf[pos] = '\0';
+  return pos;
+}
+
+static size_t
+eigrp_trace_num (char *buf, size_t size, size_t pos, unsigned long num,
+                 int width, char pad)
+{
+  char tmp[24];
+  int len = 0;
+
+  do
+    {
+      tmp[len++] = '0' + num % 10;
+      num /= 10;
+    }
+  while (num);
+
+  while (width-- > len && pos + 1 < size)
+    buf[pos++] = pad;
+  while (len && pos + 1 < size)
+    buf[pos++] = tmp[--len];
+  buf[pos] = '\0';
+  return pos;
+}
+
+static size_t
+eigrp_trace_addr (char *buf, size_t size, size_t pos, struct in_addr addr)
+{
+  const u_char *p = (const u_char *) &addr.s_addr;
+  int i;
+
+  for (i = 0; i < 4; i++)
+    {
+      if (i)
+        pos = eigrp_trace_str (buf, size, pos, ".");
+      pos = eigrp_trace_num (buf, size, pos, p[i], 0, ' ');
+    }
+  return pos;
+}
+
+static const char *
+eigrp_trace_name (const char **names, size_t count, u_char value)
+{
+  return value < count ? names[value] : "?";
+}
+
+/* Format one entry as a single line, without a trailing newline. */
+static size_t
+eigrp_trace_format (char *buf, size_t size,
+                    const struct eigrp_trace_entry *te)
+{
+  size_t pos = 0;
+
+  pos = eigrp_trace_num (buf, size, pos, te->time.tv_sec, 8, ' ');
+  pos = eigrp_trace_str (buf, size, pos, ".");
+  pos = eigrp_trace_num (buf, size, pos, te->time.tv_usec, 6, '0');
+  pos = eigrp_trace_str (buf, size, pos, " AS ");
+  pos = eigrp_trace_num (buf, size, pos, te->as, 0, ' ');
+  pos = eigrp_trace_str (buf, size, pos, " ");
+  pos = eigrp_trace_addr (buf, size, pos, te->prefix);
+  pos = eigrp_trace_str (buf, size, pos, "/");
+  pos = eigrp_trace_num (buf, size, pos, te->prefixlen, 0, ' ');
+  pos = eigrp_trace_str (buf, size, pos, " ");
+  pos = eigrp_trace_str (buf, size, pos,
+                         eigrp_trace_name (eigrp_trace_opcode_str,
+                                           array_size (eigrp_trace_opcode_str),
+                                           te->packet_type));
+  pos = eigrp_trace_str (buf, size, pos, " from ");
+  pos = eigrp_trace_addr (buf, size, pos, te->neighbor);
+  pos = eigrp_trace_str (buf, size, pos, ": ");
+  pos = eigrp_trace_str (buf, size, pos,
+                         eigrp_trace_name (eigrp_fsm_state_str,
+                                           EIGRP_FSM_STATE_MAX,
+                                           te->state));
+  pos = eigrp_trace_str (buf, size, pos, " -(");
+  pos = eigrp_trace_str (buf, size, pos,
+                         eigrp_trace_name (eigrp_fsm_event_str,
+                                           EIGRP_FSM_KEEP_STATE + 1,
+                                           te->event));
+  pos = eigrp_trace_str (buf, size, pos, ")-> ");
+  pos = eigrp_trace_str (buf, size, pos,
+                         eigrp_trace_name (eigrp_fsm_state_str,
+                                           EIGRP_FSM_STATE_MAX,
+                                           te->new_state));
+  pos = eigrp_trace_str (buf, size, pos, ", distance ");
+  pos = eigrp_trace_num (buf, size, pos, te->distance, 0, ' ');
+
+  return pos;
+}
+
+/* Index of the oldest of the last count entries, count is clipped. */
+static unsigned long
+eigrp_trace_first (unsigned long *count)
+{
+  unsigned long stored;
+
+  stored = eigrp_trace_head < EIGRP_TRACE_SIZE
+    ? eigrp_trace_head : EIGRP_TRACE_SIZE;
+  if (*count == 0 || *count > stored)
+    *count = stored;
+
+  return eigrp_trace_head - *count;
+}
+
+static void
+eigrp_trace_crash (int signo, siginfo_t *info, void *context)
+{
+  struct sigaction *old = NULL;
+  unsigned long i, first, count = 0;
+  char buf[160];
+  size_t len;
+  int fd;
+
+  /* The lib core handler aborts, so we can get here a second time. */
+  if (!eigrp_trace_dumped)
+    {
+      eigrp_trace_dumped = 1;
+
+      /* Like the lib crashlog, never write through an existing file or
+       * a link planted in /var/tmp. */
+      fd = open (EIGRP_TRACE_CRASHFILE, O_WRONLY|O_CREAT|O_EXCL, LOGFILE_MASK);
+      if (fd >= 0)
+        {
+          first = eigrp_trace_first (&count);
+          for (i = first; i < first + count; i++)
+            {
+              len = eigrp_trace_format (buf, sizeof (buf) - 1,
+                         &eigrp_trace_ring[i & (EIGRP_TRACE_SIZE - 1)]);
+              buf[len++] = '\n';
+              if (write (fd, buf, len) < 0)
+                break;
+            }
+          close (fd);
+        }
+    }
+
+  /* Hand the signal on to whoever had it before. */
+  for (i = 0; i < array_size (eigrp_trace_signals); i++)
+    if (eigrp_trace_signals[i] == signo)
+      old = &eigrp_trace_oldact[i];
+  if (old == NULL)
+    return;
+
+  sigaction (signo, old, NULL);
+  if (old->sa_flags & SA_SIGINFO)
+    old->sa_sigaction (signo, info, context);
+  else if (old->sa_handler == SIG_DFL)
+    raise (signo);
+  else if (old->sa_handler != SIG_IGN)
+    old->sa_handler (signo);
+}
+
+DEFUN (show_ip_eigrp_trace,
+       show_ip_eigrp_trace_cmd,
+       "show ip eigrp trace",
+       SHOW_STR
+       IP_STR
+       "IP-EIGRP show commands\n"
+       "DUAL state machine trace\n")
+{
+  unsigned long i, first, count = 0;
+  char buf[160];
+
+  if (argc > 0)
+    VTY_GET_INTEGER_RANGE ("entries", count, argv[0], 1, EIGRP_TRACE_SIZE);
+
+  first = eigrp_trace_first (&count);
+  vty_out (vty, "DUAL trace, %lu of %lu events:%s",
+           count, eigrp_trace_head, VTY_NEWLINE);
+  for (i = first; i < first + count; i++)
+    {
+      eigrp_trace_format (buf, sizeof (buf),
+                          &eigrp_trace_ring[i & (EIGRP_TRACE_SIZE - 1)]);
+      vty_out (vty, "%s%s", buf, VTY_NEWLINE);
+    }
+
+  return CMD_SUCCESS;
+}
+
+ALIAS (show_ip_eigrp_trace,
+       show_ip_eigrp_trace_count_cmd,
+       "show ip eigrp trace <1-4096>",
+       SHOW_STR
+       IP_STR
+       "IP-EIGRP show commands\n"
+       "DUAL state machine trace\n"
+       "Number of most recent events to show\n")
+
+DEFUN (clear_ip_eigrp_trace,
+       clear_ip_eigrp_trace_cmd,
+       "clear ip eigrp trace",
+       CLEAR_STR
+       IP_STR
+       "Clear IP-EIGRP\n"
+       "DUAL state machine trace\n")
+{
+  eigrp_trace_head = 0;
+
+  return CMD_SUCCESS;
+}
+
+void
+eigrp_trace_init (void)
+{
+  struct sigaction act;
+  size_t i;
+
+  install_element (VIEW_NODE, &show_ip_eigrp_trace_cmd);
+  install_element (ENABLE_NODE, &show_ip_eigrp_trace_cmd);
+  install_element (VIEW_NODE, &show_ip_eigrp_trace_count_cmd);
+  install_element (ENABLE_NODE, &show_ip_eigrp_trace_count_cmd);
+  install_element (ENABLE_NODE, &clear_ip_eigrp_trace_cmd);
+
+  /* Runs after signal_init (), so lib's core handler gets chained. */
+  memset (&act, 0, sizeof (act));
+  act.sa_sigaction = eigrp_trace_crash;
+  act.sa_flags = SA_SIGINFO;
+  sigfillset (&act.sa_mask);
+  for (i = 0; i < array_size (eigrp_trace_signals); i++)
+    sigaction (eigrp_trace_signals[i], &act, &eigrp_trace_oldact[i]);
+}
@@ -0,0 +1,56 @@
+/*
+ * EIGRP DUAL Trace Ring.
+ * Copyright (C) 2013-2014
+ * Authors:
+ *   Donnie Savage
+ *   Jan Janovic
+ *   Matej Perina
+ *   Peter Orsag
+ *   Peter Paluch
+ *
+ * This file is part of GNU Zebra.
+ *
+ * GNU Zebra is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * GNU Zebra is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Zebra; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef _ZEBRA_EIGRP_TRACE_H_
+#define _ZEBRA_EIGRP_TRACE_H_
+
+/* Number of DUAL transitions kept, must be a power of two. */
+#define EIGRP_TRACE_SIZE		4096
+
+/* Where the ring is written when the daemon crashes, if not there yet. */
+#define EIGRP_TRACE_CRASHFILE		"/var/tmp/quagga.eigrpd.trace"
+
+/* One recorded FSM event, stored raw and formatted only when read. */
+struct eigrp_trace_entry
+{
+  struct timeval time;
+  struct in_addr prefix;
+  struct in_addr neighbor;
+  u_int32_t distance;
+  u_int16_t as;
+  u_char prefixlen;
+  u_char packet_type;
+  u_char event;
+  u_char state;
+  u_char new_state;
+};
+
+extern void eigrp_trace_fsm (struct eigrp_fsm_action_message *, int, u_char);
+extern void eigrp_trace_init (void);
+
+#endif /* _ZEBRA_EIGRP_TRACE_H_ */
@@ -52,6 +52,7 @@
 #include "eigrpd/eigrp_macros.h"
 #include "eigrpd/eigrp_topology.h"
 #include "eigrpd/eigrp_fsm.h"
+#include "eigrpd/eigrp_summary.h"
 
 
 /*
@@ -62,11 +63,12 @@ eigrp_update_receive (struct eigrp *eigrp, struct ip *iph, struct eigrp_header *
                       struct stream * s, struct eigrp_interface *ei, int size)
 {
   struct eigrp_neighbor *nbr;
-  struct TLV_IPv4_Internal_type *tlv;
+  struct eigrp_route_tlv route;
+  struct eigrp_fsm_action_message msg;
+  struct prefix_ipv4 dest_addr;
   struct eigrp_prefix_entry *pe;
   struct eigrp_neighbor_entry *ne;
   u_int32_t flags;
-  u_int16_t type;
   uint16_t  length;
   u_char same;
   struct access_list *alist;
@@ -82,11 +84,6 @@ eigrp_update_receive (struct eigrp *eigrp, struct ip *iph, struct eigrp_header *
 
   flags = ntohl(eigrph->flags);
 
-  if (flags & EIGRP_CR_FLAG)
-    {
-      return;
-    }
-
   same = 0;
   if((nbr->recv_sequence_number) == (ntohl(eigrph->sequence)))
       same = 1;
@@ -120,48 +117,39 @@ eigrp_update_receive (struct eigrp *eigrp, struct ip *iph, struct eigrp_header *
     }
 
   /*If there is topology information*/
-  while (s->endp > s->getp)
+  while (eigrp_tlv_route_next(s, &route))
     {
-      type = stream_getw(s);
-      if (type == EIGRP_TLV_IPv4_INT)
+      /* external routes are not taken into DUAL yet */
+      if (route.type == EIGRP_TLV_IPv4_INT)
         {
-          stream_set_getp(s, s->getp - sizeof(u_int16_t));
-
-          tlv = eigrp_read_ipv4_tlv(s);
-
           /*searching if destination exists */
-          struct prefix_ipv4 *dest_addr;
-          dest_addr = prefix_ipv4_new();
-          dest_addr->prefix = tlv->destination;
-          dest_addr->prefixlen = tlv->prefix_length;
+          dest_addr = route.prefix;
           struct eigrp_prefix_entry *dest = eigrp_topology_table_lookup_ipv4(
-              eigrp->topology_table, dest_addr);
+              eigrp->topology_table, &dest_addr);
 
           /*if exists it comes to DUAL*/
           if (dest != NULL)
             {
-              struct eigrp_fsm_action_message *msg;
-              msg = XCALLOC(MTYPE_EIGRP_FSM_MSG,
-                  sizeof(struct eigrp_fsm_action_message));
               struct eigrp_neighbor_entry *entry =
-                  eigrp_prefix_entry_lookup(dest->entries, nbr);
-
-              msg->packet_type = EIGRP_OPC_UPDATE;
-              msg->eigrp = eigrp;
-              msg->data_type = EIGRP_TLV_IPv4_INT;
-              msg->adv_router = nbr;
-              msg->data.ipv4_int_type = tlv;
-              msg->entry = entry;
-              msg->prefix = dest;
-              int event = eigrp_get_fsm_event(msg);
-              eigrp_fsm_event(msg, event);
+                  eigrp_prefix_entry_lookup(dest, nbr);
+
+              msg.packet_type = EIGRP_OPC_UPDATE;
+              msg.eigrp = eigrp;
+              msg.data_type = EIGRP_TLV_IPv4_INT;
+              msg.adv_router = nbr;
+              msg.route = &route;
+              msg.entry = entry;
+              msg.prefix = dest;
+              int event = eigrp_get_fsm_event(&msg);
+              eigrp_fsm_event(&msg, event);
             }
           else
             {
               /*Here comes topology information save*/
               pe = eigrp_prefix_entry_new();
               pe->serno = eigrp->serno;
-              pe->destination_ipv4 = dest_addr;
+              pe->destination_ipv4 = prefix_ipv4_new();
+              *pe->destination_ipv4 = dest_addr;
               pe->af = AF_INET;
               pe->state = EIGRP_FSM_STATE_PASSIVE;
               pe->nt = EIGRP_TOPOLOGY_TYPE_REMOTE;
@@ -169,9 +157,9 @@ eigrp_update_receive (struct eigrp *eigrp, struct ip *iph, struct eigrp_header *
               ne = eigrp_neighbor_entry_new();
               ne->ei = ei;
               ne->adv_router = nbr;
-              ne->reported_metric = tlv->metric;
+              ne->reported_metric = route.metric;
               ne->reported_distance = eigrp_calculate_metrics(eigrp,
-                  &tlv->metric);
+                  &route.metric);
 
 
               /*
@@ -180,23 +168,18 @@ eigrp_update_receive (struct eigrp *eigrp, struct ip *iph, struct eigrp_header *
 			   */
 			  alist = ei->list[EIGRP_FILTER_IN];
 
-			  if (alist) {
-				  zlog_info ("ALIST:");
-				  zlog_info (alist->name);
-			  } else {
-				  zlog_info("ALIST je prazdny");
-			  }
-
 			  if (alist && access_list_apply (alist,
-						 (struct prefix *) dest_addr) == FILTER_DENY)
+						 (struct prefix *) &dest_addr) == FILTER_DENY)
 			  {
-				  zlog_info("Nastavujem metriku na MAX");
+				  if (IS_DEBUG_EIGRP_PACKET(0, RECV))
+					  zlog_debug("%s/%u denied by access-list %s on %s",
+							  inet_ntoa(dest_addr.prefix),
+							  dest_addr.prefixlen, alist->name,
+							  ei->ifp->name);
 				  ne->distance = 1600000;
 			  } else {
-				  zlog_info("NENastavujem metriku ");
 				  ne->distance = eigrp_calculate_total_metrics(eigrp, ne);
 			  }
-			  zlog_info("Distance: %d", ne->distance);
 
               pe->fdistance = pe->distance = pe->rdistance =
                   ne->distance;
@@ -210,10 +193,8 @@ eigrp_update_receive (struct eigrp *eigrp, struct ip *iph, struct eigrp_header *
               pe->reported_metric = ne->total_metric;
               eigrp_topology_update_node_flags(pe);
 
-              pe->req_action |= EIGRP_FSM_NEED_UPDATE;
-              listnode_add(eigrp->topology_changes_internalIPV4, pe);
+              eigrp_topology_change(eigrp, pe, EIGRP_FSM_NEED_UPDATE);
             }
-          eigrp_IPv4_InternalTLV_free (tlv);
         }
     }
 
@@ -225,8 +206,7 @@ eigrp_update_receive (struct eigrp *eigrp, struct ip *iph, struct eigrp_header *
       eigrp_hello_send_ack(nbr);
     }
 
-  eigrp_query_send_all(eigrp);
-  eigrp_update_send_all(eigrp, ei);
+  eigrp_dual_flush_schedule(eigrp, ei);
 }
 
 /*send EIGRP Update packet*/
@@ -264,6 +244,7 @@ eigrp_update_send_init (struct eigrp_neighbor *nbr)
   /*This ack number we await from neighbor*/
   nbr->init_sequence_number = nbr->ei->eigrp->sequence_number;
   ep->sequence_number = nbr->ei->eigrp->sequence_number;
+  nbr->ei->eigrp->sequence_number++;
   if (IS_DEBUG_EIGRP_PACKET(0, RECV))
     zlog_debug("Enqueuing Update Init Len [%u] Seq [%u] Dest [%s]",
                ep->length, ep->sequence_number, inet_ntoa(ep->dst));
@@ -277,141 +258,332 @@ eigrp_update_send_init (struct eigrp_neighbor *nbr)
     }
 }
 
+static void
+eigrp_update_send_EOT_packet (struct eigrp_neighbor *nbr,
+                              struct eigrp_packet *ep, u_int32_t flags)
+{
+  eigrp_packet_reliable_finish(nbr->ei, ep, flags);
+  ep->dst.s_addr = nbr->src.s_addr;
+
+  if (IS_DEBUG_EIGRP_PACKET(0, RECV))
+    zlog_debug("Enqueuing Update Len [%u] Seq [%u] Flags [%0x] Dest [%s]",
+               ep->length, ep->sequence_number, flags, inet_ntoa(ep->dst));
+
+  /*Put packet to retransmission queue*/
+  eigrp_fifo_push_head(nbr->retrans_queue, ep);
+
+  if (nbr->retrans_queue->count == 1)
+    {
+      eigrp_send_packet_reliably(nbr);
+    }
+}
+
+static void
+eigrp_update_send_packet (struct eigrp_interface *ei, struct eigrp_packet *ep,
+                          u_int64_t serno)
+{
+  eigrp_packet_reliable_finish(ei, ep, 0);
+  ep->dst.s_addr = htonl(EIGRP_MULTICAST_ADDRESS);
+
+  if (IS_DEBUG_EIGRP_PACKET(0, RECV))
+    zlog_debug("Enqueuing Update length[%u] Seq [%u]",
+               ep->length, ep->sequence_number);
+
+  eigrp_send_packet_reliably_all(ei, ep, serno);
+}
+
+/*
+ * A stub router only advertises the kinds of its own routes it was told
+ * to, and never passes on what it learned from other neighbors.
+ */
+static int
+eigrp_update_stub_permits (struct eigrp *eigrp, struct eigrp_prefix_entry *pe)
+{
+  if (eigrp->stub == 0)
+    return 1;
+
+  if (eigrp->stub & EIGRP_STUB_RECEIVE_ONLY)
+    return 0;
+
+  switch (pe->nt)
+    {
+    case EIGRP_TOPOLOGY_TYPE_CONNECTED:
+      return (eigrp->stub & EIGRP_STUB_CONNECTED) != 0;
+    case EIGRP_TOPOLOGY_TYPE_EXTERNAL:
+      if (pe->extTLV && pe->extTLV->external_protocol == STATIC_PROTID
+          && (eigrp->stub & EIGRP_STUB_STATIC))
+        return 1;
+      return (eigrp->stub & EIGRP_STUB_REDISTRIBUTED) != 0;
+    default:
+      return 0;
+    }
+}
+
+/*
+ * Summaries are subject to the stub configuration like any other route
+ * originated here.
+ */
+static int
+eigrp_update_stub_permits_summary (struct eigrp *eigrp)
+{
+  if (eigrp->stub == 0)
+    return 1;
+
+  return (eigrp->stub & EIGRP_STUB_SUMMARY)
+      && !(eigrp->stub & EIGRP_STUB_RECEIVE_ONLY);
+}
+
+/*
+ * Send the whole topology table to a new neighbor.  The table is split in
+ * as many MTU sized Update packets as needed, only the last one carries
+ * the EOT flag.  Routes covered by a summary on the interface are replaced
+ * by the summary.
+ */
 void
 eigrp_update_send_EOT (struct eigrp_neighbor *nbr)
 {
-  struct eigrp_packet *ep;
-//  struct eigrp_packet *ep_multicast;
-  u_int16_t length = EIGRP_HEADER_LEN;
+  struct eigrp_interface *ei = nbr->ei;
+  struct eigrp_packet *ep = NULL;
   struct eigrp_neighbor_entry *te;
   struct eigrp_prefix_entry *pe;
-  struct listnode *node, *node2, *nnode, *nnode2;
+  struct eigrp_summary *sum;
+  struct route_node *rn;
+  struct listnode *node2, *nnode2;
+  u_int16_t max_len = eigrp_packet_max_len(ei);
 
-  ep = eigrp_packet_new(nbr->ei->ifp->mtu);
+  for (rn = route_top(ei->eigrp->topology_table); rn; rn = route_next(rn))
+    {
+      if ((pe = rn->info) == NULL)
+        continue;
 
-  /* Prepare EIGRP EOT UPDATE header */
-  eigrp_packet_header_init(EIGRP_OPC_UPDATE, nbr->ei, ep->s, EIGRP_EOT_FLAG,
-                           nbr->ei->eigrp->sequence_number,
-                           nbr->recv_sequence_number);
+      if (!eigrp_update_stub_permits(ei->eigrp, pe))
+        continue;
 
-  // encode Authentication TLV, if needed
-  if((IF_DEF_PARAMS (nbr->ei->ifp)->auth_type == EIGRP_AUTH_TYPE_MD5) && (IF_DEF_PARAMS (nbr->ei->ifp)->auth_keychain != NULL))
-    {
-      length += eigrp_add_authTLV_MD5_to_stream(ep->s,nbr->ei);
-    }
+      if (eigrp_summary_lookup(ei, pe->destination_ipv4))
+        continue;
 
-  for (ALL_LIST_ELEMENTS(nbr->ei->eigrp->topology_table, node, nnode, pe))
-    {
       for (ALL_LIST_ELEMENTS(pe->entries, node2, nnode2, te))
         {
-          if ((te->ei == nbr->ei)
+          if ((te->ei == ei)
               && (te->prefix->nt == EIGRP_TOPOLOGY_TYPE_REMOTE))
             continue;
 
-          length += eigrp_add_internalTLV_to_stream(ep->s, pe);
+          if (ep && ep->length + EIGRP_TLV_IPv4_MAX_LEN(pe) > max_len)
+            {
+              eigrp_update_send_EOT_packet(nbr, ep, 0);
+              ep = NULL;
+            }
+
+          if (ep == NULL)
+            ep = eigrp_packet_reliable_new(EIGRP_OPC_UPDATE, ei,
+                                           nbr->recv_sequence_number);
+
+          /* one TLV per prefix is enough */
+          ep->length += eigrp_add_prefixTLV_to_stream(ep->s, pe);
+          break;
         }
     }
 
-  if((IF_DEF_PARAMS (nbr->ei->ifp)->auth_type == EIGRP_AUTH_TYPE_MD5) && (IF_DEF_PARAMS (nbr->ei->ifp)->auth_keychain != NULL))
+  for (rn = route_top(IF_SUMMARIES(ei->ifp)); rn; rn = route_next(rn))
     {
-      eigrp_make_md5_digest(nbr->ei,ep->s, EIGRP_AUTH_UPDATE_FLAG);
-    }
+      if ((sum = rn->info) == NULL)
+        continue;
 
-  /* EIGRP Checksum */
-  eigrp_packet_checksum(nbr->ei, ep->s, length);
-
-  ep->length = length;
-  ep->dst.s_addr = nbr->src.s_addr;
+      if (!eigrp_update_stub_permits_summary(ei->eigrp))
+        {
+          route_unlock_node(rn);
+          break;
+        }
 
-  /*This ack number we await from neighbor*/
-  ep->sequence_number = nbr->ei->eigrp->sequence_number;
+      eigrp_summary_refresh(ei->eigrp, sum);
+      if (sum->components == 0)
+        continue;
 
-  if (IS_DEBUG_EIGRP_PACKET(0, RECV))
-    zlog_debug("Enqueuing Update Init Len [%u] Seq [%u] Dest [%s]",
-               ep->length, ep->sequence_number, inet_ntoa(ep->dst));
+      if (ep && ep->length + EIGRP_TLV_IPv4_INT_MAX_LEN > max_len)
+        {
+          eigrp_update_send_EOT_packet(nbr, ep, 0);
+          ep = NULL;
+        }
 
-  /*Put packet to retransmission queue*/
-  eigrp_fifo_push_head(nbr->retrans_queue, ep);
+      if (ep == NULL)
+        ep = eigrp_packet_reliable_new(EIGRP_OPC_UPDATE, ei,
+                                       nbr->recv_sequence_number);
 
-  if (nbr->retrans_queue->count == 1)
-    {
-      eigrp_send_packet_reliably(nbr);
+      ep->length += eigrp_add_ipv4_tlv_to_stream(ep->s, &sum->prefix,
+                                                 &sum->metric);
     }
 
+  if (ep == NULL)
+    ep = eigrp_packet_reliable_new(EIGRP_OPC_UPDATE, ei,
+                                   nbr->recv_sequence_number);
+
+  eigrp_update_send_EOT_packet(nbr, ep, EIGRP_EOT_FLAG);
+
+  /* neighbor has got every change made so far */
+  nbr->serno_last_update = ei->eigrp->serno;
 }
 
+/*
+ * Prefixes changed since the last Update sent out of the interface are
+ * flooded in as many Update packets as it takes to keep each of them
+ * within the interface MTU.
+ *
+ * Changed components of a summary on the interface are not sent, the
+ * summary is, if its best metric has changed.  Summaries go first: a packet
+ * carrying only summaries has no serno and reaches every neighbor.
+ */
 void
 eigrp_update_send (struct eigrp_interface *ei)
 {
-  struct eigrp_packet *ep, *duplicate;
-  struct listnode *node, *nnode, *node2, *nnode2;
-  struct eigrp_neighbor *nbr;
+  struct eigrp_packet *ep = NULL;
   struct eigrp_prefix_entry *pe;
-  u_char has_tlv;
-
-  u_int16_t length = EIGRP_HEADER_LEN;
+  struct eigrp_summary *sum;
+  struct route_node *rn;
+  u_int16_t max_len = eigrp_packet_max_len(ei);
+  u_int64_t since = ei->serno_last_update;
+  u_int64_t serno = 0;
 
-  ep = eigrp_packet_new(ei->ifp->mtu);
+  ei->serno_last_update = ei->eigrp->serno;
 
-  /* Prepare EIGRP INIT UPDATE header */
-  eigrp_packet_header_init(EIGRP_OPC_UPDATE, ei, ep->s, 0,
-                           ei->eigrp->sequence_number, 0);
-
-  // encode Authentication TLV, if needed
-  if((IF_DEF_PARAMS (ei->ifp)->auth_type == EIGRP_AUTH_TYPE_MD5) && (IF_DEF_PARAMS (ei->ifp)->auth_keychain != NULL))
+  for (rn = route_top(IF_SUMMARIES(ei->ifp)); rn; rn = route_next(rn))
     {
-      length += eigrp_add_authTLV_MD5_to_stream(ep->s,ei);
-    }
+      if ((sum = rn->info) == NULL)
+        continue;
 
-  has_tlv = 0;
-  for (ALL_LIST_ELEMENTS(ei->eigrp->topology_changes_internalIPV4, node, nnode, pe))
-    {
-      if(pe->req_action & EIGRP_FSM_NEED_UPDATE)
+      if (!eigrp_update_stub_permits_summary(ei->eigrp))
         {
-    	  // TODO : ditribute-list <ACL> out should be checked here
+          route_unlock_node(rn);
+          break;
+        }
 
-          length += eigrp_add_internalTLV_to_stream(ep->s, pe);
-          has_tlv = 1;
+      eigrp_summary_refresh(ei->eigrp, sum);
+      if (sum->distance == sum->adv_distance)
+        continue;
+
+      if (ep && ep->length + EIGRP_TLV_IPv4_INT_MAX_LEN > max_len)
+        {
+          eigrp_update_send_packet(ei, ep, serno);
+          ep = NULL;
         }
-    }
 
-  if(!has_tlv)
-    {
-      eigrp_packet_free(ep);
-      return;
+      if (ep == NULL)
+        ep = eigrp_packet_reliable_new(EIGRP_OPC_UPDATE, ei, 0);
+
+      ep->length += eigrp_add_ipv4_tlv_to_stream(ep->s, &sum->prefix,
+                                                 &sum->metric);
+      sum->adv_distance = sum->distance;
     }
 
-  if((IF_DEF_PARAMS (ei->ifp)->auth_type == EIGRP_AUTH_TYPE_MD5) && (IF_DEF_PARAMS (ei->ifp)->auth_keychain != NULL))
+  for (pe = eigrp_topology_changes_since(ei->eigrp, since); pe;
+       pe = pe->change_next)
     {
-      eigrp_make_md5_digest(ei,ep->s, EIGRP_AUTH_UPDATE_FLAG);
+      if(!(pe->req_action & EIGRP_FSM_NEED_UPDATE))
+        continue;
+
+      if (!eigrp_update_stub_permits(ei->eigrp, pe))
+        continue;
+
+      if (eigrp_summary_lookup(ei, pe->destination_ipv4))
+        continue;
+
+      // TODO : ditribute-list <ACL> out should be checked here
+
+      if (ep && ep->length + EIGRP_TLV_IPv4_MAX_LEN(pe) > max_len)
+        {
+          eigrp_update_send_packet(ei, ep, serno);
+          ep = NULL;
+        }
+
+      if (ep == NULL)
+        ep = eigrp_packet_reliable_new(EIGRP_OPC_UPDATE, ei, 0);
+
+      ep->length += eigrp_add_prefixTLV_to_stream(ep->s, pe);
+      serno = pe->serno;
     }
 
-  /* EIGRP Checksum */
-  eigrp_packet_checksum(ei, ep->s, length);
-  ep->length = length;
+  if (ep)
+    eigrp_update_send_packet(ei, ep, serno);
+}
 
-  ep->dst.s_addr = htonl(EIGRP_MULTICAST_ADDRESS);
+/*
+ * Summary has just been configured on the interface, or is about to be
+ * removed from it: neighbors swap the routes it covers for the summary,
+ * or get them back.
+ */
+void
+eigrp_update_send_summary (struct eigrp_interface *ei,
+                           struct eigrp_summary *sum, int removed)
+{
+  struct eigrp *eigrp = ei->eigrp;
+  struct eigrp_packet *ep = NULL;
+  struct eigrp_prefix_entry *pe;
+  struct eigrp_metrics unreachable;
+  struct route_node *rn, *top;
+  u_int16_t max_len = eigrp_packet_max_len(ei);
 
-  /*This ack number we await from neighbor*/
-  ep->sequence_number = ei->eigrp->sequence_number;
+  memset(&unreachable, 0, sizeof(unreachable));
+  unreachable.delay = EIGRP_MAX_METRIC;
 
-  if (IS_DEBUG_EIGRP_PACKET(0, RECV))
-    zlog_debug("Enqueuing Update length[%u] Seq [%u]",
-               length, ep->sequence_number);
+  top = route_node_get(eigrp->topology_table, (struct prefix *)&sum->prefix);
+  route_lock_node(top);
 
-  for (ALL_LIST_ELEMENTS(ei->nbrs, node, nnode, nbr))
+  for (rn = top; rn; rn = route_next_until(rn, top))
     {
-      if (nbr->state == EIGRP_NEIGHBOR_UP)
+      if ((pe = rn->info) == NULL || pe->distance == EIGRP_MAX_METRIC)
+        continue;
+
+      if (!eigrp_update_stub_permits(eigrp, pe))
+        continue;
+
+      /* still hidden behind another summary */
+      if (removed && eigrp_summary_lookup(ei, pe->destination_ipv4))
+        continue;
+
+      if (ep && ep->length + EIGRP_TLV_IPv4_MAX_LEN(pe) > max_len)
         {
-          /*Put packet to retransmission queue*/
-          eigrp_fifo_push_head(nbr->retrans_queue, ep);
+          eigrp_update_send_packet(ei, ep, 0);
+          ep = NULL;
+        }
 
-          if (nbr->retrans_queue->count == 1)
-            {
-              eigrp_send_packet_reliably(nbr);
-            }
+      if (ep == NULL)
+        ep = eigrp_packet_reliable_new(EIGRP_OPC_UPDATE, ei, 0);
+
+      if (removed)
+        ep->length += eigrp_add_prefixTLV_to_stream(ep->s, pe);
+      else
+        ep->length += eigrp_add_ipv4_tlv_to_stream(ep->s, pe->destination_ipv4,
+                                                   &unreachable);
+    }
+
+  route_unlock_node(top);
+
+  if (removed)
+    {
+      sum->distance = EIGRP_MAX_METRIC;
+      sum->metric = unreachable;
+    }
+  else
+    eigrp_summary_refresh(eigrp, sum);
+
+  if (sum->distance != sum->adv_distance
+      && eigrp_update_stub_permits_summary(eigrp))
+    {
+      if (ep && ep->length + EIGRP_TLV_IPv4_INT_MAX_LEN > max_len)
+        {
+          eigrp_update_send_packet(ei, ep, 0);
+          ep = NULL;
         }
+
+      if (ep == NULL)
+        ep = eigrp_packet_reliable_new(EIGRP_OPC_UPDATE, ei, 0);
+
+      ep->length += eigrp_add_ipv4_tlv_to_stream(ep->s, &sum->prefix,
+                                                 &sum->metric);
+      sum->adv_distance = sum->distance;
     }
+
+  if (ep)
+    eigrp_update_send_packet(ei, ep, 0);
 }
 
 void
@@ -419,24 +591,30 @@ eigrp_update_send_all (struct eigrp *eigrp, struct eigrp_interface *exception)
 {
 
   struct eigrp_interface *iface;
-  struct listnode *node, *node2, *nnode2;
-  struct eigrp_prefix_entry *pe;
+  struct listnode *node;
+  struct eigrp_prefix_entry *pe, *next;
 
   for (ALL_LIST_ELEMENTS_RO(eigrp->eiflist, node, iface))
     {
       if (iface != exception)
-        {
-          eigrp_update_send(iface);
-        }
+        eigrp_update_send(iface);
+      else
+        iface->serno_last_update = eigrp->serno;
     }
 
-  for (ALL_LIST_ELEMENTS(eigrp->topology_changes_internalIPV4, node2, nnode2, pe))
+  for (pe = eigrp_topology_changes_since(eigrp, eigrp->serno_last_update); pe;
+       pe = next)
     {
-      if(pe->req_action & EIGRP_FSM_NEED_UPDATE)
-        {
-          pe->req_action &= ~EIGRP_FSM_NEED_UPDATE;
-          listnode_delete(eigrp->topology_changes_internalIPV4, pe);
-          zlog_debug("UPDATE COUNT: %d", eigrp->topology_changes_internalIPV4->count);
-        }
+      next = pe->change_next;
+
+      pe->req_action &= ~EIGRP_FSM_NEED_UPDATE;
+
+      /* unreachable prefix has been withdrawn, see
+       * eigrp_update_topology_table_prefix() */
+      if (!pe->req_action && pe->state == EIGRP_FSM_STATE_PASSIVE
+          && pe->distance == EIGRP_MAX_METRIC
+          && pe->nt != EIGRP_TOPOLOGY_TYPE_CONNECTED)
+        eigrp_prefix_entry_delete(eigrp->topology_table, pe);
     }
+  eigrp->serno_last_update = eigrp->serno;
 }
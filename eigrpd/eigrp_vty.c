@@ -50,6 +50,8 @@
 #include "eigrpd/eigrp_network.h"
 #include "eigrpd/eigrp_dump.h"
 #include "eigrpd/eigrp_const.h"
+#include "eigrpd/eigrp_summary.h"
+#include "eigrpd/eigrp_stats.h"
 
 
 static int
@@ -71,10 +73,34 @@ config_write_network (struct vty *vty, struct eigrp *eigrp)
   return 0;
 }
 
+static int
+config_write_redistribute (struct vty *vty, struct eigrp *eigrp)
+{
+  struct eigrp_metrics *dm;
+  int type;
+
+  for (type = 0; type < ZEBRA_ROUTE_MAX; type++)
+    {
+      if (type == ZEBRA_ROUTE_EIGRP || !eigrp_is_type_redistributed (type))
+        continue;
+
+      dm = &eigrp->dmetric[type];
+      vty_out (vty, " redistribute %s metric %u %u %u %u %u%s",
+               zebra_route_string (type), dm->bandwith, dm->delay,
+               dm->reliability, dm->load,
+               dm->mtu[0] | (dm->mtu[1] << 8) | (dm->mtu[2] << 16),
+               VTY_NEWLINE);
+    }
+
+  return 0;
+}
+
 static int
 config_write_interfaces (struct vty *vty, struct eigrp *eigrp)
 {
   struct eigrp_interface *ei;
+  struct eigrp_summary *sum;
+  struct route_node *rn;
   struct listnode *node;
 
   for (ALL_LIST_ELEMENTS_RO (eigrp->eiflist, node, ei))
@@ -98,12 +124,27 @@ config_write_interfaces (struct vty *vty, struct eigrp *eigrp)
 
       if ((IF_DEF_PARAMS (ei->ifp)->v_hello) != EIGRP_HELLO_INTERVAL_DEFAULT)
         {
-          vty_out (vty, " ip hello-interval eigrp %d%s", IF_DEF_PARAMS (ei->ifp)->v_hello, VTY_NEWLINE);
+          if (IF_DEF_PARAMS (ei->ifp)->v_hello % 1000)
+            vty_out (vty, " ip hello-interval eigrp msec %u%s", IF_DEF_PARAMS (ei->ifp)->v_hello, VTY_NEWLINE);
+          else
+            vty_out (vty, " ip hello-interval eigrp %u%s", IF_DEF_PARAMS (ei->ifp)->v_hello / 1000, VTY_NEWLINE);
         }
 
       if ((IF_DEF_PARAMS (ei->ifp)->v_wait) != EIGRP_HOLD_INTERVAL_DEFAULT)
         {
-          vty_out (vty, " ip hold-time eigrp %d%s", IF_DEF_PARAMS (ei->ifp)->v_wait, VTY_NEWLINE);
+          if (IF_DEF_PARAMS (ei->ifp)->v_wait % 1000)
+            vty_out (vty, " ip hold-time eigrp msec %u%s", IF_DEF_PARAMS (ei->ifp)->v_wait, VTY_NEWLINE);
+          else
+            vty_out (vty, " ip hold-time eigrp %u%s", IF_DEF_PARAMS (ei->ifp)->v_wait / 1000, VTY_NEWLINE);
+        }
+
+      for (rn = route_top (IF_SUMMARIES (ei->ifp)); rn; rn = route_next (rn))
+        {
+          if ((sum = rn->info) == NULL)
+            continue;
+          vty_out (vty, " ip summary-address eigrp %d %s/%d%s", eigrp->AS,
+                   inet_ntoa (sum->prefix.prefix), sum->prefix.prefixlen,
+                   VTY_NEWLINE);
         }
 
       /*Separate this EIGRP interface configuration from the others*/
@@ -229,6 +270,99 @@ DEFUN (no_eigrp_timers_active,
   return CMD_SUCCESS;
 }
 
+DEFUN (eigrp_timers_dual_flush,
+       eigrp_timers_dual_flush_cmd,
+       "timers dual-flush <0-1000>",
+       "Adjust routing timers\n"
+       "Time DUAL collects topology changes before sending them\n"
+       "Delay in milliseconds, 0 sends right after the received packet\n")
+{
+  struct eigrp *eigrp = vty->index;
+
+  eigrp->dual_flush_delay = atoi (argv[0]);
+
+  return CMD_SUCCESS;
+}
+
+DEFUN (no_eigrp_timers_dual_flush,
+       no_eigrp_timers_dual_flush_cmd,
+       "no timers dual-flush",
+       NO_STR
+       "Adjust routing timers\n"
+       "Time DUAL collects topology changes before sending them\n")
+{
+  struct eigrp *eigrp = vty->index;
+
+  eigrp->dual_flush_delay = EIGRP_DUAL_FLUSH_DELAY_DEFAULT;
+
+  return CMD_SUCCESS;
+}
+
+ALIAS (no_eigrp_timers_dual_flush,
+       no_eigrp_timers_dual_flush_val_cmd,
+       "no timers dual-flush <0-1000>",
+       NO_STR
+       "Adjust routing timers\n"
+       "Time DUAL collects topology changes before sending them\n"
+       "Delay in milliseconds, 0 sends right after the received packet\n")
+
+DEFUN (eigrp_stub,
+       eigrp_stub_cmd,
+       "eigrp stub {connected|summary|static|redistributed}",
+       "EIGRP specific commands\n"
+       "Set EIGRP as a stub router\n"
+       "Do advertise connected routes\n"
+       "Do advertise summary routes\n"
+       "Do advertise static routes\n"
+       "Do advertise redistributed routes\n")
+{
+  struct eigrp *eigrp = vty->index;
+  u_int16_t stub = 0;
+
+  if (argv[0] != NULL)
+    stub |= EIGRP_STUB_CONNECTED;
+  if (argv[1] != NULL)
+    stub |= EIGRP_STUB_SUMMARY;
+  if (argv[2] != NULL)
+    stub |= EIGRP_STUB_STATIC;
+  if (argv[3] != NULL)
+    stub |= EIGRP_STUB_REDISTRIBUTED;
+
+  eigrp->stub = stub ? stub : EIGRP_STUB_DEFAULT;
+  eigrp_hello_template_flush (eigrp);
+
+  return CMD_SUCCESS;
+}
+
+DEFUN (eigrp_stub_receive_only,
+       eigrp_stub_receive_only_cmd,
+       "eigrp stub receive-only",
+       "EIGRP specific commands\n"
+       "Set EIGRP as a stub router\n"
+       "Set receive only neighbor\n")
+{
+  struct eigrp *eigrp = vty->index;
+
+  eigrp->stub = EIGRP_STUB_RECEIVE_ONLY;
+  eigrp_hello_template_flush (eigrp);
+
+  return CMD_SUCCESS;
+}
+
+DEFUN (no_eigrp_stub,
+       no_eigrp_stub_cmd,
+       "no eigrp stub",
+       NO_STR
+       "EIGRP specific commands\n"
+       "Set EIGRP as a stub router\n")
+{
+  struct eigrp *eigrp = vty->index;
+
+  eigrp->stub = 0;
+  eigrp_hello_template_flush (eigrp);
+
+  return CMD_SUCCESS;
+}
 
 DEFUN (eigrp_metric_weights,
        eigrp_metric_weights_cmd,
@@ -338,42 +472,148 @@ DEFUN (no_eigrp_neighbor,
   return CMD_SUCCESS;
 }
 
-DEFUN (show_ip_eigrp_topology,
-       show_ip_eigrp_topology_cmd,
-       "show ip eigrp topology",
-       SHOW_STR
-       IP_STR
-       "IP-EIGRP show commands\n"
-       "IP-EIGRP topology\n")
+/*
+ * The topology can hold 100k prefixes, so show ip eigrp topology prints
+ * it a chunk at a time through vty_output_start() and lets the other
+ * threads run in between.  Nothing is held across chunks: the cursor
+ * remembers the last prefix printed and the next chunk looks up where to
+ * continue, so prefixes coming and going in the meantime, or the whole
+ * instance going away, are harmless.
+ */
+#define EIGRP_TOPOLOGY_SHOW_CHUNK	256
+
+#define EIGRP_TOPOLOGY_SHOW_ALL_LINKS	0x01	/* not only successors and FS */
+#define EIGRP_TOPOLOGY_SHOW_ACTIVE	0x02	/* active prefixes only */
+#define EIGRP_TOPOLOGY_SHOW_LONGER	0x04	/* prefixes within cursor->within */
+
+struct eigrp_topology_cursor
 {
-  struct eigrp *eigrp;
-  struct listnode *node, *nnode, *node2, *nnode2;
-  struct eigrp_prefix_entry *tn;
+  u_int16_t AS;
+  u_char flags;
+  u_char started;
+  struct prefix_ipv4 within;	/* for EIGRP_TOPOLOGY_SHOW_LONGER */
+  struct prefix_ipv4 last;	/* last prefix printed */
+};
+
+static void
+show_ip_eigrp_topology_entry (struct vty *vty, struct eigrp *eigrp,
+                              struct eigrp_prefix_entry *tn, int all_links)
+{
+  struct listnode *node;
   struct eigrp_neighbor_entry *te;
 
+  show_ip_eigrp_prefix_entry (vty, tn);
+  for (ALL_LIST_ELEMENTS_RO (tn->entries, node, te))
+    {
+      if (all_links
+          || (te->flags & EIGRP_NEIGHBOR_ENTRY_SUCCESSOR_FLAG)
+          || (te->flags & EIGRP_NEIGHBOR_ENTRY_FSUCCESSOR_FLAG))
+        show_ip_eigrp_neighbor_entry (vty, eigrp, te);
+    }
+}
+
+static int
+show_ip_eigrp_topology_chunk (struct vty *vty, void *arg)
+{
+  struct eigrp_topology_cursor *cursor = arg;
+  struct eigrp *eigrp;
+  struct route_table *table;
+  struct route_node *rn;
+  int count = 0;
+
+  eigrp = eigrp_lookup ();
+  if (eigrp == NULL || eigrp->AS != cursor->AS)
+    return 0;
+
+  if (cursor->flags & EIGRP_TOPOLOGY_SHOW_ACTIVE)
+    table = eigrp->topology_active;
+  else
+    table = eigrp->topology_table;
+
+  /* The subtree of within follows its node in route_next() order. */
+  if (!cursor->started)
+    {
+      cursor->started = 1;
+      if (cursor->flags & EIGRP_TOPOLOGY_SHOW_LONGER)
+        rn = route_node_get (table, (struct prefix *) &cursor->within);
+      else
+        rn = route_top (table);
+    }
+  else
+    rn = route_next (route_node_get (table, (struct prefix *) &cursor->last));
+
+  for (; rn; rn = route_next (rn))
+    {
+      if ((cursor->flags & EIGRP_TOPOLOGY_SHOW_LONGER)
+          && !prefix_match ((struct prefix *) &cursor->within, &rn->p))
+        {
+          route_unlock_node (rn);
+          return 0;
+        }
+
+      if (rn->info == NULL)
+        continue;
+
+      show_ip_eigrp_topology_entry (vty, eigrp, rn->info,
+                                    cursor->flags & EIGRP_TOPOLOGY_SHOW_ALL_LINKS);
+
+      if (++count == EIGRP_TOPOLOGY_SHOW_CHUNK)
+        {
+          prefix_copy ((struct prefix *) &cursor->last, &rn->p);
+          route_unlock_node (rn);
+          return 1;
+        }
+    }
+
+  return 0;
+}
+
+static void
+show_ip_eigrp_topology_cursor_free (void *arg)
+{
+  XFREE (MTYPE_EIGRP_TOPOLOGY_CURSOR, arg);
+}
+
+static int
+show_ip_eigrp_topology_start (struct vty *vty, u_char flags,
+                              struct prefix_ipv4 *within)
+{
+  struct eigrp *eigrp;
+  struct eigrp_topology_cursor *cursor;
+
   eigrp = eigrp_lookup ();
   if (eigrp == NULL)
-  {
-    vty_out (vty, " EIGRP Routing Process not enabled%s", VTY_NEWLINE);
-    return CMD_SUCCESS;
-  }
+    {
+      vty_out (vty, " EIGRP Routing Process not enabled%s", VTY_NEWLINE);
+      return CMD_SUCCESS;
+    }
 
   show_ip_eigrp_topology_header (vty, eigrp);
 
-  for (ALL_LIST_ELEMENTS (eigrp->topology_table, node, nnode, tn))
-  {
-    show_ip_eigrp_prefix_entry (vty,tn);
-    for (ALL_LIST_ELEMENTS (tn->entries, node2, nnode2, te))
-      {
-        if (((te->flags & EIGRP_NEIGHBOR_ENTRY_SUCCESSOR_FLAG) == EIGRP_NEIGHBOR_ENTRY_SUCCESSOR_FLAG)||
-            ((te->flags & EIGRP_NEIGHBOR_ENTRY_FSUCCESSOR_FLAG) == EIGRP_NEIGHBOR_ENTRY_FSUCCESSOR_FLAG))
-          show_ip_eigrp_neighbor_entry (vty, eigrp, te);
-      }
-    }
+  cursor = XCALLOC (MTYPE_EIGRP_TOPOLOGY_CURSOR,
+                    sizeof (struct eigrp_topology_cursor));
+  cursor->AS = eigrp->AS;
+  cursor->flags = flags;
+  if (within)
+    cursor->within = *within;
+
+  vty_output_start (vty, show_ip_eigrp_topology_chunk,
+                    show_ip_eigrp_topology_cursor_free, cursor);
 
   return CMD_SUCCESS;
 }
 
+DEFUN (show_ip_eigrp_topology,
+       show_ip_eigrp_topology_cmd,
+       "show ip eigrp topology",
+       SHOW_STR
+       IP_STR
+       "IP-EIGRP show commands\n"
+       "IP-EIGRP topology\n")
+{
+  return show_ip_eigrp_topology_start (vty, 0, NULL);
+}
+
 DEFUN (show_ip_eigrp_topology_all_links,
        show_ip_eigrp_topology_all_links_cmd,
        "show ip eigrp topology all-links",
@@ -382,11 +622,64 @@ DEFUN (show_ip_eigrp_topology_all_links,
        "IP-EIGRP show commands\n"
        "IP-EIGRP topology\n"
        "Show all links in topology table\n")
+{
+  return show_ip_eigrp_topology_start (vty, EIGRP_TOPOLOGY_SHOW_ALL_LINKS,
+                                       NULL);
+}
+
+ALIAS (show_ip_eigrp_topology_all_links,
+       show_ip_eigrp_topology_detail_cmd,
+       "show ip eigrp topology detail",
+       SHOW_STR
+       IP_STR
+       "IP-EIGRP show commands\n"
+       "IP-EIGRP topology\n"
+       "Show all links in topology table\n")
+
+DEFUN (show_ip_eigrp_topology_active,
+       show_ip_eigrp_topology_active_cmd,
+       "show ip eigrp topology active",
+       SHOW_STR
+       IP_STR
+       "IP-EIGRP show commands\n"
+       "IP-EIGRP topology\n"
+       "Show only active entries\n")
+{
+  return show_ip_eigrp_topology_start (vty, EIGRP_TOPOLOGY_SHOW_ACTIVE
+                                       | EIGRP_TOPOLOGY_SHOW_ALL_LINKS, NULL);
+}
+
+DEFUN (show_ip_eigrp_topology_longer,
+       show_ip_eigrp_topology_longer_cmd,
+       "show ip eigrp topology A.B.C.D/M longer-prefixes",
+       SHOW_STR
+       IP_STR
+       "IP-EIGRP show commands\n"
+       "IP-EIGRP topology\n"
+       "IP prefix <network>/<length>, e.g., 192.168.0.0/16\n"
+       "Show entries for this prefix and all more specific ones\n")
+{
+  struct prefix_ipv4 p;
+
+  VTY_GET_IPV4_PREFIX ("prefix", p, argv[0]);
+  apply_mask_ipv4 (&p);
+
+  return show_ip_eigrp_topology_start (vty, EIGRP_TOPOLOGY_SHOW_LONGER, &p);
+}
+
+DEFUN (show_ip_eigrp_topology_prefix,
+       show_ip_eigrp_topology_prefix_cmd,
+       "show ip eigrp topology (A.B.C.D|A.B.C.D/M)",
+       SHOW_STR
+       IP_STR
+       "IP-EIGRP show commands\n"
+       "IP-EIGRP topology\n"
+       "Network to display information about\n"
+       "IP prefix <network>/<length>, e.g., 192.168.0.0/16\n")
 {
   struct eigrp *eigrp;
-  struct listnode *node, *nnode, *node2, *nnode2;
-  struct eigrp_prefix_entry *tn;
-  struct eigrp_neighbor_entry *te;
+  struct prefix_ipv4 p;
+  struct route_node *rn;
 
   eigrp = eigrp_lookup ();
   if (eigrp == NULL)
@@ -395,32 +688,34 @@ DEFUN (show_ip_eigrp_topology_all_links,
       return CMD_SUCCESS;
     }
 
-  show_ip_eigrp_topology_header (vty, eigrp);
+  /* An address shows the entry routing it, a prefix that exact entry. */
+  if (strchr (argv[0], '/'))
+    {
+      VTY_GET_IPV4_PREFIX ("prefix", p, argv[0]);
+      apply_mask_ipv4 (&p);
+      rn = route_node_lookup (eigrp->topology_table, (struct prefix *) &p);
+    }
+  else
+    {
+      VTY_GET_IPV4_ADDRESS ("address", p.prefix, argv[0]);
+      rn = route_node_match_ipv4 (eigrp->topology_table, &p.prefix);
+    }
 
-  for (ALL_LIST_ELEMENTS (eigrp->topology_table, node, nnode, tn))
+  if (rn == NULL || rn->info == NULL)
     {
-      show_ip_eigrp_prefix_entry (vty,tn);
-      for (ALL_LIST_ELEMENTS (tn->entries, node2, nnode2, te))
-        {
-          show_ip_eigrp_neighbor_entry (vty, eigrp, te);
-        }
+      vty_out (vty, "%% Network not in table%s", VTY_NEWLINE);
+      if (rn)
+        route_unlock_node (rn);
+      return CMD_WARNING;
     }
 
+  show_ip_eigrp_topology_header (vty, eigrp);
+  show_ip_eigrp_topology_entry (vty, eigrp, rn->info, 1);
+  route_unlock_node (rn);
+
   return CMD_SUCCESS;
 }
 
-ALIAS (show_ip_eigrp_topology,
-       show_ip_eigrp_topology_detail_cmd,
-       "show ip eigrp topology (A.B.C.D|A.B.C.D/nn|detail|summary)",
-       SHOW_STR
-       IP_STR
-       "IP-EIGRP show commands\n"
-       "IP-EIGRP topology\n"
-       "Netwok to display information about\n"
-       "IP prefix <network>/<length>, e.g., 192.168.0.0/16\n"
-       "Show all links in topology table\n"
-       "Show a summary of the topology table\n")
-
 DEFUN (show_ip_eigrp_interfaces,
        show_ip_eigrp_interfaces_cmd,
        "show ip eigrp interfaces",
@@ -522,6 +817,62 @@ ALIAS (show_ip_eigrp_neighbors,
 	   "IP-EIGRP neighbors\n"
 	   INT_TYPES_DESC)
 
+DEFUN (show_ip_eigrp_statistics,
+       show_ip_eigrp_statistics_cmd,
+       "show ip eigrp statistics",
+       SHOW_STR
+       IP_STR
+       "IP-EIGRP show commands\n"
+       "IP-EIGRP performance counters and histograms\n")
+{
+  struct eigrp *eigrp;
+
+  eigrp = eigrp_lookup ();
+  if (eigrp == NULL)
+    {
+      vty_out (vty, " EIGRP Routing Process not enabled%s", VTY_NEWLINE);
+      return CMD_SUCCESS;
+    }
+
+  if (argc > 0)
+    eigrp_stats_show_raw (vty, eigrp);
+  else
+    eigrp_stats_show (vty, eigrp);
+
+  return CMD_SUCCESS;
+}
+
+ALIAS (show_ip_eigrp_statistics,
+       show_ip_eigrp_statistics_raw_cmd,
+       "show ip eigrp statistics (raw)",
+       SHOW_STR
+       IP_STR
+       "IP-EIGRP show commands\n"
+       "IP-EIGRP performance counters and histograms\n"
+       "Machine readable, in Prometheus text format\n")
+
+DEFUN (clear_ip_eigrp_statistics,
+       clear_ip_eigrp_statistics_cmd,
+       "clear ip eigrp statistics",
+       CLEAR_STR
+       IP_STR
+       "Clear IP-EIGRP\n"
+       "IP-EIGRP performance counters and histograms\n")
+{
+  struct eigrp *eigrp;
+
+  eigrp = eigrp_lookup ();
+  if (eigrp == NULL)
+    {
+      vty_out (vty, " EIGRP Routing Process not enabled%s", VTY_NEWLINE);
+      return CMD_SUCCESS;
+    }
+
+  eigrp_stats_clear (eigrp);
+
+  return CMD_SUCCESS;
+}
+
 DEFUN (eigrp_if_delay,
        eigrp_if_delay_cmd,
        "delay <1-16777215>",
@@ -557,6 +908,9 @@ DEFUN (eigrp_if_delay,
   ifp = vty->index;
   IF_DEF_PARAMS (ifp)->delay = delay;
 
+  for (ALL_LIST_ELEMENTS (eigrp->eiflist, node, nnode, ei))
+    if (ei->ifp == ifp)
+      eigrp_if_cost_update (ei);
 
   return CMD_SUCCESS;
 }
@@ -585,6 +939,10 @@ DEFUN (no_eigrp_if_delay,
   ifp = vty->index;
   IF_DEF_PARAMS (ifp)->delay = EIGRP_DELAY_DEFAULT;
 
+  for (ALL_LIST_ELEMENTS (eigrp->eiflist, node, nnode, ei))
+    if (ei->ifp == ifp)
+      eigrp_if_cost_update (ei);
+
   return CMD_SUCCESS;
 }
 
@@ -621,6 +979,9 @@ DEFUN (eigrp_if_bandwidth,
   ifp = vty->index;
   IF_DEF_PARAMS (ifp)->bandwidth = bandwidth;
 
+  for (ALL_LIST_ELEMENTS (eigrp->eiflist, node, nnode, ei))
+    if (ei->ifp == ifp)
+      eigrp_if_cost_update (ei);
 
   return CMD_SUCCESS;
 }
@@ -635,6 +996,7 @@ DEFUN (no_eigrp_if_bandwidth,
   struct eigrp *eigrp;
   struct eigrp_interface *ei;
   struct listnode *node, *nnode, *node2, *nnode2;
+  struct route_node *rn;
   struct interface *ifp;
   struct eigrp_prefix_entry *pe;
   struct eigrp_neighbor_entry *ne;
@@ -658,14 +1020,21 @@ DEFUN (no_eigrp_if_bandwidth,
   ifp = vty->index;
   IF_DEF_PARAMS (ifp)->bandwidth = bandwidth;
 
+  for (ALL_LIST_ELEMENTS (eigrp->eiflist, node, nnode, ei))
+    if (ei->ifp == ifp)
+      eigrp_if_cost_update (ei);
+
   for (ALL_LIST_ELEMENTS (eigrp->eiflist, node, nnode, ei))
     {
       if (ei->ifp == ifp)
         break;
     }
 
-  for (ALL_LIST_ELEMENTS (eigrp->topology_table, node, nnode, pe))
+  for (rn = route_top (eigrp->topology_table); rn; rn = route_next (rn))
     {
+      if ((pe = rn->info) == NULL)
+        continue;
+
       for (ALL_LIST_ELEMENTS (pe->entries, node2, nnode2, ne))
         {
           /*TODO: */
@@ -703,6 +1072,41 @@ DEFUN (eigrp_if_ip_hellointerval,
       return CMD_WARNING;
     }
 
+  ifp = vty->index;
+  IF_DEF_PARAMS (ifp)->v_hello = hello * 1000;
+
+  return CMD_SUCCESS;
+}
+
+DEFUN (eigrp_if_ip_hellointerval_msec,
+       eigrp_if_ip_hellointerval_msec_cmd,
+       "ip hello-interval eigrp msec <50-65535>",
+       "Interface Internet Protocol config commands\n"
+       "Configures EIGRP hello interval\n"
+       "Enhanced Interior Gateway Routing Protocol (EIGRP)\n"
+       "Interval in milliseconds\n"
+       "Milliseconds between hello transmissions\n")
+{
+  u_int32_t hello;
+  struct eigrp *eigrp;
+  struct interface *ifp;
+
+  eigrp = eigrp_lookup ();
+  if (eigrp == NULL)
+    {
+      vty_out (vty, " EIGRP Routing Process not enabled%s", VTY_NEWLINE);
+      return CMD_SUCCESS;
+    }
+
+  hello = atoi (argv[0]);
+
+  /* hello range is <50-65535> */
+  if ((hello < EIGRP_HELLO_INTERVAL_MSEC_MIN) || (hello > 65535))
+    {
+      vty_out (vty, "Hello-interval value is invalid%s", VTY_NEWLINE);
+      return CMD_WARNING;
+    }
+
   ifp = vty->index;
   IF_DEF_PARAMS (ifp)->v_hello = hello;
 
@@ -764,8 +1168,45 @@ DEFUN (eigrp_if_ip_holdinterval,
       return CMD_WARNING;
     }
 
+  ifp = vty->index;
+  IF_DEF_PARAMS (ifp)->v_wait = hold * 1000;
+  eigrp_hello_template_flush (eigrp);
+
+  return CMD_SUCCESS;
+}
+
+DEFUN (eigrp_if_ip_holdinterval_msec,
+       eigrp_if_ip_holdinterval_msec_cmd,
+       "ip hold-time eigrp msec <150-65535>",
+       "Interface Internet Protocol config commands\n"
+       "Configures EIGRP hello interval\n"
+       "Enhanced Interior Gateway Routing Protocol (EIGRP)\n"
+       "Interval in milliseconds\n"
+       "Milliseconds before neighbor is considered down\n")
+{
+  u_int32_t hold;
+  struct eigrp *eigrp;
+  struct interface *ifp;
+
+  eigrp = eigrp_lookup ();
+  if (eigrp == NULL)
+    {
+      vty_out (vty, " EIGRP Routing Process not enabled%s", VTY_NEWLINE);
+      return CMD_SUCCESS;
+    }
+
+  hold = atoi (argv[0]);
+
+  /* hold range is <150-65535> */
+  if ((hold < EIGRP_HOLD_INTERVAL_MSEC_MIN) || (hold > 65535))
+    {
+      vty_out (vty, "Hold-time value is invalid%s", VTY_NEWLINE);
+      return CMD_WARNING;
+    }
+
   ifp = vty->index;
   IF_DEF_PARAMS (ifp)->v_wait = hold;
+  eigrp_hello_template_flush (eigrp);
 
   return CMD_SUCCESS;
 }
@@ -782,6 +1223,10 @@ DEFUN (eigrp_ip_summary_address,
   u_int32_t AS;
   struct eigrp *eigrp;
   struct interface *ifp;
+  struct eigrp_interface *ei;
+  struct eigrp_summary *sum;
+  struct listnode *node;
+  struct prefix_ipv4 p;
 
   eigrp = eigrp_lookup ();
   if (eigrp == NULL)
@@ -793,15 +1238,25 @@ DEFUN (eigrp_ip_summary_address,
   AS = atoi (argv[0]);
 
   /* hello range is <1-65535> */
-  if ((AS < 1) || (AS > 65535))
+  if ((AS < 1) || (AS > 65535) || (AS != eigrp->AS))
     {
       vty_out (vty, "AS value is invalid%s", VTY_NEWLINE);
       return CMD_WARNING;
     }
 
+  VTY_GET_IPV4_PREFIX ("summary address", p, argv[1]);
+  apply_mask_ipv4 (&p);
+
   ifp = vty->index;
 
-  /*TODO: */
+  if (eigrp_summary_find (ifp, &p))
+    return CMD_SUCCESS;
+
+  sum = eigrp_summary_get (ifp, &p);
+
+  for (ALL_LIST_ELEMENTS_RO (eigrp->eiflist, node, ei))
+    if (ei->ifp == ifp)
+      eigrp_update_send_summary (ei, sum, 0);
 
   return CMD_SUCCESS;
 }
@@ -819,6 +1274,10 @@ DEFUN (no_eigrp_ip_summary_address,
   u_int32_t AS;
   struct eigrp *eigrp;
   struct interface *ifp;
+  struct eigrp_interface *ei;
+  struct eigrp_summary *sum;
+  struct listnode *node;
+  struct prefix_ipv4 p;
 
   eigrp = eigrp_lookup ();
   if (eigrp == NULL)
@@ -830,15 +1289,32 @@ DEFUN (no_eigrp_ip_summary_address,
   AS = atoi (argv[0]);
 
   /* hello range is <1-65535> */
-  if ((AS < 1) || (AS > 65535))
+  if ((AS < 1) || (AS > 65535) || (AS != eigrp->AS))
     {
       vty_out (vty, "AS value is invalid%s", VTY_NEWLINE);
       return CMD_WARNING;
     }
 
+  VTY_GET_IPV4_PREFIX ("summary address", p, argv[1]);
+  apply_mask_ipv4 (&p);
+
   ifp = vty->index;
 
-  /*TODO: */
+  sum = eigrp_summary_find (ifp, &p);
+  if (sum == NULL)
+    {
+      vty_out (vty, "%% Summary address not configured%s", VTY_NEWLINE);
+      return CMD_WARNING;
+    }
+
+  /* components must not be matched against it any more */
+  eigrp_summary_remove (ifp, sum);
+
+  for (ALL_LIST_ELEMENTS_RO (eigrp->eiflist, node, ei))
+    if (ei->ifp == ifp)
+      eigrp_update_send_summary (ei, sum, 1);
+
+  eigrp_summary_free (sum);
 
   return CMD_SUCCESS;
 }
@@ -866,6 +1342,7 @@ DEFUN (no_eigrp_if_ip_holdinterval,
 
   ifp = vty->index;
   IF_DEF_PARAMS (ifp)->v_wait = EIGRP_HOLD_INTERVAL_DEFAULT;
+  eigrp_hello_template_flush (eigrp);
 
   return CMD_SUCCESS;
 }
@@ -905,6 +1382,7 @@ DEFUN (eigrp_authentication_mode,
 {
   struct eigrp *eigrp;
   struct interface *ifp;
+  int ret;
 
   eigrp = eigrp_lookup ();
   if (eigrp == NULL)
@@ -919,7 +1397,10 @@ DEFUN (eigrp_authentication_mode,
 //  else if(strncmp(argv[2], "hmac-sha-256",12))
 //    IF_DEF_PARAMS (ifp)->auth_type = EIGRP_AUTH_TYPE_SHA256;
 
-  return str2auth_type(argv[1], ifp);
+  ret = str2auth_type(argv[1], ifp);
+  eigrp_hello_template_flush (eigrp);
+
+  return ret;
 }
 
 DEFUN (no_eigrp_authentication_mode,
@@ -946,6 +1427,7 @@ DEFUN (no_eigrp_authentication_mode,
 
   ifp = vty->index;
   IF_DEF_PARAMS (ifp)->auth_type = EIGRP_AUTH_TYPE_NONE;
+  eigrp_hello_template_flush (eigrp);
 
   return CMD_SUCCESS;
 }
@@ -985,6 +1467,7 @@ DEFUN (eigrp_authentication_keychain,
     }
   else
     vty_out(vty,"Key chain with specified name not found%s", VTY_NEWLINE);
+  eigrp_hello_template_flush (eigrp);
 
   return CMD_SUCCESS;
 }
@@ -1015,6 +1498,7 @@ DEFUN (no_eigrp_authentication_keychain,
     {
       free (IF_DEF_PARAMS (ifp)->auth_keychain);
       IF_DEF_PARAMS (ifp)->auth_keychain = NULL;
+      eigrp_hello_template_flush (eigrp);
     }
   else
     vty_out(vty,"Key chain with specified name not configured on interface%s", VTY_NEWLINE);
@@ -1038,6 +1522,7 @@ DEFUN (eigrp_redistribute_source_metric,
 {
   struct eigrp *eigrp = vty->index;
   struct eigrp_metrics metrics_from_command;
+  u_int32_t reliability, load, mtu;
   int source;
 
   /* Get distribute source. */
@@ -1045,7 +1530,20 @@ DEFUN (eigrp_redistribute_source_metric,
   if (source < 0 )
     return CMD_WARNING;
 
-  /* Get metrics values */
+  /* Get metrics values, kept as entered, see eigrp_external_evaluate() */
+  memset (&metrics_from_command, 0, sizeof (metrics_from_command));
+  VTY_GET_INTEGER_RANGE ("bandwidth", metrics_from_command.bandwith, argv[1],
+                         1, 4294967295U);
+  VTY_GET_INTEGER_RANGE ("delay", metrics_from_command.delay, argv[2],
+                         0, 4294967295U);
+  VTY_GET_INTEGER_RANGE ("reliability", reliability, argv[3], 0, 255);
+  VTY_GET_INTEGER_RANGE ("load", load, argv[4], 1, 255);
+  VTY_GET_INTEGER_RANGE ("MTU", mtu, argv[5], 1, 65535);
+  metrics_from_command.reliability = reliability;
+  metrics_from_command.load = load;
+  metrics_from_command.mtu[0] = mtu & 0xFF;
+  metrics_from_command.mtu[1] = (mtu >> 8) & 0xFF;
+  metrics_from_command.mtu[2] = (mtu >> 16) & 0xFF;
 
   return eigrp_redistribute_set (eigrp, source, metrics_from_command);
 }
@@ -1066,7 +1564,6 @@ DEFUN (no_eigrp_redistribute_source_metric,
        "EIGRP MTU of the path\n")
 {
   struct eigrp *eigrp = vty->index;
-  struct eigrp_metrics metrics_from_command;
   int source;
 
   /* Get distribute source. */
@@ -1074,8 +1571,6 @@ DEFUN (no_eigrp_redistribute_source_metric,
   if (source < 0 )
     return CMD_WARNING;
 
-  /* Get metrics values */
-
   return eigrp_redistribute_unset (eigrp, source);
 }
 
@@ -1228,6 +1723,24 @@ eigrp_config_write (struct vty *vty)
                  inet_ntoa (router_id_static), VTY_NEWLINE);
       }
 
+      /* Stub router print. */
+      if (eigrp->stub & EIGRP_STUB_RECEIVE_ONLY)
+        vty_out (vty, " eigrp stub receive-only%s", VTY_NEWLINE);
+      else if (eigrp->stub)
+        vty_out (vty, " eigrp stub%s%s%s%s%s",
+                 (eigrp->stub & EIGRP_STUB_CONNECTED) ? " connected" : "",
+                 (eigrp->stub & EIGRP_STUB_SUMMARY) ? " summary" : "",
+                 (eigrp->stub & EIGRP_STUB_STATIC) ? " static" : "",
+                 (eigrp->stub & EIGRP_STUB_REDISTRIBUTED) ? " redistributed" : "",
+                 VTY_NEWLINE);
+
+      if (eigrp->dual_flush_delay != EIGRP_DUAL_FLUSH_DELAY_DEFAULT)
+        vty_out (vty, " timers dual-flush %u%s", eigrp->dual_flush_delay,
+                 VTY_NEWLINE);
+
+      /* Redistribution print. */
+      config_write_redistribute (vty, eigrp);
+
       /* Network area print. */
       config_write_network (vty, eigrp);
 
@@ -1277,6 +1790,21 @@ eigrp_vty_show_init (void)
   install_element (ENABLE_NODE, &show_ip_eigrp_topology_detail_cmd);
   install_element (VIEW_NODE, &show_ip_eigrp_topology_detail_cmd);
 
+  install_element (ENABLE_NODE, &show_ip_eigrp_topology_active_cmd);
+  install_element (VIEW_NODE, &show_ip_eigrp_topology_active_cmd);
+
+  install_element (ENABLE_NODE, &show_ip_eigrp_topology_longer_cmd);
+  install_element (VIEW_NODE, &show_ip_eigrp_topology_longer_cmd);
+
+  install_element (ENABLE_NODE, &show_ip_eigrp_topology_prefix_cmd);
+  install_element (VIEW_NODE, &show_ip_eigrp_topology_prefix_cmd);
+
+  install_element (ENABLE_NODE, &show_ip_eigrp_statistics_cmd);
+  install_element (VIEW_NODE, &show_ip_eigrp_statistics_cmd);
+  install_element (ENABLE_NODE, &show_ip_eigrp_statistics_raw_cmd);
+  install_element (VIEW_NODE, &show_ip_eigrp_statistics_raw_cmd);
+  install_element (ENABLE_NODE, &clear_ip_eigrp_statistics_cmd);
+
 }
 
 /* eigrpd's interface node. */
@@ -1301,8 +1829,10 @@ eigrp_vty_if_init (void)
 
   /*Hello-interval and hold-time interval configuration commands*/
   install_element (INTERFACE_NODE, &eigrp_if_ip_holdinterval_cmd);
+  install_element (INTERFACE_NODE, &eigrp_if_ip_holdinterval_msec_cmd);
   install_element (INTERFACE_NODE, &no_eigrp_if_ip_holdinterval_cmd);
   install_element (INTERFACE_NODE, &eigrp_if_ip_hellointerval_cmd);
+  install_element (INTERFACE_NODE, &eigrp_if_ip_hellointerval_msec_cmd);
   install_element (INTERFACE_NODE, &no_eigrp_if_ip_hellointerval_cmd);
 
   /* "description" commands. */
@@ -1342,6 +1872,9 @@ eigrp_vty_init (void)
   install_element (CONFIG_NODE, &no_router_eigrp_cmd);
   install_element (EIGRP_NODE, &eigrp_network_cmd);
   install_element (EIGRP_NODE, &no_eigrp_network_cmd);
+  install_element (EIGRP_NODE, &eigrp_stub_cmd);
+  install_element (EIGRP_NODE, &eigrp_stub_receive_only_cmd);
+  install_element (EIGRP_NODE, &no_eigrp_stub_cmd);
   install_element (EIGRP_NODE, &eigrp_variance_cmd);
   install_element (EIGRP_NODE, &no_eigrp_variance_cmd);
   install_element (EIGRP_NODE, &eigrp_router_id_cmd);
@@ -1350,6 +1883,9 @@ eigrp_vty_init (void)
   install_element (EIGRP_NODE, &no_eigrp_passive_interface_cmd);
   install_element (EIGRP_NODE, &eigrp_timers_active_cmd);
   install_element (EIGRP_NODE, &no_eigrp_timers_active_cmd);
+  install_element (EIGRP_NODE, &eigrp_timers_dual_flush_cmd);
+  install_element (EIGRP_NODE, &no_eigrp_timers_dual_flush_cmd);
+  install_element (EIGRP_NODE, &no_eigrp_timers_dual_flush_val_cmd);
   install_element (EIGRP_NODE, &eigrp_metric_weights_cmd);
   install_element (EIGRP_NODE, &no_eigrp_metric_weights_cmd);
   install_element (EIGRP_NODE, &eigrp_maximum_paths_cmd);
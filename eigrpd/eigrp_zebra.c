@@ -52,6 +52,8 @@
 #include "eigrpd/eigrp_network.h"
 #include "eigrpd/eigrp_topology.h"
 #include "eigrpd/eigrp_fsm.h"
+#include "eigrpd/eigrp_stats.h"
+#include "eigrpd/eigrp_external.h"
 
 static int eigrp_interface_add (int , struct zclient *, zebra_size_t);
 static int eigrp_interface_delete (int , struct zclient *,
@@ -124,7 +126,6 @@ eigrp_zebra_read_ipv4 (int command, struct zclient *zclient,
   unsigned long ifindex;
   struct in_addr nexthop;
   struct prefix_ipv4 p;
-  struct TLV_IPv4_External_type *external_tlv;
   struct eigrp *eigrp;
 
   s = zclient->ibuf;
@@ -166,13 +167,27 @@ eigrp_zebra_read_ipv4 (int command, struct zclient *zclient,
   if (eigrp == NULL)
     return 0;
 
+  if (api.type == ZEBRA_ROUTE_EIGRP || api.type > ZEBRA_ROUTE_MAX)
+    return 0;
+
+  if (IS_DEBUG_EIGRP (zebra, ZEBRA_REDISTRIBUTE))
+    zlog_debug ("Zebra: route %s %s/%d type %s",
+                command == ZEBRA_IPV4_ROUTE_ADD ? "add" : "delete",
+                inet_ntoa (p.prefix), p.prefixlen,
+                zebra_route_string (api.type));
+
   if (command == ZEBRA_IPV4_ROUTE_ADD)
     {
+      if (!eigrp_is_type_redistributed (api.type))
+        return 0;
 
+      eigrp_external_add (eigrp, api.type, &p, nexthop,
+                          CHECK_FLAG (api.message, ZAPI_MESSAGE_METRIC) ?
+                          api.metric : 0);
     }
   else                          /* if (command == ZEBRA_IPV4_ROUTE_DELETE) */
     {
-
+      eigrp_external_delete (eigrp, api.type, &p);
     }
 
   return 0;
@@ -398,125 +413,215 @@ zebra_interface_if_lookup (struct stream *s)
                                strnlen (ifname_tmp, INTERFACE_NAMSIZ));
 }
 
-void
-eigrp_zebra_route_add (struct prefix_ipv4 *p, struct eigrp_neighbor_entry *te)
+/*
+ * Install prefix with all its successors as nexthops (up to maximum-paths),
+ * zebra replaces whatever EIGRP route it had for the prefix.
+ */
+static void
+eigrp_zebra_route_add (struct eigrp *eigrp, struct eigrp_prefix_entry *pe)
 {
+  struct prefix_ipv4 *p = pe->destination_ipv4;
+  struct eigrp_neighbor_entry *te;
+  struct listnode *node;
   u_char message;
   u_char flags;
+  u_char count;
+  size_t count_at;
   int psize;
   struct stream *s;
 
-  if (zclient->redist[ZEBRA_ROUTE_EIGRP])
+  message = 0;
+  flags = 0;
+
+  /* EIGRP pass nexthop and metric */
+  SET_FLAG (message, ZAPI_MESSAGE_NEXTHOP);
+  SET_FLAG (message, ZAPI_MESSAGE_METRIC);
+
+  /* Make packet. */
+  s = zclient->obuf;
+  stream_reset (s);
+
+  /* Put command, type, flags, message. */
+  zclient_create_header (s, ZEBRA_IPV4_ROUTE_ADD);
+  stream_putc (s, ZEBRA_ROUTE_EIGRP);
+  stream_putc (s, flags);
+  stream_putc (s, message);
+  stream_putw (s, SAFI_UNICAST);
+
+  /* Put prefix information. */
+  psize = PSIZE (p->prefixlen);
+  stream_putc (s, p->prefixlen);
+  stream_write (s, (u_char *) & p->prefix, psize);
+
+  /* Nexthop count, filled in below. */
+  count = 0;
+  count_at = stream_get_endp (s);
+  stream_putc (s, 0);
+
+  /* Nexthop, ifindex for every successor. */
+  for (ALL_LIST_ELEMENTS_RO (pe->entries, node, te))
     {
-      message = 0;
-      flags = 0;
-
-      /* EIGRP pass nexthop and metric */
-      SET_FLAG (message, ZAPI_MESSAGE_NEXTHOP);
-      SET_FLAG (message, ZAPI_MESSAGE_METRIC);
-
-      /* Distance value. */
-//      distance = eigrp_distance_apply (p, er);
-//      if (distance)
-//        SET_FLAG (message, ZAPI_MESSAGE_DISTANCE);
-
-      /* Make packet. */
-      s = zclient->obuf;
-      stream_reset (s);
-
-      /* Put command, type, flags, message. */
-      zclient_create_header (s, ZEBRA_IPV4_ROUTE_ADD);
-      stream_putc (s, ZEBRA_ROUTE_EIGRP);
-      stream_putc (s, flags);
-      stream_putc (s, message);
-      stream_putw (s, SAFI_UNICAST);
-
-      /* Put prefix information. */
-      psize = PSIZE (p->prefixlen);
-      stream_putc (s, p->prefixlen);
-      stream_write (s, (u_char *) & p->prefix, psize);
-
-      /* Nexthop count. */
-      stream_putc (s, 1);
-
-      /* Nexthop, ifindex, distance and metric information. */
+      if (!(te->flags & EIGRP_NEIGHBOR_ENTRY_INTABLE_FLAG)
+          || te->adv_router == NULL)
+        continue;
+
       stream_putc (s, ZEBRA_NEXTHOP_IPV4_IFINDEX);
       stream_put_in_addr (s, &te->adv_router->src);
       stream_putl (s, te->ei->ifp->ifindex);
 
-      if (IS_DEBUG_EIGRP (zebra, ZEBRA_REDISTRIBUTE))
-        {
-          char buf[2][INET_ADDRSTRLEN];
-          zlog_debug ("Zebra: Route add %s/%d nexthop %s",
-		      inet_ntop(AF_INET, &p->prefix, buf[0], sizeof (buf[0])),
-		      p->prefixlen,
-		      inet_ntop(AF_INET, 0 /*&p->nexthop*/, buf[1], sizeof (buf[1])));
-        }
-
-      stream_putl (s, te->distance);
-      stream_putw_at (s, 0, stream_get_endp (s));
+      if (++count == eigrp->max_paths)
+        break;
+    }
+  stream_putc_at (s, count_at, count);
 
-      zclient_send_message (zclient);
+  if (IS_DEBUG_EIGRP (zebra, ZEBRA_REDISTRIBUTE))
+    {
+      char buf[INET_ADDRSTRLEN];
+      zlog_debug ("Zebra: Route add %s/%d nexthops %u",
+                  inet_ntop(AF_INET, &p->prefix, buf, sizeof (buf)),
+                  p->prefixlen, count);
     }
+
+  stream_putl (s, pe->distance);
+  stream_putw_at (s, 0, stream_get_endp (s));
+
+  zclient_send_message (zclient);
 }
 
-void
-eigrp_zebra_route_delete (struct prefix_ipv4 *p, struct eigrp_neighbor_entry *te)
+/* Withdraw the EIGRP route for prefix, with all of its nexthops. */
+static void
+eigrp_zebra_route_delete (struct prefix_ipv4 *p)
 {
   u_char message;
   u_char flags;
   int psize;
   struct stream *s;
 
-  if (zclient->redist[ZEBRA_ROUTE_EIGRP])
+  message = 0;
+  flags = 0;
+  /* Make packet. */
+  s = zclient->obuf;
+  stream_reset (s);
+
+  /* Put command, type, flags, message. */
+  zclient_create_header (s, ZEBRA_IPV4_ROUTE_DELETE);
+  stream_putc (s, ZEBRA_ROUTE_EIGRP);
+  stream_putc (s, flags);
+  stream_putc (s, message);
+  stream_putw (s, SAFI_UNICAST);
+
+  /* Put prefix information. */
+  psize = PSIZE (p->prefixlen);
+  stream_putc (s, p->prefixlen);
+  stream_write (s, (u_char *) & p->prefix, psize);
+
+  if (IS_DEBUG_EIGRP (zebra, ZEBRA_REDISTRIBUTE))
     {
-      message = 0;
-      flags = 0;
-      /* Make packet. */
-      s = zclient->obuf;
-      stream_reset (s);
-
-      /* Put command, type, flags, message. */
-      zclient_create_header (s, ZEBRA_IPV4_ROUTE_DELETE);
-      stream_putc (s, ZEBRA_ROUTE_EIGRP);
-      stream_putc (s, flags);
-      stream_putc (s, message);
-      stream_putw (s, SAFI_UNICAST);
-
-      /* Put prefix information. */
-      psize = PSIZE (p->prefixlen);
-      stream_putc (s, p->prefixlen);
-      stream_write (s, (u_char *) & p->prefix, psize);
-
-      /* Nexthop count. */
-      stream_putc (s, 1);
-
-      /* Nexthop, ifindex, distance and metric information. */
-      stream_putc (s, ZEBRA_NEXTHOP_IPV4_IFINDEX);
-      stream_put_in_addr (s, &te->adv_router->src);
-      stream_putl (s, te->ei->ifp->ifindex);
+      char buf[INET_ADDRSTRLEN];
+      zlog_debug ("Zebra: Route del %s/%d",
+                  inet_ntop (AF_INET, &p->prefix, buf, sizeof (buf)),
+                  p->prefixlen);
+    }
 
-      if (IS_DEBUG_EIGRP (zebra, ZEBRA_REDISTRIBUTE))
+  stream_putw_at (s, 0, stream_get_endp (s));
+
+  zclient_send_message (zclient);
+}
+
+/*
+ * Send queued prefixes to zebra, each with its current successor set in
+ * one message, or withdrawn when it has none left (or is gone).
+ */
+static int
+eigrp_zebra_route_flush (struct thread *thread)
+{
+  struct eigrp *eigrp = THREAD_ARG (thread);
+  struct eigrp_prefix_entry *pe;
+  struct prefix_ipv4 *p;
+  struct listnode *node;
+  struct eigrp_neighbor_entry *te;
+  int installed;
+  u_int32_t count = 0;
+
+  eigrp->t_zebra_flush = NULL;
+
+  while ((p = listnode_head (eigrp->zebra_route_queue)) != NULL)
+    {
+      list_delete_node (eigrp->zebra_route_queue,
+                        listhead (eigrp->zebra_route_queue));
+
+      pe = eigrp_topology_table_lookup_ipv4 (eigrp->topology_table, p);
+      installed = 0;
+      if (pe)
         {
-          char buf[2][INET_ADDRSTRLEN];
-          zlog_debug ("Zebra: Route del %s/%d nexthop %s",
-		      inet_ntop (AF_INET, &p->prefix,  buf[0], sizeof (buf[0])),
-		      p->prefixlen,
-		      inet_ntop (AF_INET, 0 /*&p->nexthop*/, buf[1], sizeof (buf[1])));
+          pe->zebra_queued = 0;
+          for (ALL_LIST_ELEMENTS_RO (pe->entries, node, te))
+            if (te->flags & EIGRP_NEIGHBOR_ENTRY_INTABLE_FLAG)
+              {
+                installed = 1;
+                break;
+              }
         }
 
-
-      if (CHECK_FLAG (message, ZAPI_MESSAGE_METRIC))
+      if (zclient->redist[ZEBRA_ROUTE_EIGRP])
         {
-          stream_putl (s, te->distance);
+          if (installed)
+            eigrp_zebra_route_add (eigrp, pe);
+          else
+            eigrp_zebra_route_delete (p);
         }
 
-      stream_putw_at (s, 0, stream_get_endp (s));
+      prefix_ipv4_free (p);
+      count++;
+    }
+
+  eigrp_histogram_add (&eigrp->stats.zebra_batch, count);
+  eigrp_histogram_add (&eigrp->stats.zebra_latency,
+                       eigrp_stats_elapsed (&eigrp->stats.zebra_queued));
+
+  return 0;
+}
+
+/*
+ * Queue prefix for (re)installation into zebra.  The queue is sent once
+ * all events of the current thread loop round have been processed, so a
+ * prefix changed several times by one convergence is sent only once.
+ */
+void
+eigrp_zebra_route_update (struct eigrp *eigrp, struct eigrp_prefix_entry *pe)
+{
+  struct prefix_ipv4 *p;
 
-      zclient_send_message (zclient);
+  if (pe->zebra_queued)
+    return;
+
+  p = prefix_ipv4_new ();
+  *p = *pe->destination_ipv4;
+  listnode_add (eigrp->zebra_route_queue, p);
+  pe->zebra_queued = 1;
+
+  if (eigrp->t_zebra_flush == NULL)
+    {
+      quagga_gettime (QUAGGA_CLK_MONOTONIC, &eigrp->stats.zebra_queued);
+      eigrp->t_zebra_flush =
+        thread_add_event (master, eigrp_zebra_route_flush, eigrp, 0);
     }
 }
 
+/* Drop routes still waiting in the queue, used at shutdown. */
+void
+eigrp_zebra_route_queue_free (struct eigrp *eigrp)
+{
+  struct prefix_ipv4 *p;
+  struct listnode *node, *nnode;
+
+  THREAD_OFF (eigrp->t_zebra_flush);
+
+  for (ALL_LIST_ELEMENTS (eigrp->zebra_route_queue, node, nnode, p))
+    prefix_ipv4_free (p);
+  list_delete (eigrp->zebra_route_queue);
+}
+
 int
 eigrp_is_type_redistributed (int type)
 {
@@ -530,17 +635,13 @@ eigrp_redistribute_set (struct eigrp *eigrp, int type, struct eigrp_metrics metr
 
   if (eigrp_is_type_redistributed (type))
     {
-      if (eigrp_metrics_is_same(&metric, &eigrp->dmetric[type]))
-        {
-          eigrp->dmetric[type] = metric;
-        }
+      eigrp->dmetric[type] = metric;
 
+      /* only the routes the new metric changes are sent again */
       eigrp_external_routes_refresh (eigrp, type);
 
-//      if (IS_DEBUG_EIGRP(zebra, ZEBRA_REDISTRIBUTE))
-//        zlog_debug ("Redistribute[%s]: Refresh  Type[%d], Metric[%d]",
-//                   eigrp_redist_string(type),
-//                   metric_type (eigrp, type), metric_value (eigrp, type));
+      if (IS_DEBUG_EIGRP (zebra, ZEBRA_REDISTRIBUTE))
+        zlog_debug ("Redistribute[%s]: Refresh", zebra_route_string (type));
       return CMD_SUCCESS;
     }
 
@@ -548,10 +649,8 @@ eigrp_redistribute_set (struct eigrp *eigrp, int type, struct eigrp_metrics metr
 
   zclient_redistribute (ZEBRA_REDISTRIBUTE_ADD, zclient, type);
 
-//  if (IS_DEBUG_EIGRP (zebra, ZEBRA_REDISTRIBUTE))
-//    zlog_debug ("Redistribute[%s]: Start  Type[%d], Metric[%d]",
-//               ospf_redist_string(type),
-//               metric_type (ospf, type), metric_value (ospf, type));
+  if (IS_DEBUG_EIGRP (zebra, ZEBRA_REDISTRIBUTE))
+    zlog_debug ("Redistribute[%s]: Start", zebra_route_string (type));
 
   ++eigrp->redistribute;
 
@@ -567,12 +666,13 @@ eigrp_redistribute_unset (struct eigrp *eigrp, int type)
       memset(&eigrp->dmetric[type], 0, sizeof(struct eigrp_metrics));
       zclient_redistribute (ZEBRA_REDISTRIBUTE_DELETE, zclient, type);
       --eigrp->redistribute;
-    }
 
-//  if (IS_DEBUG_EIGRP (zebra, ZEBRA_REDISTRIBUTE))
-//    zlog_debug ("Redistribute[%s]: Start  Type[%d], Metric[%d]",
-//               ospf_redist_string(type),
-//               metric_type (ospf, type), metric_value (ospf, type));
+      /* zebra does not withdraw what it has sent us */
+      eigrp_external_type_clear (eigrp, type);
+
+      if (IS_DEBUG_EIGRP (zebra, ZEBRA_REDISTRIBUTE))
+        zlog_debug ("Redistribute[%s]: Stop", zebra_route_string (type));
+    }
 
   return CMD_SUCCESS;
 }
@@ -53,6 +53,8 @@
 #include "eigrpd/eigrp_packet.h"
 #include "eigrpd/eigrp_network.h"
 #include "eigrpd/eigrp_topology.h"
+#include "eigrpd/eigrp_snmp.h"
+#include "eigrpd/eigrp_external.h"
 
 
 static struct eigrp_master eigrp_master;
@@ -61,7 +63,7 @@ struct eigrp_master *eigrp_om;
 
 static void eigrp_finish_final(struct eigrp *);
 static void eigrp_delete(struct eigrp *);
-static struct eigrp *eigrp_new(const char *);
+static struct eigrp *eigrp_new(const char *, int);
 static void eigrp_add(struct eigrp *);
 
 extern struct zclient *zclient;
@@ -133,12 +135,11 @@ eigrp_master_init ()
 }
 
 
-/* Allocate new eigrp structure. */
+/* Allocate new eigrp structure, packets are sent out on fd. */
 static struct eigrp *
-eigrp_new (const char *AS)
+eigrp_new (const char *AS, int fd)
 {
   struct eigrp *new = XCALLOC(MTYPE_EIGRP_TOP, sizeof (struct eigrp));
-  int eigrp_socket;
 
   /* init information relevant to peers */
   new->vrid = 0;
@@ -154,20 +155,15 @@ eigrp_new (const char *AS)
   new->k_values[3] = EIGRP_K4_DEFAULT;
   new->k_values[4] = EIGRP_K5_DEFAULT;
   new->k_values[5] = EIGRP_K6_DEFAULT;
+  eigrp_metric_kernel_update(new);
 
   /* init internal data structures */
   new->eiflist = list_new();
+  new->nbrs_table = route_table_init();
   new->passive_interface_default = EIGRP_IF_ACTIVE;
   new->networks = route_table_init();
 
-  if ((eigrp_socket = eigrp_sock_init()) < 0)
-    {
-      zlog_err("eigrp_new: fatal error: eigrp_sock_init was unable to open "
-               "a socket");
-      exit (1);
-    }
-
-  new->fd = eigrp_socket;
+  new->fd = fd;
   new->maxsndbuflen = getsockopt_so_sendbuf(new->fd);
 
   if ((new->ibuf = stream_new(EIGRP_PACKET_MAX_LEN+1)) == NULL)
@@ -177,10 +173,10 @@ eigrp_new (const char *AS)
       exit(1);
     }
 
-  new->t_read = thread_add_read(master, eigrp_read, new, new->fd);
   new->oi_write_q = list_new();
 
   new->topology_table = eigrp_topology_new();
+  new->topology_active = eigrp_topology_new();
 
   new->neighbor_self = eigrp_nbr_new(NULL);
   inet_aton("127.0.0.1", &new->neighbor_self->src);
@@ -190,8 +186,11 @@ eigrp_new (const char *AS)
 
   new->serno = 0;
   new->serno_last_update = 0;
+  new->serno_last_query = 0;
   new->topology_changes_externalIPV4 = list_new ();
-  new->topology_changes_internalIPV4 = list_new ();
+  new->dual_flush_delay = EIGRP_DUAL_FLUSH_DELAY_DEFAULT;
+  new->zebra_route_queue = list_new ();
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &new->stats.cleared);
 
   return new;
 }
@@ -213,10 +212,41 @@ eigrp_get (const char *AS)
 {
   struct eigrp *eigrp;
 
+  int eigrp_socket;
+
   eigrp = eigrp_lookup();
   if (eigrp == NULL)
     {
-      eigrp = eigrp_new(AS);
+      if ((eigrp_socket = eigrp_sock_init()) < 0)
+        {
+          zlog_err("eigrp_get: fatal error: eigrp_sock_init was unable to "
+                   "open a socket");
+          exit (1);
+        }
+
+      eigrp = eigrp_new(AS, eigrp_socket);
+      eigrp->t_read = thread_add_read(master, eigrp_read, eigrp, eigrp->fd);
+      eigrp_add(eigrp);
+    }
+
+  return eigrp;
+}
+
+/*
+ * Instance which is not reading from a socket of its own: received
+ * packets are handed to eigrp_packet_ingest() by the caller, output is
+ * queued for fd as usual.  Lets the receive path and DUAL run without a
+ * raw socket, e.g. for replaying captured packets.
+ */
+struct eigrp *
+eigrp_get_detached (const char *AS, int fd)
+{
+  struct eigrp *eigrp;
+
+  eigrp = eigrp_lookup();
+  if (eigrp == NULL)
+    {
+      eigrp = eigrp_new(AS, fd);
       eigrp_add(eigrp);
     }
 
@@ -265,16 +295,26 @@ eigrp_finish_final (struct eigrp *eigrp)
 
   close(eigrp->fd);
 
+  THREAD_OFF(eigrp->t_dual_flush);
+  THREAD_OFF(eigrp->rto_wheel.t_tick);
+
   if (zclient)
     zclient_free(zclient);
 
+#ifdef HAVE_SNMP
+  eigrp_snmp_finish(eigrp);
+#endif /* HAVE_SNMP */
+
   list_delete(eigrp->eiflist);
+  route_table_finish(eigrp->nbrs_table);
   list_delete(eigrp->oi_write_q);
   list_delete(eigrp->topology_changes_externalIPV4);
-  list_delete(eigrp->topology_changes_internalIPV4);
 
   eigrp_topology_cleanup(eigrp->topology_table);
   eigrp_topology_free(eigrp->topology_table);
+  eigrp_topology_free(eigrp->topology_active);
+  eigrp_zebra_route_queue_free(eigrp);
+  eigrp_external_finish(eigrp);
 
   eigrp_nbr_delete(eigrp->neighbor_self);
 
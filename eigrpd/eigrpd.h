@@ -48,6 +48,7 @@ extern struct eigrp_master *eigrp_om;
  extern void eigrp_terminate (void);
  extern void eigrp_finish (struct eigrp *);
  extern struct eigrp *eigrp_get (const char *);
+ extern struct eigrp *eigrp_get_detached (const char *, int);
  extern struct eigrp *eigrp_lookup (void);
  extern void eigrp_router_id_update (struct eigrp *);
 
@@ -156,6 +156,7 @@ static struct
 {
   const char *name;
   long alloc;
+  unsigned long total;
   unsigned long t_malloc;
   unsigned long c_malloc;
   unsigned long t_calloc;
@@ -243,6 +244,7 @@ static struct
 {
   char *name;
   long alloc;
+  unsigned long total;
 } mstat [MTYPE_MAX];
 #endif /* MEMORY_LOG */
 
@@ -251,6 +253,7 @@ static void
 alloc_inc (int type)
 {
   mstat[type].alloc++;
+  mstat[type].total++;
 }
 
 /* Decrement allocation counter. */
@@ -640,3 +643,9 @@ mtype_stats_alloc (int type)
 {
   return mstat[type].alloc;
 }
+
+unsigned long
+mtype_stats_total (int type)
+{
+  return mstat[type].total;
+}
@@ -282,12 +282,18 @@ struct memory_list memory_list_eigrp[] =
   { MTYPE_EIGRP_PREFIX_ENTRY,    "EIGRP Topology table prefix"    },
   { MTYPE_EIGRP_NEIGHBOR_ENTRY,  "EIGRP Topology table entry"     },
   { MTYPE_EIGRP_PACKET,          "EIGRP packet structure"         },
+  { MTYPE_EIGRP_PACKET_DATA,     "EIGRP packet data"              },
   { MTYPE_EIGRP_NEIGHBOR,        "EIGRP neighbor structure"       },
   { MTYPE_EIGRP_IPV4_INT_TLV,    "EIGRP Internal IPv4 TLV "       },
   { MTYPE_EIGRP_AUTH_TLV,        "EIGRP Authentication MD5 TLV"   },
   { MTYPE_EIGRP_AUTH_SHA256_TLV, "EIGRP Authentication SHA256 TLV"},
+  { MTYPE_EIGRP_AUTH_KEY,        "EIGRP Authentication key state" },
   { MTYPE_EIGRP_SEQ_TLV,         "EIGRP Sequence TLV "            },
   { MTYPE_EIGRP_FSM_MSG,         "EIGRP FSM action message"       },
+  { MTYPE_EIGRP_SUMMARY,         "EIGRP summary address"          },
+  { MTYPE_EIGRP_TOPOLOGY_CURSOR, "EIGRP topology show cursor"     },
+  { MTYPE_EIGRP_EXTERNAL,        "EIGRP redistributed route"      },
+  { MTYPE_EIGRP_IPV4_EXT_TLV,    "EIGRP External IPv4 TLV"        },
   { -1, NULL },
 };
 
@@ -204,6 +204,45 @@ vty_log_out (struct vty *vty, const char *level, const char *proto_str,
   return 0;
 }
 
+/* Drop resumable output still in progress. */
+static void
+vty_output_stop (struct vty *vty)
+{
+  if (vty->output_func == NULL)
+    return;
+
+  if (vty->output_free)
+    (*vty->output_free) (vty->output_arg);
+  vty->output_func = NULL;
+  vty->output_free = NULL;
+  vty->output_arg = NULL;
+}
+
+/* Print command output in pieces instead of all at once.  func prints the
+   next piece into the vty and returns nonzero while there is more to come.
+   On a terminal it is called again each time the output buffer has been
+   written out to the socket, so other threads run in between and the
+   buffer stays small; the prompt is printed when func is done.  Other
+   vty types get all the output at once.  free_func, if any, releases arg
+   when the output is finished or aborted. */
+void
+vty_output_start (struct vty *vty, int (*func) (struct vty *, void *),
+                  void (*free_func) (void *), void *arg)
+{
+  vty_output_stop (vty);
+
+  vty->output_func = func;
+  vty->output_free = free_func;
+  vty->output_arg = arg;
+
+  if (vty->type != VTY_TERM)
+    {
+      while ((*func) (vty, arg))
+	;
+      vty_output_stop (vty);
+    }
+}
+
 /* Output current time to the vty. */
 void
 vty_time_print (struct vty *vty, int cr)
@@ -1275,6 +1314,15 @@ vty_execute (struct vty *vty)
 
   ret = CMD_SUCCESS;
 
+  /* Typed ahead of resumable output, which has to be completed first. */
+  if (vty->output_func)
+    {
+      while ((*vty->output_func) (vty, vty->output_arg))
+	;
+      vty_output_stop (vty);
+      vty_prompt (vty);
+    }
+
   switch (vty->node)
     {
     case AUTH_NODE:
@@ -1292,7 +1340,7 @@ vty_execute (struct vty *vty)
   vty->cp = vty->length = 0;
   vty_clear_buf (vty);
 
-  if (vty->status != VTY_CLOSE )
+  if (vty->status != VTY_CLOSE && vty->output_func == NULL)
     vty_prompt (vty);
 
   return ret;
@@ -1333,6 +1381,7 @@ vty_escape_map (unsigned char c, struct vty *vty)
 static void
 vty_buffer_reset (struct vty *vty)
 {
+  vty_output_stop (vty);
   buffer_reset (vty->obuf);
   vty_prompt (vty);
   vty_redraw_line (vty);
@@ -1592,6 +1641,17 @@ vty_flush (struct thread *thread)
     case BUFFER_EMPTY:
       if (vty->status == VTY_CLOSE)
 	vty_close (vty);
+      else if (vty->output_func)
+	{
+	  /* Next piece of resumable output, or the prompt after it. */
+	  if (! (*vty->output_func) (vty, vty->output_arg))
+	    {
+	      vty_output_stop (vty);
+	      vty_prompt (vty);
+	    }
+	  vty->status = VTY_NORMAL;
+	  vty_event (VTY_WRITE, vty_sock, vty);
+	}
       else
 	{
 	  vty->status = VTY_NORMAL;
@@ -2163,6 +2223,8 @@ vty_close (struct vty *vty)
 {
   int i;
 
+  vty_output_stop (vty);
+
   /* Cancel threads.*/
   if (vty->t_read)
     thread_cancel (vty->t_read);
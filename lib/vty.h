@@ -119,6 +119,11 @@ struct vty
 
   /* What address is this vty comming from. */
   char address[SU_ADDRSTRLEN];
+
+  /* Resumable command output, see vty_output_start(). */
+  int (*output_func) (struct vty *, void *);
+  void (*output_free) (void *);
+  void *output_arg;
 };
 
 /* Integrated configuration file. */
@@ -235,6 +240,8 @@ extern void vty_terminate (void);
 extern void vty_reset (void);
 extern struct vty *vty_new (void);
 extern int vty_out (struct vty *, const char *, ...) PRINTF_ATTRIBUTE(2, 3);
+extern void vty_output_start (struct vty *, int (*) (struct vty *, void *),
+                              void (*) (void *), void *);
 extern void vty_read_config (char *, char *);
 extern void vty_time_print (struct vty *, int);
 extern void vty_serv_sock (const char *, unsigned short, const char *);
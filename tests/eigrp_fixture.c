@@ -0,0 +1,410 @@
+/*
+ * Fixture for running eigrpd's packet handlers without a network.
+ *
+ * This file is part of Quagga
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include <zebra.h>
+
+#include "thread.h"
+#include "memory.h"
+#include "linklist.h"
+#include "prefix.h"
+#include "if.h"
+#include "table.h"
+#include "stream.h"
+#include "log.h"
+#include "privs.h"
+#include "zclient.h"
+
+#include "eigrpd/eigrp_structs.h"
+#include "eigrpd/eigrpd.h"
+#include "eigrpd/eigrp_interface.h"
+#include "eigrpd/eigrp_neighbor.h"
+#include "eigrpd/eigrp_packet.h"
+#include "eigrpd/eigrp_network.h"
+
+#include "eigrp_fixture.h"
+
+/* need these to link in libeigrp */
+struct thread_master *master;
+struct zebra_privs_t eigrpd_privs =
+{
+  .user = NULL,
+  .group = NULL,
+  .vty_group = NULL,
+};
+
+struct eigrp *fixture_eigrp;
+struct stream *fixture_obuf;
+struct fixture_hooks fixture_hooks;
+struct fixture_nbr **fixture_nbrs;
+int fixture_nbr_count;
+
+static struct stream *ibuf;
+static struct fixture_pkt *queue_head, *queue_tail;
+
+/* Set up eigrpd and an instance that is not attached to the network */
+void
+fixture_init (const char *progname, int verbose)
+{
+  int fd;
+
+  zlog_default = openzlog (progname, ZLOG_EIGRP, 0, LOG_DAEMON);
+  if (verbose)
+    zlog_set_level (NULL, ZLOG_DEST_STDOUT, LOG_DEBUG);
+
+  eigrp_master_init ();
+  master = eigrp_om->master;
+  zprivs_init (&eigrpd_privs);
+  eigrp_if_init ();
+  zclient = zclient_new ();
+
+  /* output is taken off the queues, nothing is ever written to fd */
+  if ((fd = open ("/dev/null", O_WRONLY)) < 0)
+    {
+      perror ("/dev/null");
+      exit (1);
+    }
+  fixture_eigrp = eigrp_get_detached (FIXTURE_AS, fd);
+  fixture_eigrp->dual_flush_delay = 0;
+
+  ibuf = stream_new (EIGRP_PACKET_MAX_LEN + 1);
+  fixture_obuf = stream_new (EIGRP_PACKET_MAX_LEN);
+}
+
+void
+fixture_queue (struct interface *ifp, struct in_addr src, struct in_addr dst,
+               const u_char *data, size_t length, int timed)
+{
+  struct fixture_pkt *pkt;
+
+  pkt = malloc (sizeof (*pkt) + length);
+  assert (pkt);
+  pkt->next = NULL;
+  pkt->ifp = ifp;
+  pkt->src = src;
+  pkt->dst = dst;
+  pkt->timed = timed;
+  pkt->length = length;
+  memcpy (pkt->data, data, length);
+
+  if (queue_tail)
+    queue_tail->next = pkt;
+  else
+    queue_head = pkt;
+  queue_tail = pkt;
+}
+
+/* Take the queued packets away, to be put back by fixture_queue_attach */
+struct fixture_pkt *
+fixture_queue_detach (void)
+{
+  struct fixture_pkt *pkt = queue_head;
+
+  queue_head = queue_tail = NULL;
+  return pkt;
+}
+
+/* Append a list of packets to the queue */
+void
+fixture_queue_attach (struct fixture_pkt *pkt)
+{
+  if (pkt == NULL)
+    return;
+
+  if (queue_tail)
+    queue_tail->next = pkt;
+  else
+    queue_head = pkt;
+  while (pkt->next)
+    pkt = pkt->next;
+  queue_tail = pkt;
+}
+
+struct eigrp_interface *
+fixture_ei (struct interface *ifp)
+{
+  struct eigrp_interface *ei;
+  struct listnode *node;
+
+  for (ALL_LIST_ELEMENTS_RO (fixture_eigrp->eiflist, node, ei))
+    if (ei->ifp == ifp)
+      return ei;
+
+  return NULL;
+}
+
+/* eigrpd's view of the neighbor, if it knows it */
+struct eigrp_neighbor *
+fixture_nbr_eigrp (struct fixture_nbr *fn)
+{
+  struct eigrp_interface *ei = fixture_ei (fn->ifp);
+
+  return ei ? eigrp_nbr_lookup_by_addr (ei, &fn->addr) : NULL;
+}
+
+/* Start a packet from fn in obuf, the header is filled in by fixture_send */
+void
+fixture_packet_start (int opcode, struct fixture_nbr *fn, u_int32_t flags,
+                      u_int32_t ack)
+{
+  u_int32_t sequence = 0;
+
+  /* Hellos and Acks are not sequenced */
+  if (opcode != EIGRP_OPC_HELLO)
+    sequence = ++fn->sequence;
+
+  stream_reset (fixture_obuf);
+  eigrp_packet_header_init (opcode, fixture_ei (fn->ifp), fixture_obuf, flags,
+                            sequence, ack);
+}
+
+void
+fixture_send (struct fixture_nbr *fn, int multicast, int timed)
+{
+  struct eigrp_interface *ei = fixture_ei (fn->ifp);
+  struct in_addr dst;
+
+  if (multicast)
+    dst.s_addr = htonl (EIGRP_MULTICAST_ADDRESS);
+  else
+    dst = ei->address->u.prefix4;
+
+  eigrp_packet_checksum (ei, fixture_obuf, stream_get_endp (fixture_obuf));
+  fixture_queue (fn->ifp, fn->addr, dst, STREAM_DATA (fixture_obuf),
+                 stream_get_endp (fixture_obuf), timed);
+}
+
+void
+fixture_hello (struct fixture_nbr *fn)
+{
+  int i;
+
+  fixture_packet_start (EIGRP_OPC_HELLO, fn, 0, 0);
+  stream_putw (fixture_obuf, EIGRP_TLV_PARAMETER);
+  stream_putw (fixture_obuf, EIGRP_TLV_PARAMETER_LEN);
+  for (i = 0; i < 6; i++)
+    stream_putc (fixture_obuf, fixture_eigrp->k_values[i]);
+  stream_putw (fixture_obuf, 0xffff);   /* hold time, never expires here */
+  fixture_send (fn, 1, 0);
+}
+
+void
+fixture_ack (struct fixture_nbr *fn, u_int32_t ack)
+{
+  fixture_packet_start (EIGRP_OPC_HELLO, fn, 0, ack);
+  fixture_send (fn, 0, 0);
+}
+
+/* Take whatever eigrpd sent off the output queues */
+static void
+fixture_drain (void)
+{
+  struct eigrp_interface *ei;
+  struct eigrp_packet *ep;
+  struct listnode *node;
+
+  for (ALL_LIST_ELEMENTS_RO (fixture_eigrp->eiflist, node, ei))
+    {
+      if (ei->obuf == NULL)
+        continue;
+
+      while ((ep = eigrp_fifo_pop_tail (ei->obuf)) != NULL)
+        {
+          if (fixture_hooks.sent)
+            fixture_hooks.sent (ei, ep);
+          eigrp_packet_free (ep);
+        }
+      ei->on_write_q = 0;
+    }
+
+  list_delete_all_node (fixture_eigrp->oi_write_q);
+  THREAD_OFF (fixture_eigrp->t_write);
+}
+
+/* Acknowledge what eigrpd is waiting for */
+static void
+fixture_acks (void)
+{
+  struct eigrp_neighbor *nbr;
+  struct eigrp_packet *ep;
+  int i;
+
+  for (i = 0; i < fixture_nbr_count; i++)
+    {
+      struct fixture_nbr *fn = fixture_nbrs[i];
+
+      if ((nbr = fixture_nbr_eigrp (fn)) == NULL)
+        continue;
+
+      ep = eigrp_fifo_tail (nbr->retrans_queue);
+      if (ep && ep->sequence_number != fn->acked)
+        {
+          fn->acked = ep->sequence_number;
+          fixture_ack (fn, ep->sequence_number);
+        }
+      ep = eigrp_fifo_tail (nbr->multicast_queue);
+      if (ep && ep->sequence_number != fn->acked_mcast)
+        {
+          fn->acked_mcast = ep->sequence_number;
+          fixture_ack (fn, ep->sequence_number);
+        }
+    }
+}
+
+static int
+fixture_stop (struct thread *thread)
+{
+  int *done = THREAD_ARG (thread);
+
+  *done = 1;
+  return 0;
+}
+
+/* Run the events the packet scheduled, DUAL flush and zebra queue */
+static void
+fixture_events (void)
+{
+  struct thread thread;
+  int done = 0;
+
+  thread_add_event (master, fixture_stop, &done, 0);
+  while (!done && thread_fetch (master, &thread))
+    thread_call (&thread);
+}
+
+static void
+fixture_ingest (struct fixture_pkt *pkt)
+{
+  struct ip *iph;
+
+  stream_reset (ibuf);
+  iph = (struct ip *) STREAM_DATA (ibuf);
+  memset (iph, 0, sizeof (*iph));
+  iph->ip_v = IPVERSION;
+  iph->ip_hl = sizeof (struct ip) >> 2;
+  iph->ip_len = sizeof (struct ip) + pkt->length;
+  iph->ip_ttl = 2;
+  iph->ip_p = IPPROTO_EIGRPIGP;
+  iph->ip_src = pkt->src;
+  iph->ip_dst = pkt->dst;
+  stream_forward_endp (ibuf, sizeof (struct ip));
+  stream_put (ibuf, pkt->data, pkt->length);
+
+  eigrp_packet_ingest (fixture_eigrp, ibuf, pkt->ifp);
+}
+
+/* Feed the queue to eigrpd, including what it brings about */
+void
+fixture_run (void)
+{
+  struct fixture_pkt *pkt;
+
+  while ((pkt = queue_head) != NULL)
+    {
+      queue_head = pkt->next;
+      if (queue_head == NULL)
+        queue_tail = NULL;
+
+      if (fixture_hooks.ingest_begin)
+        fixture_hooks.ingest_begin (pkt);
+
+      fixture_ingest (pkt);
+      fixture_events ();
+
+      if (fixture_hooks.ingest_end)
+        fixture_hooks.ingest_end (pkt);
+
+      fixture_drain ();
+      fixture_acks ();
+      free (pkt);
+    }
+}
+
+struct interface *
+fixture_if_add (const char *name, struct prefix_ipv4 *address)
+{
+  struct interface *ifp;
+  struct prefix_ipv4 network;
+
+  ifp = if_get_by_name (name);
+  ifp->ifindex = listcount (iflist);
+  ifp->flags = IFF_UP | IFF_RUNNING | IFF_BROADCAST | IFF_MULTICAST;
+  ifp->mtu = 1500;
+  connected_add_by_prefix (ifp, (struct prefix *) address, NULL);
+
+  network = *address;
+  apply_mask_ipv4 (&network);
+  eigrp_network_set (fixture_eigrp, &network);
+
+  return ifp;
+}
+
+struct fixture_nbr *
+fixture_nbr_add (struct interface *ifp, struct in_addr addr)
+{
+  struct fixture_nbr *fn;
+
+  fixture_nbrs = realloc (fixture_nbrs,
+                          (fixture_nbr_count + 1) * sizeof (*fixture_nbrs));
+  assert (fixture_nbrs);
+  fn = calloc (1, sizeof (*fn));
+  assert (fn);
+  fn->addr = addr;
+  fn->ifp = ifp;
+  fixture_nbrs[fixture_nbr_count++] = fn;
+
+  return fn;
+}
+
+struct fixture_nbr *
+fixture_nbr_lookup (struct in_addr addr)
+{
+  int i;
+
+  for (i = 0; i < fixture_nbr_count; i++)
+    if (fixture_nbrs[i]->addr.s_addr == addr.s_addr)
+      return fixture_nbrs[i];
+
+  return NULL;
+}
+
+/*
+ * Bring all neighbors up, the usual Hello, INIT and EOT exchange.
+ * Returns the number of neighbors that are up.
+ */
+int
+fixture_adjacencies (void)
+{
+  struct eigrp_neighbor *nbr;
+  int i, up = 0;
+
+  for (i = 0; i < fixture_nbr_count; i++)
+    fixture_hello (fixture_nbrs[i]);
+  fixture_run ();
+
+  for (i = 0; i < fixture_nbr_count; i++)
+    {
+      nbr = fixture_nbr_eigrp (fixture_nbrs[i]);
+      if (nbr && nbr->state == EIGRP_NEIGHBOR_UP)
+        up++;
+    }
+
+  return up;
+}
@@ -0,0 +1,90 @@
+/*
+ * Fixture for running eigrpd's packet handlers without a network.
+ *
+ * The instance is detached from the network, interfaces and neighbors
+ * are synthesised, packets from the neighbors are queued and fed to
+ * eigrpd one at a time, and whatever eigrpd sends is taken off its
+ * output queues.  Synthetic neighbors acknowledge every reliable packet.
+ *
+ * This file is part of Quagga
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef _QUAGGA_TESTS_EIGRP_FIXTURE_H
+#define _QUAGGA_TESTS_EIGRP_FIXTURE_H
+
+#define FIXTURE_AS              "1"
+
+/* Packet waiting to be fed to eigrpd */
+struct fixture_pkt
+{
+  struct fixture_pkt *next;
+  struct interface *ifp;
+  struct in_addr src;
+  struct in_addr dst;
+  int timed;
+  size_t length;
+  u_char data[];
+};
+
+/* Synthetic neighbor */
+struct fixture_nbr
+{
+  struct in_addr addr;
+  struct interface *ifp;
+  u_int32_t sequence;           /* last one sent to eigrpd */
+  u_int32_t acked;              /* last retrans queue ack queued */
+  u_int32_t acked_mcast;        /* last multicast queue ack queued */
+  void *arg;                    /* test's own data */
+};
+
+/* Called around each packet fed to eigrpd and for each packet it sent */
+struct fixture_hooks
+{
+  void (*ingest_begin) (struct fixture_pkt *);
+  void (*ingest_end) (struct fixture_pkt *);
+  void (*sent) (struct eigrp_interface *, struct eigrp_packet *);
+};
+
+extern struct eigrp *fixture_eigrp;
+extern struct stream *fixture_obuf;
+extern struct fixture_hooks fixture_hooks;
+extern struct fixture_nbr **fixture_nbrs;
+extern int fixture_nbr_count;
+
+extern void fixture_init (const char *, int);
+extern struct interface *fixture_if_add (const char *, struct prefix_ipv4 *);
+extern struct eigrp_interface *fixture_ei (struct interface *);
+extern struct fixture_nbr *fixture_nbr_add (struct interface *, struct in_addr);
+extern struct fixture_nbr *fixture_nbr_lookup (struct in_addr);
+extern struct eigrp_neighbor *fixture_nbr_eigrp (struct fixture_nbr *);
+
+extern void fixture_queue (struct interface *, struct in_addr, struct in_addr,
+                           const u_char *, size_t, int);
+extern struct fixture_pkt *fixture_queue_detach (void);
+extern void fixture_queue_attach (struct fixture_pkt *);
+
+extern void fixture_packet_start (int, struct fixture_nbr *, u_int32_t,
+                                  u_int32_t);
+extern void fixture_send (struct fixture_nbr *, int, int);
+extern void fixture_hello (struct fixture_nbr *);
+extern void fixture_ack (struct fixture_nbr *, u_int32_t);
+
+extern void fixture_run (void);
+extern int fixture_adjacencies (void);
+
+#endif /* _QUAGGA_TESTS_EIGRP_FIXTURE_H */
@@ -0,0 +1,154 @@
+/*
+ * EIGRP conditional receive test.
+ *
+ * A neighbor announces its next multicast in a Hello, with the Sequence
+ * and Next Multicast Sequence TLVs, then sends that multicast with the
+ * CR flag set.  Unless the Hello listed our address, the Update must be
+ * applied to the topology and acknowledged; if it did, the Update must
+ * be ignored.
+ *
+ * This file is part of Quagga
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include <zebra.h>
+
+#include "thread.h"
+#include "memory.h"
+#include "linklist.h"
+#include "prefix.h"
+#include "if.h"
+#include "table.h"
+#include "stream.h"
+#include "log.h"
+
+#include "eigrpd/eigrp_structs.h"
+#include "eigrpd/eigrpd.h"
+#include "eigrpd/eigrp_interface.h"
+#include "eigrpd/eigrp_neighbor.h"
+#include "eigrpd/eigrp_packet.h"
+#include "eigrpd/eigrp_topology.h"
+
+#include "eigrp_fixture.h"
+
+static struct fixture_nbr *peer;
+static u_int32_t acked;         /* last ack eigrpd sent to peer */
+
+static void
+test_sent (struct eigrp_interface *ei, struct eigrp_packet *ep)
+{
+  struct eigrp_header *eigrph = (struct eigrp_header *) STREAM_DATA (ep->s);
+
+  if (eigrph->opcode == EIGRP_OPC_HELLO && eigrph->ack
+      && ep->dst.s_addr == peer->addr.s_addr)
+    acked = ntohl (eigrph->ack);
+}
+
+/* Hello announcing the multicast with the given sequence number */
+static void
+test_cr_hello (struct in_addr *excluded, u_int32_t sequence)
+{
+  int i;
+
+  fixture_packet_start (EIGRP_OPC_HELLO, peer, 0, 0);
+  stream_putw (fixture_obuf, EIGRP_TLV_PARAMETER);
+  stream_putw (fixture_obuf, EIGRP_TLV_PARAMETER_LEN);
+  for (i = 0; i < 6; i++)
+    stream_putc (fixture_obuf, fixture_eigrp->k_values[i]);
+  stream_putw (fixture_obuf, 0xffff);
+
+  stream_putw (fixture_obuf, EIGRP_TLV_SEQ);
+  stream_putw (fixture_obuf, EIGRP_TLV_SEQ_BASE_LEN + 1 + IPV4_MAX_BYTELEN);
+  stream_putc (fixture_obuf, IPV4_MAX_BYTELEN);
+  stream_put_ipv4 (fixture_obuf, excluded->s_addr);
+
+  stream_putw (fixture_obuf, EIGRP_TLV_NEXT_MCAST_SEQ);
+  stream_putw (fixture_obuf, EIGRP_NEXT_SEQUENCE_TLV_SIZE);
+  stream_putl (fixture_obuf, sequence);
+  fixture_send (peer, 1, 0);
+}
+
+/* CR multicast Update for p, returns its sequence number */
+static u_int32_t
+test_cr_update (struct prefix_ipv4 *p)
+{
+  struct eigrp_metrics metric;
+
+  memset (&metric, 0, sizeof (metric));
+  metric.delay = 0x100000;
+  metric.bandwith = eigrp_bandwidth_to_scaled (EIGRP_BANDWIDTH_DEFAULT);
+  metric.mtu[0] = 0xDC;
+  metric.mtu[1] = 0x05;
+  metric.hop_count = 1;
+  metric.reliability = 255;
+  metric.load = 1;
+
+  fixture_packet_start (EIGRP_OPC_UPDATE, peer, EIGRP_CR_FLAG, 0);
+  eigrp_add_ipv4_tlv_to_stream (fixture_obuf, p, &metric);
+  fixture_send (peer, 1, 0);
+
+  return peer->sequence;
+}
+
+static int
+test_learned (struct prefix_ipv4 *p)
+{
+  struct eigrp_prefix_entry *pe;
+
+  pe = eigrp_topology_table_lookup_ipv4 (fixture_eigrp->topology_table, p);
+  return pe && pe->entries && listcount (pe->entries) > 0;
+}
+
+int
+main (int argc, char **argv)
+{
+  struct prefix_ipv4 address, p;
+  struct in_addr addr, other;
+  struct interface *ifp;
+  u_int32_t sequence;
+
+  fixture_init ("testeigrpcr", argc > 1 && !strcmp (argv[1], "-v"));
+  fixture_hooks.sent = test_sent;
+
+  str2prefix_ipv4 ("10.0.0.1/24", &address);
+  ifp = fixture_if_add ("cr0", &address);
+  inet_aton ("10.0.0.2", &addr);
+  inet_aton ("10.0.0.3", &other);
+  peer = fixture_nbr_add (ifp, addr);
+
+  assert (fixture_adjacencies () == 1);
+
+  /* someone else is excluded, the Update is ours */
+  str2prefix_ipv4 ("192.0.2.0/24", &p);
+  test_cr_hello (&other, peer->sequence + 1);
+  sequence = test_cr_update (&p);
+  fixture_run ();
+  assert (test_learned (&p));
+  assert (acked == sequence);
+  printf ("CR Update applied and acked.\n");
+
+  /* we are excluded, the Update is to be ignored */
+  str2prefix_ipv4 ("198.51.100.0/24", &p);
+  test_cr_hello (&address.prefix, peer->sequence + 1);
+  sequence = test_cr_update (&p);
+  fixture_run ();
+  assert (!test_learned (&p));
+  assert (acked != sequence);
+  printf ("CR Update of an excluded neighbor ignored.\n");
+
+  return 0;
+}
@@ -0,0 +1,674 @@
+/*
+ * EIGRP receive path and DUAL benchmark.
+ *
+ * Feeds Update, Query and Reply packets through the real eigrpd packet
+ * handlers, without raw sockets or peers, see eigrp_fixture.h.  The
+ * synthetic neighbors also answer Queries, so DUAL runs through its
+ * active and passive states as it would with live peers.
+ *
+ * The packets are either generated (the default), or replayed from a
+ * pcap capture file given on the command line.
+ *
+ * Reports per opcode latency percentiles, routes processed per second
+ * and allocations done by eigrpd while processing the packets.
+ *
+ * This file is part of Quagga
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include <zebra.h>
+
+#include "thread.h"
+#include "memory.h"
+#include "linklist.h"
+#include "prefix.h"
+#include "if.h"
+#include "table.h"
+#include "stream.h"
+#include "log.h"
+
+#include "eigrpd/eigrp_structs.h"
+#include "eigrpd/eigrpd.h"
+#include "eigrpd/eigrp_interface.h"
+#include "eigrpd/eigrp_neighbor.h"
+#include "eigrpd/eigrp_packet.h"
+#include "eigrpd/eigrp_network.h"
+
+#include "eigrp_fixture.h"
+
+#define BENCH_PREFIX_BASE       0x10000000      /* 16.0.0.0, /24s */
+#define BENCH_DELAY_STEP        0x100000        /* > interface delay */
+#define BENCH_OPCODE_MAX        16
+
+/* What a generated neighbor advertises, its fixture_nbr's arg */
+struct bench_nbr
+{
+  u_int32_t delay;              /* advertised delay */
+  u_char *withdrawn;            /* per generated prefix */
+};
+
+struct bench_stat
+{
+  unsigned long packets;
+  unsigned long routes;
+  unsigned long allocs;
+  unsigned long sent;
+  double *usec;
+  size_t size;
+};
+
+static struct bench_stat stats[BENCH_OPCODE_MAX];
+
+static int prefix_count = 10000;
+static int route_per_pkt = 40;
+static int replay;
+
+/* measurement of the packet being ingested */
+static struct timeval pkt_start;
+static unsigned long pkt_allocs;
+static int pkt_routes;
+
+static const char *opcode_name[BENCH_OPCODE_MAX] =
+{
+  [EIGRP_OPC_UPDATE]   = "Update",
+  [EIGRP_OPC_REQUEST]  = "Request",
+  [EIGRP_OPC_QUERY]    = "Query",
+  [EIGRP_OPC_REPLY]    = "Reply",
+  [EIGRP_OPC_HELLO]    = "Hello",
+  [EIGRP_OPC_PROBE]    = "Probe",
+  [EIGRP_OPC_SIAQUERY] = "SIA-Query",
+  [EIGRP_OPC_SIAREPLY] = "SIA-Reply",
+};
+
+static void
+usage (const char *progname)
+{
+  printf ("Usage: %s [OPTION...] [CAPTURE]\n\n"
+          "Without CAPTURE, generated packets are used:\n"
+          "  -i NUM    interfaces (default 2)\n"
+          "  -n NUM    neighbors (default 4)\n"
+          "  -p NUM    prefixes each neighbor advertises (default 10000)\n"
+          "  -r NUM    withdraw/restore rounds (default 3)\n"
+          "  -t NUM    routes per packet (default 40)\n"
+          "CAPTURE is a pcap file, its EIGRP packets are replayed:\n"
+          "  -l A.B.C.D/M  local address (default .254 of the first\n"
+          "                source's /24)\n"
+          "  -v        log eigrpd debug output to stdout\n",
+          progname);
+  exit (1);
+}
+
+static unsigned long
+bench_allocs (void)
+{
+  unsigned long total = 0;
+  int type;
+
+  for (type = 0; type < MTYPE_MAX; type++)
+    total += mtype_stats_total (type);
+
+  return total;
+}
+
+static double
+bench_usec (struct timeval *start, struct timeval *stop)
+{
+  return (stop->tv_sec - start->tv_sec) * 1000000.0
+         + (stop->tv_usec - start->tv_usec);
+}
+
+static void
+bench_prefix (int index, struct prefix_ipv4 *p)
+{
+  memset (p, 0, sizeof (*p));
+  p->family = AF_INET;
+  p->prefixlen = 24;
+  p->prefix.s_addr = htonl (BENCH_PREFIX_BASE + ((u_int32_t) index << 8));
+}
+
+static int
+bench_prefix_index (struct prefix_ipv4 *p)
+{
+  u_int32_t addr = ntohl (p->prefix.s_addr);
+
+  if (p->prefixlen != 24 || addr < BENCH_PREFIX_BASE)
+    return -1;
+  addr = (addr - BENCH_PREFIX_BASE) >> 8;
+  if (addr >= (u_int32_t) prefix_count)
+    return -1;
+
+  return addr;
+}
+
+static void
+bench_metric (struct fixture_nbr *fn, int index, struct eigrp_metrics *metric)
+{
+  struct bench_nbr *bn = fn->arg;
+
+  memset (metric, 0, sizeof (*metric));
+  if (index < 0 || bn->withdrawn[index])
+    metric->delay = EIGRP_MAX_METRIC;
+  else
+    metric->delay = bn->delay;
+  metric->bandwith = eigrp_bandwidth_to_scaled (EIGRP_BANDWIDTH_DEFAULT);
+  metric->mtu[0] = 0xDC;
+  metric->mtu[1] = 0x05;
+  metric->hop_count = 1;
+  metric->reliability = 255;
+  metric->load = 1;
+}
+
+/* Advertise prefixes [first, first + count) from fn in packets of opcode */
+static void
+bench_routes (struct fixture_nbr *fn, int opcode, int first, int count)
+{
+  struct prefix_ipv4 p;
+  struct eigrp_metrics metric;
+  int index, in_pkt = 0;
+
+  for (index = first; index < first + count; index++)
+    {
+      if (in_pkt == 0)
+        fixture_packet_start (opcode, fn, 0, 0);
+
+      bench_prefix (index, &p);
+      bench_metric (fn, index, &metric);
+      eigrp_add_ipv4_tlv_to_stream (fixture_obuf, &p, &metric);
+
+      if (++in_pkt == route_per_pkt)
+        {
+          fixture_send (fn, 1, 1);
+          in_pkt = 0;
+        }
+    }
+  if (in_pkt)
+    fixture_send (fn, 1, 1);
+}
+
+/* Every neighbor the Query was sent to answers it with its own view */
+static void
+bench_answer_query (struct eigrp_interface *ei, struct eigrp_packet *ep)
+{
+  struct stream *s;
+  struct eigrp_route_tlv route;
+  struct eigrp_metrics metric;
+  int i, multicast;
+
+  s = stream_new (ep->length);
+  stream_put (s, STREAM_DATA (ep->s), ep->length);
+  multicast = (ep->dst.s_addr == htonl (EIGRP_MULTICAST_ADDRESS));
+
+  for (i = 0; i < fixture_nbr_count; i++)
+    {
+      struct fixture_nbr *fn = fixture_nbrs[i];
+
+      if (fn->ifp != ei->ifp)
+        continue;
+      if (!multicast && fn->addr.s_addr != ep->dst.s_addr)
+        continue;
+
+      fixture_packet_start (EIGRP_OPC_REPLY, fn, 0, 0);
+      stream_set_getp (s, EIGRP_HEADER_LEN);
+      while (eigrp_tlv_route_next (s, &route))
+        {
+          bench_metric (fn, bench_prefix_index (&route.prefix), &metric);
+          eigrp_add_ipv4_tlv_to_stream (fixture_obuf, &route.prefix, &metric);
+        }
+      fixture_send (fn, 0, 1);
+    }
+
+  stream_free (s);
+}
+
+/* Count what eigrpd sent, the generated neighbors answer its Queries */
+static void
+bench_sent (struct eigrp_interface *ei, struct eigrp_packet *ep)
+{
+  struct eigrp_header *eigrph = (struct eigrp_header *) STREAM_DATA (ep->s);
+
+  if (eigrph->opcode < BENCH_OPCODE_MAX)
+    stats[eigrph->opcode].sent++;
+  if (!replay && eigrph->opcode == EIGRP_OPC_QUERY)
+    bench_answer_query (ei, ep);
+}
+
+static void
+bench_record (int opcode, int routes, double usec, unsigned long allocs)
+{
+  struct bench_stat *st = &stats[opcode];
+
+  if (st->packets == st->size)
+    {
+      st->size = st->size ? st->size * 2 : 1024;
+      st->usec = realloc (st->usec, st->size * sizeof (double));
+      assert (st->usec);
+    }
+  st->usec[st->packets++] = usec;
+  st->routes += routes;
+  st->allocs += allocs;
+}
+
+static int
+bench_route_count (struct fixture_pkt *pkt)
+{
+  struct stream *s;
+  struct eigrp_route_tlv route;
+  int count = 0;
+
+  if (pkt->length < EIGRP_HEADER_LEN)
+    return 0;
+
+  s = stream_new (pkt->length);
+  stream_put (s, pkt->data, pkt->length);
+  stream_set_getp (s, EIGRP_HEADER_LEN);
+  while (eigrp_tlv_route_next (s, &route))
+    count++;
+  stream_free (s);
+
+  return count;
+}
+
+/* Time the packet, including the events it scheduled */
+static void
+bench_ingest_begin (struct fixture_pkt *pkt)
+{
+  int opcode = pkt->length ? pkt->data[1] : 0;
+
+  if (opcode >= BENCH_OPCODE_MAX)
+    pkt->timed = 0;
+  if (!pkt->timed)
+    return;
+
+  pkt_routes = bench_route_count (pkt);
+  pkt_allocs = bench_allocs ();
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &pkt_start);
+}
+
+static void
+bench_ingest_end (struct fixture_pkt *pkt)
+{
+  struct timeval stop;
+
+  if (!pkt->timed)
+    return;
+
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &stop);
+  bench_record (pkt->data[1], pkt_routes, bench_usec (&pkt_start, &stop),
+                bench_allocs () - pkt_allocs);
+}
+
+static struct fixture_nbr *
+bench_nbr_add (struct interface *ifp, struct in_addr addr)
+{
+  struct fixture_nbr *fn;
+  struct bench_nbr *bn;
+
+  fn = fixture_nbr_add (ifp, addr);
+  bn = calloc (1, sizeof (*bn));
+  assert (bn);
+  bn->delay = fixture_nbr_count * BENCH_DELAY_STEP;
+  bn->withdrawn = calloc (prefix_count ? prefix_count : 1, 1);
+  assert (bn->withdrawn);
+  fn->arg = bn;
+
+  return fn;
+}
+
+static void
+bench_adjacencies (void)
+{
+  int up = fixture_adjacencies ();
+
+  if (up != fixture_nbr_count)
+    printf ("warning: only %d of %d neighbors came up\n", up,
+            fixture_nbr_count);
+}
+
+static void
+bench_withdraw (struct fixture_nbr *fn, int opcode, int withdrawn)
+{
+  struct bench_nbr *bn = fn->arg;
+
+  memset (bn->withdrawn, withdrawn, prefix_count);
+  bench_routes (fn, opcode, 0, prefix_count);
+  fixture_run ();
+}
+
+static void
+bench_generated (int if_count, int nbr_want, int rounds)
+{
+  struct prefix_ipv4 address;
+  struct in_addr addr;
+  char name[INTERFACE_NAMSIZ];
+  int i, r;
+
+  /* interface <i> is 10.0.<i>.1/24 */
+  for (i = 0; i < if_count; i++)
+    {
+      snprintf (name, sizeof (name), "bench%d", i);
+      address.family = AF_INET;
+      address.prefixlen = 24;
+      address.prefix.s_addr = htonl (0x0a000001 + ((u_int32_t) i << 8));
+      fixture_if_add (name, &address);
+    }
+
+  /* neighbors are spread over the interfaces, 10.0.<if>.<2 + n> */
+  for (i = 0; i < nbr_want; i++)
+    {
+      addr.s_addr = htonl (0x0a000002 + ((i % if_count) << 8) + i / if_count);
+      snprintf (name, sizeof (name), "bench%d", i % if_count);
+      bench_nbr_add (if_lookup_by_name (name), addr);
+    }
+
+  bench_adjacencies ();
+
+  /* initial load, every neighbor advertises every prefix */
+  for (i = 0; i < fixture_nbr_count; i++)
+    bench_routes (fixture_nbrs[i], EIGRP_OPC_UPDATE, 0, prefix_count);
+  fixture_run ();
+
+  for (r = 0; r < rounds; r++)
+    {
+      /* successor goes away: no feasible successor, all prefixes go
+       * active and are queried from the others */
+      bench_withdraw (fixture_nbrs[0], EIGRP_OPC_UPDATE, 1);
+      bench_withdraw (fixture_nbrs[0], EIGRP_OPC_UPDATE, 0);
+
+      /* a non-successor loses its routes and queries us */
+      if (fixture_nbr_count > 1)
+        {
+          bench_withdraw (fixture_nbrs[fixture_nbr_count - 1],
+                          EIGRP_OPC_QUERY, 1);
+          bench_withdraw (fixture_nbrs[fixture_nbr_count - 1],
+                          EIGRP_OPC_UPDATE, 0);
+        }
+    }
+}
+
+/*
+ * Minimal pcap reader, for Ethernet, raw IP and Linux cooked captures.
+ * Returns the number of EIGRP packets queued, -1 on error.
+ */
+static int
+bench_pcap_load (const char *file, const char *local)
+{
+  FILE *fp;
+  u_int32_t hdr[6], rec[4];
+  u_int32_t magic, linktype, caplen;
+  u_char *frame = NULL;
+  size_t offset;
+  int swap, count = 0;
+  struct prefix_ipv4 address;
+  struct interface *ifp = NULL;
+  struct ip *iph;
+
+#define PCAP32(v) (swap ? (u_int32_t) (((v) >> 24) | (((v) >> 8) & 0xff00) \
+                   | (((v) << 8) & 0xff0000) | ((v) << 24)) : (v))
+
+  if ((fp = fopen (file, "r")) == NULL)
+    {
+      perror (file);
+      return -1;
+    }
+  if (fread (hdr, sizeof (hdr), 1, fp) != 1)
+    goto bad;
+
+  magic = hdr[0];
+  if (magic == 0xa1b2c3d4 || magic == 0xa1b23c4d)
+    swap = 0;
+  else if (magic == 0xd4c3b2a1 || magic == 0x4d3cb2a1)
+    swap = 1;
+  else
+    goto bad;
+  linktype = PCAP32 (hdr[5]);
+
+  if (linktype == 1)            /* Ethernet */
+    offset = 14;
+  else if (linktype == 101 || linktype == 12 || linktype == 14) /* raw IP */
+    offset = 0;
+  else if (linktype == 113)     /* Linux cooked */
+    offset = 16;
+  else
+    {
+      fprintf (stderr, "%s: unsupported link type %u\n", file, linktype);
+      fclose (fp);
+      return -1;
+    }
+
+  frame = malloc (EIGRP_PACKET_MAX_LEN + offset);
+  assert (frame);
+
+  while (fread (rec, sizeof (rec), 1, fp) == 1)
+    {
+      caplen = PCAP32 (rec[2]);
+      if (caplen > EIGRP_PACKET_MAX_LEN + offset)
+        goto bad;
+      if (fread (frame, caplen, 1, fp) != 1)
+        break;
+
+      /* VLAN tagged Ethernet */
+      if (linktype == 1 && caplen >= 18 && frame[12] == 0x81 && frame[13] == 0)
+        memmove (frame + 12, frame + 16, caplen -= 4);
+
+      if (caplen < offset + sizeof (struct ip))
+        continue;
+      iph = (struct ip *) (frame + offset);
+      if (iph->ip_v != IPVERSION || iph->ip_p != IPPROTO_EIGRPIGP
+          || caplen < offset + ntohs (iph->ip_len)
+          || ntohs (iph->ip_len) < (iph->ip_hl << 2) + EIGRP_HEADER_LEN)
+        continue;
+
+      if (ifp == NULL)
+        {
+          if (local)
+            {
+              if (!str2prefix_ipv4 (local, &address))
+                {
+                  fprintf (stderr, "malformed local address %s\n", local);
+                  exit (1);
+                }
+            }
+          else
+            {
+              address.family = AF_INET;
+              address.prefixlen = 24;
+              address.prefix.s_addr = htonl ((ntohl (iph->ip_src.s_addr)
+                                              & 0xffffff00) | 254);
+            }
+          ifp = fixture_if_add ("replay0", &address);
+        }
+
+      if (iph->ip_src.s_addr == address.prefix.s_addr)
+        {
+          fprintf (stderr, "%s is a source in the capture, pick another "
+                   "local address with -l\n", inet_ntoa (address.prefix));
+          exit (1);
+        }
+      if (!fixture_nbr_lookup (iph->ip_src))
+        bench_nbr_add (ifp, iph->ip_src);
+
+      fixture_queue (ifp, iph->ip_src, iph->ip_dst,
+                     (u_char *) iph + (iph->ip_hl << 2),
+                     ntohs (iph->ip_len) - (iph->ip_hl << 2), 1);
+      count++;
+    }
+
+  free (frame);
+  fclose (fp);
+  return count;
+
+bad:
+  fprintf (stderr, "%s: not a pcap file or truncated\n", file);
+  free (frame);
+  fclose (fp);
+  return -1;
+#undef PCAP32
+}
+
+static void
+bench_replay (const char *file, const char *local)
+{
+  struct fixture_pkt *capture;
+  int count;
+
+  if ((count = bench_pcap_load (file, local)) <= 0)
+    {
+      if (count == 0)
+        fprintf (stderr, "%s: no EIGRP packets\n", file);
+      exit (1);
+    }
+
+  /* adjacencies first, the capture's own acks are for someone else */
+  capture = fixture_queue_detach ();
+  bench_adjacencies ();
+
+  fixture_queue_attach (capture);
+  fixture_run ();
+}
+
+static int
+bench_double_cmp (const void *a, const void *b)
+{
+  double da = *(const double *) a, db = *(const double *) b;
+
+  return (da > db) - (da < db);
+}
+
+static double
+bench_percentile (struct bench_stat *st, double q)
+{
+  return st->usec[(size_t) (q * (st->packets - 1) + 0.5)];
+}
+
+static void
+bench_report (double wall)
+{
+  struct bench_stat *st;
+  unsigned long packets = 0, routes = 0, allocs = 0;
+  double usec = 0;
+  size_t i;
+  int opcode;
+
+  printf ("%-10s %8s %9s %9s %9s %9s %9s %10s %8s\n", "opcode", "packets",
+          "routes", "p50(us)", "p90(us)", "p99(us)", "max(us)", "allocs/pkt",
+          "sent");
+
+  for (opcode = 0; opcode < BENCH_OPCODE_MAX; opcode++)
+    {
+      st = &stats[opcode];
+      if (st->packets == 0)
+        {
+          if (st->sent && opcode_name[opcode])
+            printf ("%-10s %8s %9s %9s %9s %9s %9s %10s %8lu\n",
+                    opcode_name[opcode], "-", "-", "-", "-", "-", "-", "-",
+                    st->sent);
+          continue;
+        }
+
+      qsort (st->usec, st->packets, sizeof (double), bench_double_cmp);
+      for (i = 0; i < st->packets; i++)
+        usec += st->usec[i];
+
+      printf ("%-10s %8lu %9lu %9.1f %9.1f %9.1f %9.1f %10.1f %8lu\n",
+              opcode_name[opcode] ? opcode_name[opcode] : "?",
+              st->packets, st->routes, bench_percentile (st, 0.50),
+              bench_percentile (st, 0.90), bench_percentile (st, 0.99),
+              st->usec[st->packets - 1],
+              (double) st->allocs / st->packets, st->sent);
+
+      packets += st->packets;
+      routes += st->routes;
+      allocs += st->allocs;
+    }
+
+  printf ("\n%lu packets, %lu routes in %.3f s (%.3f s wall)\n",
+          packets, routes, usec / 1000000, wall / 1000000);
+  if (usec > 0)
+    printf ("%.0f prefixes/sec, %lu allocations (%.1f per route)\n",
+            routes / (usec / 1000000), allocs,
+            routes ? (double) allocs / routes : 0.0);
+}
+
+int
+main (int argc, char **argv)
+{
+  const char *local = NULL;
+  struct timeval start, stop;
+  int if_count = 2, nbr_want = 4, rounds = 3, verbose = 0;
+  int opt;
+
+  while ((opt = getopt (argc, argv, "i:n:p:r:t:l:vh")) != -1)
+    {
+      switch (opt)
+        {
+        case 'i':
+          if_count = atoi (optarg);
+          break;
+        case 'n':
+          nbr_want = atoi (optarg);
+          break;
+        case 'p':
+          prefix_count = atoi (optarg);
+          break;
+        case 'r':
+          rounds = atoi (optarg);
+          break;
+        case 't':
+          route_per_pkt = atoi (optarg);
+          break;
+        case 'l':
+          local = optarg;
+          break;
+        case 'v':
+          verbose = 1;
+          break;
+        default:
+          usage (argv[0]);
+        }
+    }
+  replay = (optind < argc);
+
+  if (if_count < 1 || if_count > 255 || nbr_want < 1
+      || nbr_want > 250 * if_count || prefix_count < 0
+      || prefix_count > (1 << 20) || rounds < 0
+      || route_per_pkt < 1 || route_per_pkt > 50)
+    usage (argv[0]);
+
+  fixture_init ("testeigrpreplay", verbose);
+  fixture_hooks.ingest_begin = bench_ingest_begin;
+  fixture_hooks.ingest_end = bench_ingest_end;
+  fixture_hooks.sent = bench_sent;
+
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &start);
+  if (replay)
+    {
+      prefix_count = 0;
+      bench_replay (argv[optind], local);
+      printf ("replay of %s: %d neighbors\n", argv[optind], fixture_nbr_count);
+    }
+  else
+    {
+      bench_generated (if_count, nbr_want, rounds);
+      printf ("generated: %d neighbors on %d interfaces, %d prefixes, "
+              "%d rounds\n", fixture_nbr_count, if_count, prefix_count, rounds);
+    }
+  quagga_gettime (QUAGGA_CLK_MONOTONIC, &stop);
+
+  bench_report (bench_usec (&start, &stop));
+
+  return 0;
+}
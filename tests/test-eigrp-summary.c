@@ -0,0 +1,150 @@
+/*
+ * EIGRP summary address test.
+ *
+ * Two neighbors share an interface with a summary configured on it.  One
+ * of them withdraws the only route to a component of the summary, which
+ * has no feasible successor and goes active.  The component must still be
+ * queried out of the summarized interface, and once both neighbors have
+ * replied the prefix must go passive again.
+ *
+ * This file is part of Quagga
+ *
+ * Quagga is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * Quagga is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Quagga; see the file COPYING.  If not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include <zebra.h>
+
+#include "thread.h"
+#include "memory.h"
+#include "linklist.h"
+#include "prefix.h"
+#include "if.h"
+#include "table.h"
+#include "stream.h"
+#include "log.h"
+
+#include "eigrpd/eigrp_structs.h"
+#include "eigrpd/eigrpd.h"
+#include "eigrpd/eigrp_interface.h"
+#include "eigrpd/eigrp_neighbor.h"
+#include "eigrpd/eigrp_packet.h"
+#include "eigrpd/eigrp_topology.h"
+#include "eigrpd/eigrp_summary.h"
+
+#include "eigrp_fixture.h"
+
+static int queried;             /* Queries eigrpd sent for the component */
+
+static void
+test_metric (struct eigrp_metrics *metric, u_int32_t delay)
+{
+  memset (metric, 0, sizeof (*metric));
+  metric->delay = delay;
+  metric->bandwith = eigrp_bandwidth_to_scaled (EIGRP_BANDWIDTH_DEFAULT);
+  metric->mtu[0] = 0xDC;
+  metric->mtu[1] = 0x05;
+  metric->hop_count = 1;
+  metric->reliability = 255;
+  metric->load = 1;
+}
+
+/* Every neighbor the Query was sent to has no other path */
+static void
+test_sent (struct eigrp_interface *ei, struct eigrp_packet *ep)
+{
+  struct eigrp_header *eigrph = (struct eigrp_header *) STREAM_DATA (ep->s);
+  struct eigrp_route_tlv route;
+  struct eigrp_metrics metric;
+  struct stream *s;
+  int i;
+
+  if (eigrph->opcode != EIGRP_OPC_QUERY)
+    return;
+  queried++;
+
+  s = stream_new (ep->length);
+  stream_put (s, STREAM_DATA (ep->s), ep->length);
+  test_metric (&metric, EIGRP_MAX_METRIC);
+
+  for (i = 0; i < fixture_nbr_count; i++)
+    {
+      struct fixture_nbr *fn = fixture_nbrs[i];
+
+      if (fn->ifp != ei->ifp)
+        continue;
+
+      fixture_packet_start (EIGRP_OPC_REPLY, fn, 0, 0);
+      stream_set_getp (s, EIGRP_HEADER_LEN);
+      while (eigrp_tlv_route_next (s, &route))
+        eigrp_add_ipv4_tlv_to_stream (fixture_obuf, &route.prefix, &metric);
+      fixture_send (fn, 0, 0);
+    }
+
+  stream_free (s);
+}
+
+static void
+test_update (struct fixture_nbr *fn, struct prefix_ipv4 *p, u_int32_t delay)
+{
+  struct eigrp_metrics metric;
+
+  test_metric (&metric, delay);
+  fixture_packet_start (EIGRP_OPC_UPDATE, fn, 0, 0);
+  eigrp_add_ipv4_tlv_to_stream (fixture_obuf, p, &metric);
+  fixture_send (fn, 1, 0);
+}
+
+int
+main (int argc, char **argv)
+{
+  struct prefix_ipv4 address, summary, p;
+  struct eigrp_prefix_entry *pe;
+  struct in_addr addr;
+  struct interface *ifp;
+  struct fixture_nbr *peer;
+
+  fixture_init ("testeigrpsummary", argc > 1 && !strcmp (argv[1], "-v"));
+  fixture_hooks.sent = test_sent;
+
+  str2prefix_ipv4 ("10.0.0.1/24", &address);
+  ifp = fixture_if_add ("sum0", &address);
+  inet_aton ("10.0.0.2", &addr);
+  peer = fixture_nbr_add (ifp, addr);
+  inet_aton ("10.0.0.3", &addr);
+  fixture_nbr_add (ifp, addr);
+
+  assert (fixture_adjacencies () == 2);
+
+  str2prefix_ipv4 ("172.16.0.0/16", &summary);
+  eigrp_summary_get (ifp, &summary);
+
+  str2prefix_ipv4 ("172.16.1.0/24", &p);
+  test_update (peer, &p, 0x100000);
+  fixture_run ();
+  pe = eigrp_topology_table_lookup_ipv4 (fixture_eigrp->topology_table, &p);
+  assert (pe && pe->state == EIGRP_FSM_STATE_PASSIVE);
+  printf ("Component learned.\n");
+
+  /* no feasible successor, the component goes active */
+  test_update (peer, &p, EIGRP_MAX_METRIC);
+  fixture_run ();
+  assert (queried > 0);
+  pe = eigrp_topology_table_lookup_ipv4 (fixture_eigrp->topology_table, &p);
+  assert (pe == NULL || pe->state == EIGRP_FSM_STATE_PASSIVE);
+  printf ("Component queried past the summary and passive again.\n");
+
+  return 0;
+}